@@ -1,3 +1,4 @@
 C:/VulkanSDK/1.2.170.0/Bin/glslc.exe shader.vert -o vert.spv
 C:/VulkanSDK/1.2.170.0/Bin/glslc.exe shader.frag -o frag.spv
+C:/VulkanSDK/1.2.170.0/Bin/glslc.exe depth_pyramid.comp -o depth_pyramid.spv
 pause
\ No newline at end of file
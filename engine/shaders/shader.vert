@@ -6,15 +6,15 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 proj;
 } ubo;
 
+// locations are fixed per attribute, see VertexLayout::getLocation
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
+// per-instance, occupies locations 3..6
+layout(location = 3) in mat4 inModel;
 
-layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-    fragColor = inColor;
+    gl_Position = ubo.proj * ubo.view * ubo.model * inModel * vec4(inPosition, 1.0);
     fragTexCoord = inTexCoord;
 }
@@ -0,0 +1,110 @@
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+#include "Frustum.h"
+#include "FrustumCuller.h"
+
+namespace
+{
+    // right handed, depth mapped to [0, 1] like the engine's projection
+    glm::mat4 perspective(float fovy, float aspect, float z_near, float z_far)
+    {
+        float     tan_half = std::tan(fovy * 0.5f);
+        glm::mat4 result(0.0f);
+        result[0][0] = 1.0f / (aspect * tan_half);
+        result[1][1] = 1.0f / tan_half;
+        result[2][2] = z_far / (z_near - z_far);
+        result[2][3] = -1.0f;
+        result[3][2] = -(z_far * z_near) / (z_far - z_near);
+        return result;
+    }
+
+    const char* path_names[] = {"scalar", "sse", "avx"};
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::vector<uint32_t> counts;
+    uint32_t              runs = 10;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc)
+            runs = std::max(std::stoi(argv[++i]), 1);
+        else
+            counts.push_back(static_cast<uint32_t>(std::stoul(arg)));
+    }
+    if (counts.empty())
+        counts = {100000, 1000000};
+
+    // a 46 degree camera at the origin looking down -z, objects scattered all around it
+    vulkan::Frustum frustum   = vulkan::Frustum::fromMatrix(perspective(0.8f, 16.0f / 9.0f, 0.1f, 500.0f));
+    vulkan::CullPath best_path = vulkan::FrustumCuller::getBestPath();
+
+    std::cout << "best path " << path_names[static_cast<int>(best_path)] << ", best of " << runs << " runs, single thread"
+              << std::endl;
+
+    bool all_match = true;
+    for (uint32_t count : counts)
+    {
+        vulkan::FrustumCuller culler;
+        culler.resize(count);
+
+        std::mt19937                          random(3);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> size(0.1f, 3.0f);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            glm::vec3 center(position(random), position(random) * 0.2f, position(random));
+            float     extent = size(random);
+            culler.setSphere(i, center, extent);
+            culler.setBox(i, center - glm::vec3(extent), center + glm::vec3(extent));
+        }
+
+        for (int boxes = 0; boxes < 2; boxes++)
+        {
+            std::vector<uint32_t> reference(count);
+            std::vector<uint32_t> visible(count);
+            uint32_t              reference_count = 0;
+
+            for (int path = 0; path <= static_cast<int>(best_path); path++)
+            {
+                std::vector<uint32_t>& output = path == 0 ? reference : visible;
+                uint32_t               visible_count = 0;
+                float                  best_ms       = 1e30f;
+
+                for (uint32_t run = 0; run < runs; run++)
+                {
+                    auto start = std::chrono::high_resolution_clock::now();
+                    visible_count = boxes ? culler.cullBoxes(frustum, output.data(), static_cast<vulkan::CullPath>(path))
+                                          : culler.cullSpheres(frustum, output.data(), static_cast<vulkan::CullPath>(path));
+                    best_ms = std::min(best_ms,
+                                       std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+                }
+
+                // every path has to produce the scalar reference list exactly
+                bool match = true;
+                if (path == 0)
+                    reference_count = visible_count;
+                else
+                    match = visible_count == reference_count &&
+                            std::equal(reference.begin(), reference.begin() + reference_count, visible.begin());
+                all_match = all_match && match;
+
+                std::cout << std::setw(8) << count << (boxes ? " boxes   " : " spheres ") << std::setw(7) << path_names[path] << "  "
+                          << std::fixed << std::setprecision(3) << std::setw(8) << best_ms << " ms  " << std::setprecision(2)
+                          << std::setw(6) << best_ms * 1e6f / count << " ns/object  " << visible_count << " visible"
+                          << (match ? "" : "  MISMATCH") << std::endl;
+            }
+        }
+    }
+
+    return all_match ? 0 : -1;
+}
@@ -0,0 +1,128 @@
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+#include "JobSystem.h"
+
+namespace
+{
+    // fixed workload, the same at every thread count
+    const uint32_t PARALLEL_FOR_COUNT  = 1 << 22;
+    const uint32_t PARALLEL_FOR_GRAIN  = 4096;
+    const uint32_t CHAIN_COUNT         = 16;
+    const uint32_t CHAIN_LENGTH        = 256;
+    const uint32_t CHAIN_LINK_WORK     = 2000;
+    const uint32_t STEAL_JOB_COUNT     = 4096;
+    const uint32_t STEAL_JOB_WORK      = 1000;
+
+    std::atomic<uint64_t> sink {0};
+
+    // some arithmetic the compiler cannot drop
+    void burn(uint32_t iterations)
+    {
+        double value = 1.0;
+        for (uint32_t i = 0; i < iterations; i++)
+            value = std::sqrt(value + i) * 1.0000001;
+        sink.fetch_add(static_cast<uint64_t>(value), std::memory_order_relaxed);
+    }
+
+    // one independent, evenly sized loop split into ranges
+    void runParallelFor(vulkan::JobSystem& jobs)
+    {
+        std::vector<float> output(PARALLEL_FOR_COUNT);
+        jobs.parallelFor(PARALLEL_FOR_COUNT, PARALLEL_FOR_GRAIN, [&](uint32_t first, uint32_t last) {
+            for (uint32_t i = first; i < last; i++)
+                output[i] = std::sin(i * 0.001f) * std::sqrt(static_cast<float>(i));
+        });
+        sink.fetch_add(static_cast<uint64_t>(output[PARALLEL_FOR_COUNT / 2]), std::memory_order_relaxed);
+    }
+
+    // independent chains whose links only start once the previous one finished, at most CHAIN_COUNT run at once
+    void runChains(vulkan::JobSystem& jobs)
+    {
+        std::unique_ptr<vulkan::JobCounter[]> counters(new vulkan::JobCounter[CHAIN_COUNT * CHAIN_LENGTH]);
+
+        for (uint32_t chain = 0; chain < CHAIN_COUNT; chain++)
+        {
+            vulkan::JobCounter* links = &counters[chain * CHAIN_LENGTH];
+            jobs.run([] { burn(CHAIN_LINK_WORK); }, &links[0]);
+            for (uint32_t link = 1; link < CHAIN_LENGTH; link++)
+                jobs.runAfter(links[link - 1], [] { burn(CHAIN_LINK_WORK); }, &links[link]);
+        }
+
+        for (uint32_t chain = 0; chain < CHAIN_COUNT; chain++)
+            jobs.wait(counters[chain * CHAIN_LENGTH + CHAIN_LENGTH - 1]);
+    }
+
+    // one job queues every job on its own thread's deque with uneven sizes, the others only get work by stealing
+    void runStealing(vulkan::JobSystem& jobs)
+    {
+        vulkan::JobCounter spawner;
+        vulkan::JobCounter work;
+        jobs.run(
+            [&] {
+                for (uint32_t i = 0; i < STEAL_JOB_COUNT; i++)
+                    jobs.run([i] { burn(STEAL_JOB_WORK * (1 + i % 16)); }, &work);
+            },
+            &spawner);
+        jobs.wait(spawner);
+        jobs.wait(work);
+    }
+
+    template<typename Func>
+    float bestOf(uint32_t runs, Func func)
+    {
+        float best = 1e30f;
+        for (uint32_t run = 0; run < runs; run++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            func();
+            best = std::min(best, std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+        }
+        return best;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    uint32_t max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    uint32_t runs        = 3;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--max-threads")
+            max_threads = std::max(std::stoi(argv[i + 1]), 1);
+        else if (arg == "--runs")
+            runs = std::max(std::stoi(argv[i + 1]), 1);
+    }
+
+    std::cout << "best of " << runs << " runs, the main thread counts as one of the threads" << std::endl
+              << "threads   parallelFor        chains          stealing" << std::endl;
+
+    float base[3] = {};
+    for (uint32_t threads = 1; threads <= max_threads; threads++)
+    {
+        // the main thread works in wait(), so one thread means no workers
+        vulkan::JobSystem jobs(threads - 1);
+
+        float times[3] = {bestOf(runs, [&] { runParallelFor(jobs); }),
+                          bestOf(runs, [&] { runChains(jobs); }),
+                          bestOf(runs, [&] { runStealing(jobs); })};
+        if (threads == 1)
+            std::copy(times, times + 3, base);
+
+        std::cout << std::setw(7) << threads;
+        for (int i = 0; i < 3; i++)
+            std::cout << std::fixed << std::setprecision(1) << std::setw(9) << times[i] << "ms " << std::setprecision(2)
+                      << std::setw(4) << base[i] / times[i] << "x";
+        std::cout << std::endl;
+    }
+
+    return sink.load() == 0 ? -1 : 0;
+}
@@ -0,0 +1,82 @@
+#include <chrono>
+#include <string>
+#include <iostream>
+#include <filesystem>
+
+#include "JobSystem.h"
+#include "ObjImporter.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Arguments parse error!" << std::endl
+                  << "Please call the tool like this:" << std::endl
+                  << "mesh_cooker  input.obj  [output.mesh]  [--compress-indices]" << std::endl
+                  << std::endl;
+        return -1;
+    }
+
+    auto start_time = std::chrono::system_clock::now();
+
+    std::string input_path  = argv[1];
+    std::string output_path = std::filesystem::path(input_path).replace_extension(".mesh").string();
+    uint32_t    flags       = 0;
+
+    for (int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--compress-indices")
+            flags |= vulkan::MESH_FILE_COMPRESSED_INDICES;
+        else
+            output_path = arg;
+    }
+
+    try
+    {
+        vulkan::JobSystem      jobs;
+        vulkan::ObjImportStats stats {};
+        vulkan::MeshData       mesh = vulkan::ObjImporter::load(input_path.data(), jobs, &stats);
+
+        vulkan::MeshOptimizationStats optimize_stats {};
+        vulkan::MeshOptimizer::optimize(mesh, &optimize_stats);
+        vulkan::MeshLodStats lod_stats {};
+        vulkan::MeshSimplifier::generateLods(mesh, vulkan::MAX_MESH_LODS, 0.1f, &lod_stats);
+        vulkan::MeshletBuilder::build(mesh);
+
+        vulkan::MeshFile::write(output_path.data(), mesh, vulkan::MeshFile::getSourceStamp(input_path.data()),
+                                vulkan::VertexLayout::getDefault(), flags);
+        vulkan::MeshFile cooked(output_path.data());
+
+        std::cout << "Cooked " << input_path << " -> " << output_path << std::endl
+                  << "  " << stats.cornerCount / 3 << " triangles, " << mesh.vertices.size() << " vertices, "
+                  << vulkan::VertexLayout::getDefault().getVertexSize() << " bytes per vertex" << std::endl
+                  << "  " << (cooked.getIndexType() == VK_INDEX_TYPE_UINT16 ? 16 : 32) << " bit indices, "
+                  << cooked.getHeader().sections[vulkan::MESH_SECTION_INDICES].size << " bytes"
+                  << ((flags & vulkan::MESH_FILE_COMPRESSED_INDICES) ? " compressed" : "") << std::endl
+                  << "  " << mesh.meshlets.size() << " meshlets" << std::endl
+                  << "  " << lod_stats.lodCount << " lods in " << lod_stats.simplifyMs << "ms:";
+        for (uint32_t i = 0; i < lod_stats.lodCount; i++)
+            std::cout << " " << lod_stats.triangleCounts[i] << " (" << lod_stats.errors[i] << ")";
+        std::cout << std::endl
+                  << "  parse " << stats.parseMs << "ms, weld " << stats.dedupMs << "ms" << std::endl
+                  << "  acmr " << optimize_stats.before.acmr << " -> " << optimize_stats.after.acmr << ", atvr "
+                  << optimize_stats.before.atvr << " -> " << optimize_stats.after.atvr << ", "
+                  << optimize_stats.clusterCount << " overdraw clusters, " << optimize_stats.optimizeMs << "ms" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    auto duration_time = std::chrono::system_clock::now() - start_time;
+    std::cout << "Completed in " << std::chrono::duration_cast<std::chrono::milliseconds>(duration_time).count() << "ms"
+              << std::endl;
+
+    return 0;
+}
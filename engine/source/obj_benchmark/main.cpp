@@ -0,0 +1,196 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#define TINYOBJLOADER_IMPLEMENTATION
+
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+
+#include <glm/gtx/hash.hpp>
+#include <tinyobjloader/tiny_obj_loader.h>
+
+#include "JobSystem.h"
+#include "ObjImporter.h"
+
+namespace
+{
+    // the vertex hash the renderer used with tinyobj
+    struct VertexHash
+    {
+        size_t operator()(const vulkan::Vertex& vertex) const
+        {
+            return ((std::hash<glm::vec3>()(vertex.pos) ^ (std::hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
+                   (std::hash<glm::vec2>()(vertex.texCoord) << 1);
+        }
+    };
+
+    // tinyobj followed by a weld through std::unordered_map, as Renderer::loadObjModel did before ObjImporter.
+    // normals are read as well so both paths produce the same vertices
+    vulkan::MeshData loadWithTinyObj(const char* path)
+    {
+        tinyobj::attrib_t                attrib;
+        std::vector<tinyobj::shape_t>    shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string                      warn, err;
+
+        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path))
+            throw std::runtime_error(warn + err);
+
+        std::unordered_map<vulkan::Vertex, uint32_t, VertexHash> unique_vertices;
+        vulkan::MeshData                                         mesh;
+
+        for (const auto& shape : shapes)
+        {
+            for (const auto& index : shape.mesh.indices)
+            {
+                vulkan::Vertex vertex {};
+                vertex.pos = {attrib.vertices[3 * index.vertex_index + 0],
+                              attrib.vertices[3 * index.vertex_index + 1],
+                              attrib.vertices[3 * index.vertex_index + 2]};
+                if (index.texcoord_index >= 0)
+                    vertex.texCoord = {attrib.texcoords[2 * index.texcoord_index + 0],
+                                       1.0f - attrib.texcoords[2 * index.texcoord_index + 1]};
+                if (index.normal_index >= 0)
+                    vertex.normal = {attrib.normals[3 * index.normal_index + 0],
+                                     attrib.normals[3 * index.normal_index + 1],
+                                     attrib.normals[3 * index.normal_index + 2]};
+                vertex.color = {1.0f, 1.0f, 1.0f};
+
+                auto inserted = unique_vertices.emplace(vertex, static_cast<uint32_t>(mesh.vertices.size()));
+                if (inserted.second)
+                    mesh.vertices.push_back(vertex);
+                mesh.indices.push_back(inserted.first->second);
+            }
+        }
+
+        return mesh;
+    }
+
+    // a triangulated grid with positions, texture coordinates and normals, every interior vertex shared by six triangles
+    void generate(uint32_t triangle_count, const char* path)
+    {
+        uint32_t columns = std::max(static_cast<uint32_t>(std::ceil(std::sqrt(triangle_count / 2.0))), 1u);
+        uint32_t rows    = std::max((triangle_count / 2 + columns - 1) / columns, 1u);
+
+        FILE* file = std::fopen(path, "wb");
+        if (!file)
+            throw std::runtime_error(std::string("failed to open ") + path + " for writing!");
+
+        std::fprintf(file, "# %ux%u grid, %u triangles\n", columns, rows, columns * rows * 2);
+        for (uint32_t y = 0; y <= rows; y++)
+            for (uint32_t x = 0; x <= columns; x++)
+                std::fprintf(file, "v %.6f %.6f %.6f\n", float(x), std::sin(x * 0.1f) * std::cos(y * 0.1f), float(y));
+        for (uint32_t y = 0; y <= rows; y++)
+            for (uint32_t x = 0; x <= columns; x++)
+                std::fprintf(file, "vt %.6f %.6f\n", float(x) / columns, float(y) / rows);
+        for (uint32_t y = 0; y <= rows; y++)
+            for (uint32_t x = 0; x <= columns; x++)
+                std::fprintf(file, "vn 0 1 0\n");
+
+        for (uint32_t y = 0; y < rows; y++)
+        {
+            for (uint32_t x = 0; x < columns; x++)
+            {
+                uint32_t a = y * (columns + 1) + x + 1;
+                uint32_t b = a + 1;
+                uint32_t c = a + columns + 1;
+                uint32_t d = c + 1;
+                std::fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, c, c, c, b, b, b);
+                std::fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", b, b, b, c, c, c, d, d, d);
+            }
+        }
+
+        std::fclose(file);
+    }
+
+    float elapsedMs(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Arguments parse error!" << std::endl
+                  << "Please call the tool like this:" << std::endl
+                  << "obj_benchmark  input.obj  [--threads N]  [--runs N]" << std::endl
+                  << "obj_benchmark  --generate  triangles  output.obj" << std::endl
+                  << std::endl;
+        return -1;
+    }
+
+    try
+    {
+        if (std::string(argv[1]) == "--generate")
+        {
+            if (argc < 4)
+                throw std::runtime_error("--generate takes a triangle count and an output path!");
+            generate(static_cast<uint32_t>(std::stoul(argv[2])), argv[3]);
+            std::cout << "Generated " << argv[3] << std::endl;
+            return 0;
+        }
+
+        std::string input_path = argv[1];
+        uint32_t    workers    = vulkan::JobSystem::defaultWorkerCount();
+        uint32_t    runs       = 3;
+
+        for (int i = 2; i + 1 < argc; i += 2)
+        {
+            std::string arg = argv[i];
+            if (arg == "--threads")
+                workers = static_cast<uint32_t>(std::stoul(argv[i + 1]));
+            else if (arg == "--runs")
+                runs = std::max(std::stoi(argv[i + 1]), 1);
+        }
+
+        vulkan::JobSystem jobs(workers);
+
+        vulkan::MeshData reference;
+        float            reference_ms = 1e30f;
+        for (uint32_t run = 0; run < runs; run++)
+        {
+            auto start   = std::chrono::high_resolution_clock::now();
+            reference    = loadWithTinyObj(input_path.data());
+            reference_ms = std::min(reference_ms, elapsedMs(start));
+        }
+
+        vulkan::MeshData       imported;
+        vulkan::ObjImportStats stats {};
+        float                  imported_ms = 1e30f;
+        for (uint32_t run = 0; run < runs; run++)
+        {
+            vulkan::ObjImportStats run_stats {};
+            auto                   start = std::chrono::high_resolution_clock::now();
+            imported                     = vulkan::ObjImporter::load(input_path.data(), jobs, &run_stats);
+            float ms                     = elapsedMs(start);
+            if (ms < imported_ms)
+            {
+                imported_ms = ms;
+                stats       = run_stats;
+            }
+        }
+
+        bool match = reference.vertices.size() == imported.vertices.size() && reference.indices == imported.indices &&
+                     std::equal(reference.vertices.begin(), reference.vertices.end(), imported.vertices.begin());
+
+        std::cout << input_path << ": " << reference.indices.size() / 3 << " triangles, " << reference.vertices.size()
+                  << " vertices, best of " << runs << " runs" << std::endl
+                  << "  tinyobj + unordered_map  " << reference_ms << "ms" << std::endl
+                  << "  ObjImporter              " << imported_ms << "ms on " << jobs.getThreadCount() << " threads ("
+                  << reference_ms / imported_ms << "x): read " << stats.readMs << "ms, parse " << stats.parseMs << "ms, weld "
+                  << stats.dedupMs << "ms, " << stats.chunkCount << " chunks" << std::endl
+                  << "  outputs " << (match ? "identical" : "DIFFER") << std::endl;
+
+        return match ? 0 : -1;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,113 @@
+#include <chrono>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <filesystem>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include "BlockCompressor.h"
+#include "TextureFile.h"
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Arguments parse error!" << std::endl
+                  << "Please call the tool like this:" << std::endl
+                  << "texture_cooker  input.png  [output.tex]  [--bc1|--bc3|--bc5|--bc7|--rgba8]  [--linear]  [--box]" << std::endl
+                  << std::endl;
+        return -1;
+    }
+
+    auto start_time = std::chrono::system_clock::now();
+
+    std::string         input_path  = argv[1];
+    std::string         output_path = std::filesystem::path(input_path).replace_extension(".tex").string();
+    vulkan::BlockFormat format      = vulkan::BlockFormat::BC7;
+    bool                compress    = true;
+    bool                srgb        = true;
+    vulkan::MipFilter   filter      = vulkan::MipFilter::Kaiser;
+
+    for (int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--bc1")
+            format = vulkan::BlockFormat::BC1;
+        else if (arg == "--bc3")
+            format = vulkan::BlockFormat::BC3;
+        else if (arg == "--bc5")
+            format = vulkan::BlockFormat::BC5;
+        else if (arg == "--bc7")
+            format = vulkan::BlockFormat::BC7;
+        else if (arg == "--rgba8")
+            compress = false;
+        else if (arg == "--linear")
+            srgb = false;
+        else if (arg == "--box")
+            filter = vulkan::MipFilter::Box;
+        else
+            output_path = arg;
+    }
+
+    // bc5 holds normals or other data, never color
+    if (compress && format == vulkan::BlockFormat::BC5)
+        srgb = false;
+
+    try
+    {
+        int       width, height, channels;
+        stbi_uc*  pixels = stbi_load(input_path.data(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels)
+            throw std::runtime_error("failed to load " + input_path + "!");
+
+        auto              mip_start = std::chrono::system_clock::now();
+        vulkan::MipChain  chain     = vulkan::MipGenerator::generate(pixels, width, height, filter, srgb);
+        stbi_image_free(pixels);
+        auto              mip_time  = std::chrono::system_clock::now() - mip_start;
+
+        auto                              encode_start = std::chrono::system_clock::now();
+        vulkan::JobSystem                 jobs;
+        std::vector<std::vector<uint8_t>> levels;
+        for (uint32_t level = 0; level < chain.getLevelCount(); level++)
+        {
+            uint32_t       level_width  = std::max(uint32_t(width) >> level, 1u);
+            uint32_t       level_height = std::max(uint32_t(height) >> level, 1u);
+            const uint8_t* level_pixels = chain.data.data() + chain.offsets[level];
+
+            if (compress)
+                levels.push_back(vulkan::BlockCompressor::compress(level_pixels, level_width, level_height, format, &jobs));
+            else
+                levels.emplace_back(level_pixels, level_pixels + size_t(level_width) * level_height * 4);
+        }
+        auto encode_time = std::chrono::system_clock::now() - encode_start;
+
+        VkFormat vk_format = compress ? vulkan::getBlockFormat(format, srgb) : (srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM);
+        vulkan::TextureFile::write(output_path.data(), vk_format, width, height, levels, vulkan::getFileStamp(input_path.data()));
+        vulkan::TextureFile cooked(output_path.data());
+
+        const char* format_names[] = {"bc1", "bc3", "bc5", "bc7"};
+        std::cout << "Cooked " << input_path << " -> " << output_path << std::endl
+                  << "  " << width << "x" << height << ", " << cooked.getLevelCount() << " levels, "
+                  << (compress ? format_names[static_cast<int>(format)] : "rgba8") << (srgb ? " srgb" : " linear") << std::endl
+                  << "  " << cooked.getDataSize() << " bytes, " << chain.data.size() << " as rgba8 ("
+                  << float(chain.data.size()) / float(cooked.getDataSize()) << "x)" << std::endl
+                  << "  mips " << std::chrono::duration_cast<std::chrono::milliseconds>(mip_time).count() << "ms, encode "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(encode_time).count() << "ms on " << jobs.getThreadCount()
+                  << " threads" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    auto duration_time = std::chrono::system_clock::now() - start_time;
+    std::cout << "Completed in " << std::chrono::duration_cast<std::chrono::milliseconds>(duration_time).count() << "ms"
+              << std::endl;
+
+    return 0;
+}
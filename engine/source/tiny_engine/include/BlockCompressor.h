@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace vulkan {
+	class JobSystem;
+
+	enum class BlockFormat {
+		// rgb at 4 bits per texel, alpha is dropped
+		BC1 = 0,
+		// bc1 color with an interpolated alpha block, 8 bits per texel
+		BC3,
+		// two independent channels (red and green) at 8 bits per texel, for tangent space normal maps
+		BC5,
+		// rgba at 8 bits per texel, the highest quality of the four
+		BC7
+	};
+
+	/**
+	* @BlockCompressor: encodes rgba8 texels into 4x4 blocks the gpu samples without decompressing.
+	*   Endpoints come from the principal axis of each block and are refined once by least squares over the chosen indices.
+	*   BC7 only emits mode 6, one subset with rgba endpoints and 4 bit indices. That covers most content well,
+	*   the partitioned modes would help blocks with several distinct colors at a much higher search cost.
+	*   Blocks on the right and bottom edge of sizes that are not a multiple of 4 repeat the last column and row.
+	*   Depends on nothing but the standard library and the job system, so the offline cooker can link it.
+	*/
+	class BlockCompressor {
+	public:
+		static const uint32_t BLOCK_DIM = 4;
+
+		// bytes of one 4x4 block
+		static uint32_t getBlockSize(BlockFormat format);
+		static size_t getCompressedSize(BlockFormat format, uint32_t width, uint32_t height);
+
+		// rows of blocks are spread over jobs when given
+		static std::vector<uint8_t> compress(const uint8_t* pixels, uint32_t width, uint32_t height, BlockFormat format, JobSystem* jobs = nullptr);
+		// texels holds 16 rgba8 texels in row order, writes getBlockSize() bytes
+		static void compressBlock(const uint8_t* texels, BlockFormat format, uint8_t* block);
+	};
+
+}
@@ -3,11 +3,13 @@
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
 
+#include "MemoryAllocator.h"
+
 namespace vulkan {
 	class Buffer
 	{
 	public:
-		explicit Buffer(VkPhysicalDevice physicalDevice, VkDevice device, const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags requiredFlags);
+		explicit Buffer(MemoryAllocator& allocator, VkDevice device, const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags requiredFlags, AllocationStrategy strategy = AllocationStrategy::FreeList);
 		~Buffer();
 
 		Buffer(const Buffer&) = delete;
@@ -17,20 +19,18 @@ namespace vulkan {
 		
 		VkBuffer getBuffer() const;
 		VkDeviceMemory getMemory() const;
+		VkDeviceSize getOffset() const;
 		size_t getSize() const;
 		uint8_t* map();
 		void unmap();
 
 	private:
-		void Buffer::createBuffer(const VkBufferCreateInfo& bufferInfo, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-
-	private:
-		VkPhysicalDevice m_physicalDevice;
+		MemoryAllocator& m_allocator;
 		VkDevice m_device;
 		VkDeviceSize m_size;
 		uint8_t* m_mappedPtr;
 		VkBuffer m_buffer;
-		VkDeviceMemory m_memory;
+		MemoryAllocation m_memory;
 	};
 
 
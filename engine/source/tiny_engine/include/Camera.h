@@ -79,6 +79,10 @@ public:
 		return keys.left || keys.right || keys.up || keys.down;
 	}
 
+	float getFov() {
+		return fov;
+	}
+
 	float getNearClip() {
 		return znear;
 	}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "RenderCfg.h"
+
+namespace vulkan {
+	class JobSystem;
+
+	/**
+	* @CommandRecorder: records secondary command buffers for slices of a draw list as jobs.
+	*   Every job system thread owns one command pool per frame in flight, so recording never touches a
+	*   pool another thread uses and a frame's pools are reset in one call once the frame has completed.
+	*/
+	class CommandRecorder {
+	public:
+		// records the items [first, last) into a secondary command buffer that is already begun
+		typedef std::function<void(VkCommandBuffer commandBuffer, uint32_t first, uint32_t last)> RecordFunc;
+
+		static const uint32_t MIN_ITEMS_PER_SLICE = 32;
+
+		explicit CommandRecorder(VkDevice device, uint32_t queueFamilyIndex, JobSystem& jobs);
+		~CommandRecorder();
+
+		CommandRecorder(const CommandRecorder&) = delete;
+		CommandRecorder(const CommandRecorder&&) = delete;
+		CommandRecorder& operator= (const CommandRecorder&) = delete;
+		CommandRecorder& operator= (const CommandRecorder&&) = delete;
+
+	public:
+		// resets every pool of the frame, the frame's previous submission has to be complete
+		void beginFrame(uint32_t frameIndex);
+		// returns the secondary buffers in slice order, ready for vkCmdExecuteCommands
+		const std::vector<VkCommandBuffer>& record(uint32_t frameIndex, uint32_t itemCount,
+			const VkCommandBufferInheritanceInfo& inheritanceInfo, const RecordFunc& recordFunc);
+
+	private:
+		struct ThreadContext {
+			VkCommandPool commandPools[MAX_FRAMES_IN_FLIGHT];
+			std::vector<VkCommandBuffer> commandBuffers[MAX_FRAMES_IN_FLIGHT];
+			uint32_t usedBuffers[MAX_FRAMES_IN_FLIGHT];
+		};
+
+		VkCommandBuffer acquireCommandBuffer(uint32_t frameIndex);
+
+	private:
+		VkDevice m_device;
+		JobSystem& m_jobs;
+
+		// indexed by JobSystem::getThreadIndex()
+		std::vector<ThreadContext> m_contexts;
+		std::vector<VkCommandBuffer> m_sliceBuffers;
+	};
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <functional>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "MemoryAllocator.h"
+
+namespace vulkan {
+	struct DeletionQueueStats {
+		uint32_t pendingCount = 0;
+		uint64_t releasedCount = 0;
+	};
+
+	/**
+	* @DeletionQueue: vulkan handles that may still be referenced by frames in flight.
+	*   Everything retired is tagged with the timeline value of the frame being recorded and destroyed once
+	*   release() is passed a completed value at least as large, the frame pacer does both every frame.
+	*   Replacing a mesh, texture or swap chain at runtime therefore never waits for the device.
+	*   Safe to call from jobs, objects owned by jobs may be dropped on any thread.
+	*/
+	class DeletionQueue {
+	public:
+		explicit DeletionQueue(MemoryAllocator& allocator, VkDevice device);
+		// waits for the device and destroys everything still queued
+		~DeletionQueue();
+
+		DeletionQueue(const DeletionQueue&) = delete;
+		DeletionQueue(const DeletionQueue&&) = delete;
+		DeletionQueue& operator= (const DeletionQueue&) = delete;
+		DeletionQueue& operator= (const DeletionQueue&&) = delete;
+
+	public:
+		// memory is returned to the allocator together with the handle
+		void retire(VkBuffer buffer, const MemoryAllocation& memory);
+		void retire(VkImage image, const MemoryAllocation& memory);
+		void retire(VkImageView view);
+		void retire(VkFramebuffer framebuffer);
+		void retire(VkRenderPass renderPass);
+		void retire(VkSwapchainKHR swapChain);
+		// for objects that clean up after themselves, func runs in place of the destroy call
+		void retire(std::function<void()> func);
+
+		// handles retired from now on wait for frameValue
+		void beginFrame(uint64_t frameValue);
+		void release(uint64_t completedValue);
+
+		DeletionQueueStats getStats() const;
+
+	private:
+		enum class Type : uint8_t {
+			Func = 0,
+			Framebuffer,
+			RenderPass,
+			ImageView,
+			Image,
+			Buffer,
+			SwapChain
+		};
+
+		struct Entry {
+			uint64_t value;
+			Type type;
+			// the handle of the entry's type, non-dispatchable handles are 64 bit on every platform
+			uint64_t handle;
+			MemoryAllocation memory;
+			std::function<void()> func;
+		};
+
+		void push(Type type, uint64_t handle, const MemoryAllocation& memory = MemoryAllocation{});
+		void destroy(Entry& entry);
+
+	private:
+		MemoryAllocator& m_allocator;
+		VkDevice m_device;
+
+		mutable std::mutex m_mutex;
+		uint64_t m_frameValue = 1;
+		// ordered by value, entries are only ever appended with the current frame's value
+		std::deque<Entry> m_entries;
+		uint64_t m_releasedCount = 0;
+	};
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include "RenderCfg.h"
+#include "MemoryAllocator.h"
+#include "RenderGraph.h"
+
+namespace vulkan {
+	class Buffer;
+	class PipelineCache;
+
+	// one frame's copy of a coarse pyramid level, valid once the frame's timeline value has been reached
+	struct DepthReadback {
+		const float* depth = nullptr;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		// clip space of the frame the depth was rendered with, y already flipped like the uniform's projection
+		glm::mat4 viewProjection = glm::mat4(1.0f);
+		bool valid = false;
+	};
+
+	/**
+	* @DepthPyramid: hierarchical z buffer built from the swap chain's depth attachment after the scene pass.
+	*   Level 0 is the depth extent rounded down to powers of two, every texel of a level is the maximum of the
+	*   texels it covers one level up, so a box whose nearest depth is behind a texel is behind everything under it.
+	*   The first level no larger than READBACK_SIZE is copied to host memory per frame in flight for the cpu culler.
+	*   The pyramid image is a render graph transient, the graph transitions it and the depth attachment around the passes.
+	*   Bound to one depth attachment, a resized swap chain gets a new pyramid once the frames using the old one completed.
+	*/
+	class DepthPyramid {
+	public:
+		static const uint32_t READBACK_SIZE = 256;
+
+		explicit DepthPyramid(MemoryAllocator& allocator, VkDevice device, PipelineCache& pipelineCache, VkImageView depthView, VkExtent2D depthExtent);
+		~DepthPyramid();
+
+		DepthPyramid(const DepthPyramid&) = delete;
+		DepthPyramid(const DepthPyramid&&) = delete;
+		DepthPyramid& operator= (const DepthPyramid&) = delete;
+		DepthPyramid& operator= (const DepthPyramid&&) = delete;
+
+	public:
+		// the pyramid image the render graph has to create, and the image it created for it
+		RenderGraphImageDesc getImageDesc() const;
+		void setImage(VkImage image);
+
+		// depth in SHADER_READ_ONLY_OPTIMAL, the pyramid in GENERAL
+		void recordReduce(VkCommandBuffer commandBuffer);
+		// the pyramid in TRANSFER_SRC_OPTIMAL, the frame's readback buffer ready for transfer writes
+		void recordReadback(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::mat4& viewProjection);
+		VkBuffer getReadbackBuffer(uint32_t frameIndex) const;
+		DepthReadback getReadback(uint32_t frameIndex) const;
+
+		uint32_t getLevelCount() const;
+		VkExtent2D getExtent(uint32_t level) const;
+
+	private:
+		void createPyramid();
+		void createDescriptors();
+		void createPipeline(PipelineCache& pipelineCache);
+		void destroyViews();
+		void destroy();
+
+	private:
+		MemoryAllocator& m_allocator;
+		VkDevice m_device;
+		VkImageView m_depthView;
+		VkExtent2D m_depthExtent;
+
+		// owned by the render graph
+		VkImage m_image = VK_NULL_HANDLE;
+		std::vector<VkImageView> m_levelViews;
+		std::vector<VkExtent2D> m_levelExtents;
+		VkSampler m_sampler = VK_NULL_HANDLE;
+
+		VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+		VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+		// set i reduces level i - 1 (the depth attachment for i == 0) into level i
+		std::vector<VkDescriptorSet> m_descriptorSets;
+		VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline m_pipeline = VK_NULL_HANDLE;
+
+		uint32_t m_readbackLevel = 0;
+		std::unique_ptr<Buffer> m_readbackBuffers[MAX_FRAMES_IN_FLIGHT];
+		const float* m_readbackData[MAX_FRAMES_IN_FLIGHT] = {};
+		glm::mat4 m_readbackViewProjections[MAX_FRAMES_IN_FLIGHT];
+		bool m_readbackValid[MAX_FRAMES_IN_FLIGHT] = {};
+	};
+
+}
@@ -15,7 +15,7 @@ namespace vulkan {
 		~Descriptor();
 
 	public:
-		const VkDescriptorSet& getDescriptorSet(uint32_t index) const;
+		const VkDescriptorSet& getDescriptorSet() const;
 		VkDescriptorSetLayout getDescriptorLayout() const;
 
 	private:
@@ -27,7 +27,7 @@ namespace vulkan {
 		VkDescriptorPool m_descriptorPool;
 
 		VkDescriptorSetLayout m_descriptorSetLayout;
-		std::vector<VkDescriptorSet> m_descriptorSets;
+		VkDescriptorSet m_descriptorSet;
 	
 	};
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
 
+#include "JobSystem.h"
 #include "Window.h"
 #include "Renderer.h"
 
@@ -20,6 +21,7 @@ namespace vulkan {
 		void run();
 
 	private:
+		JobSystem m_jobs;
 		Window m_window;
 		Renderer m_renderer;
 	};
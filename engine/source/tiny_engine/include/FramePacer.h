@@ -0,0 +1,81 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <functional>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "RenderCfg.h"
+
+namespace vulkan {
+	class DeletionQueue;
+
+	/**
+	* @FramePacer: tracks gpu progress as the value of one timeline semaphore, frame N signals N when its submission completes.
+	*   beginFrame() only blocks until the frame MAX_FRAMES_IN_FLIGHT back has completed, so the cpu records frame N + 1
+	*   while the gpu is still on frame N. The binary semaphores the swap chain needs stay per frame slot.
+	*   It drives the deletion queue, handles retired while a frame is recorded are destroyed once that frame's value is reached,
+	*   objects still referenced by frames in flight are released this way without waiting for the device.
+	*/
+	class FramePacer {
+	public:
+		explicit FramePacer(VkDevice device, DeletionQueue& deletionQueue);
+		~FramePacer();
+
+		FramePacer(const FramePacer&) = delete;
+		FramePacer(const FramePacer&&) = delete;
+		FramePacer& operator= (const FramePacer&) = delete;
+		FramePacer& operator= (const FramePacer&&) = delete;
+
+	public:
+		// waits for the frame slot to be free and runs the deferred work that has completed, returns the slot
+		uint32_t beginFrame();
+		// submits the recorded frame, waiting for the acquired image at waitStage and signaling the frame's value.
+		// queueMutex is held for the submit, other threads may submit to the same queue. returns the semaphore presentation has to wait on
+		VkSemaphore submit(VkQueue queue, std::mutex& queueMutex, VkCommandBuffer commandBuffer, VkPipelineStageFlags waitStage);
+		// makes the next submit() also wait at waitStage until the timeline semaphore has reached value, e.g. on work of another queue
+		void waitFor(VkSemaphore timeline, uint64_t value, VkPipelineStageFlags waitStage);
+
+		// runs func once every frame submitted so far and the one being recorded have completed
+		void defer(std::function<void()> func);
+		// releases retired handles that have completed, beginFrame() does this every frame
+		void collect();
+
+		bool isComplete(uint64_t value);
+		void wait(uint64_t value);
+
+		uint32_t getFrameIndex() const;
+		// value the frame being recorded signals
+		uint64_t getFrameValue() const;
+		uint64_t getSubmittedValue() const;
+		// cached between calls to collect(), wait() and isComplete()
+		uint64_t getCompletedValue() const;
+
+		VkSemaphore getImageAvailSemaphore() const;
+		VkSemaphore getRenderFinishedSemaphore() const;
+		VkSemaphore getTimelineSemaphore() const;
+
+	private:
+		void queryCompletedValue();
+
+	private:
+		VkDevice m_device;
+		DeletionQueue& m_deletionQueue;
+
+		VkSemaphore m_timeline = VK_NULL_HANDLE;
+		std::vector<VkSemaphore> m_imageAvailableSemaphores;
+		std::vector<VkSemaphore> m_renderFinishedSemaphores;
+
+		// waits added by waitFor(), cleared by submit()
+		std::vector<VkSemaphore> m_waitSemaphores;
+		std::vector<uint64_t> m_waitValues;
+		std::vector<VkPipelineStageFlags> m_waitStages;
+
+		// frame slot is (value - 1) % MAX_FRAMES_IN_FLIGHT
+		uint64_t m_submittedValue = 0;
+		uint64_t m_completedValue = 0;
+	};
+
+}
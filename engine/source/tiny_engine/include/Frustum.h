@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace vulkan {
+	enum FrustumPlane {
+		FRUSTUM_PLANE_LEFT = 0,
+		FRUSTUM_PLANE_RIGHT,
+		FRUSTUM_PLANE_BOTTOM,
+		FRUSTUM_PLANE_TOP,
+		FRUSTUM_PLANE_NEAR,
+		FRUSTUM_PLANE_FAR,
+		FRUSTUM_PLANE_COUNT
+	};
+
+	// normalized planes pointing inwards, xyz the normal and w the distance
+	struct Frustum {
+		glm::vec4 planes[FRUSTUM_PLANE_COUNT];
+
+		// from a view projection with a [0, 1] depth range, planes are in the space the matrix transforms from
+		static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+		bool intersectsSphere(const glm::vec3& center, float radius) const;
+	};
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+
+namespace vulkan {
+	enum class CullPath {
+		Scalar = 0,
+		SSE,
+		AVX
+	};
+
+	/**
+	* @FrustumCuller: world space bounds kept as structure of arrays, tested 4 (SSE) or 8 (AVX) at a time.
+	*   Boxes are stored as center and half extent, so a box test is one dot product and one abs-dot per plane.
+	*   The widest path the cpu supports is picked at runtime, the scalar path is the reference for the others.
+	*/
+	class FrustumCuller {
+	public:
+		FrustumCuller() = default;
+
+		FrustumCuller(const FrustumCuller&) = delete;
+		FrustumCuller(const FrustumCuller&&) = delete;
+		FrustumCuller& operator= (const FrustumCuller&) = delete;
+		FrustumCuller& operator= (const FrustumCuller&&) = delete;
+
+	public:
+		void resize(uint32_t count);
+		void setSphere(uint32_t index, const glm::vec3& center, float radius);
+		void setBox(uint32_t index, const glm::vec3& min, const glm::vec3& max);
+		// the world box of a local box under an affine transform
+		void setBox(uint32_t index, const glm::vec3& min, const glm::vec3& max, const glm::mat4& transform);
+		uint32_t getCount() const;
+
+		// write the indices of the visible entries in ascending order and return how many there are,
+		// visible has to hold getCount() entries
+		uint32_t cullSpheres(const Frustum& frustum, uint32_t* visible) const;
+		uint32_t cullBoxes(const Frustum& frustum, uint32_t* visible) const;
+		uint32_t cullSpheres(const Frustum& frustum, uint32_t* visible, CullPath path) const;
+		uint32_t cullBoxes(const Frustum& frustum, uint32_t* visible, CullPath path) const;
+
+		static CullPath getBestPath();
+
+	private:
+		uint32_t m_count = 0;
+		// spheres
+		std::vector<float> m_sphereX, m_sphereY, m_sphereZ, m_radius;
+		// boxes
+		std::vector<float> m_centerX, m_centerY, m_centerZ, m_extentX, m_extentY, m_extentZ;
+	};
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vulkan {
+	const uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+
+	// 64 bit FNV-1a, the previous result continues the hash over several ranges
+	inline uint64_t hashBytes(const void* data, size_t size, uint64_t hash = HASH_SEED) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	// T has to be free of padding, padding bytes are indeterminate
+	template<typename T>
+	inline uint64_t hashValue(const T& value, uint64_t hash = HASH_SEED) {
+		return hashBytes(&value, sizeof(value), hash);
+	}
+
+	// murmur3 finalizer, every input bit affects the low bits, for hashes that are reduced to a table slot
+	inline uint64_t hashMix(uint64_t hash) {
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+		hash *= 0xc4ceb9fe1a85ec53ull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+}
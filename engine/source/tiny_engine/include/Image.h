@@ -3,12 +3,14 @@
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
 
+#include "MemoryAllocator.h"
+
 namespace vulkan
 {
 	class Image 
 	{
 	public:
-		explicit Image(VkPhysicalDevice physicalDevice, VkDevice device, const VkImageCreateInfo& createInfo,
+		explicit Image(MemoryAllocator& allocator, VkDevice device, const VkImageCreateInfo& createInfo,
 			VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags, VkImageViewType viewType, const VkImageSubresourceRange& subresourceRange);
 		~Image();
 		
@@ -22,10 +24,10 @@ namespace vulkan
 		const VkDeviceMemory& getMemory() const;
 
 	private:
-		VkPhysicalDevice m_physicalDevice;
+		MemoryAllocator& m_allocator;
 		VkDevice m_device;
 		VkImage m_image;
 		VkImageView m_view;
-		VkDeviceMemory m_memory;
+		MemoryAllocation m_memory;
 	};
 }
\ No newline at end of file
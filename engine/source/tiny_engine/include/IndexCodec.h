@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+namespace vulkan {
+	/**
+	* @IndexCodec: lossless byte codec for index buffers, made for cooked files and decoded at load time.
+	*   Every index is stored relative to the next vertex not referenced yet, zigzag folded into a varint.
+	*   After MeshOptimizer::optimizeVertexFetch new vertices appear in order and reused ones are close behind,
+	*   so most indices take a single byte.
+	*/
+	class IndexCodec {
+	public:
+		static std::vector<uint8_t> encode(const uint32_t* indices, size_t indexCount);
+		// writes indexCount indices of indexType (UINT16 or UINT32) to dst, throws on malformed data
+		static void decode(const uint8_t* data, size_t size, void* dst, size_t indexCount, VkIndexType indexType);
+	};
+
+	// UINT16 when every index fits, halving index memory and fetch
+	VkIndexType chooseIndexType(size_t vertexCount);
+	uint32_t getIndexSize(VkIndexType indexType);
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace vulkan {
+	class JobSystem;
+
+	/**
+	* @JobCounter: number of outstanding jobs submitted against it.
+	*   wait() returns once it drops to zero, jobs queued with runAfter() start at that point.
+	*   The first exception thrown by one of its jobs is rethrown by wait().
+	*/
+	class JobCounter {
+	public:
+		JobCounter() = default;
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator= (const JobCounter&) = delete;
+
+		bool isDone() const;
+
+	private:
+		friend class JobSystem;
+
+		struct Continuation {
+			std::function<void()> func;
+			JobCounter* counter;
+			bool mainThread;
+		};
+
+		std::atomic<uint32_t> m_count{ 0 };
+		std::mutex m_mutex;
+		std::vector<Continuation> m_continuations;
+		std::exception_ptr m_error;
+	};
+
+	enum class JobAffinity {
+		Any = 0,
+		// only run by the thread that created the job system, for GLFW and other main-thread-only apis
+		MainThread
+	};
+
+	/**
+	* @JobSystem: fixed pool of workers with one deque per thread.
+	*   A thread pushes and pops its own deque at the back and steals from the front of the others when it runs dry.
+	*   Threads blocked in wait() keep executing jobs instead of sleeping, so jobs may wait on other jobs.
+	*/
+	class JobSystem {
+	public:
+		typedef std::function<void(uint32_t first, uint32_t last)> RangeFunc;
+
+		explicit JobSystem(uint32_t workerCount = defaultWorkerCount());
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem(const JobSystem&&) = delete;
+		JobSystem& operator= (const JobSystem&) = delete;
+		JobSystem& operator= (const JobSystem&&) = delete;
+
+	public:
+		// without a counter nothing can rethrow the job's exception, it is written to std::cerr
+		void run(std::function<void()> func, JobCounter* counter = nullptr, JobAffinity affinity = JobAffinity::Any);
+		// starts func once every job of dependency has finished
+		void runAfter(JobCounter& dependency, std::function<void()> func, JobCounter* counter = nullptr, JobAffinity affinity = JobAffinity::Any);
+		// splits [0, count) into ranges of at least grainSize and blocks until all of them ran
+		void parallelFor(uint32_t count, uint32_t grainSize, const RangeFunc& func);
+
+		void wait(JobCounter& counter);
+		// runs queued main-thread jobs, call once per frame from the main thread
+		void pumpMainThread();
+
+		// 0 .. getThreadCount() - 1, the main thread is the last index, other threads get ~0u
+		uint32_t getThreadIndex() const;
+		uint32_t getThreadCount() const;
+		static uint32_t defaultWorkerCount();
+
+	private:
+		struct Job {
+			std::function<void()> func;
+			JobCounter* counter = nullptr;
+		};
+
+		struct WorkQueue {
+			std::mutex mutex;
+			std::deque<Job> jobs;
+		};
+
+		void push(Job job, bool mainThread);
+		bool tryExecuteOne(uint32_t threadIndex);
+		void execute(Job& job);
+		void workerLoop(uint32_t threadIndex);
+
+	private:
+		std::vector<std::unique_ptr<WorkQueue>> m_queues;
+		WorkQueue m_mainQueue;
+		std::vector<std::thread> m_workers;
+		std::thread::id m_mainThreadId;
+
+		// jobs sitting in the worker queues, briefly negative while a pop overtakes its push
+		std::atomic<int32_t> m_pendingJobs{ 0 };
+		std::atomic<uint32_t> m_nextQueue{ 0 };
+		bool m_quit = false;
+
+		std::mutex m_sleepMutex;
+		std::condition_variable m_sleepCondition;
+	};
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <functional>
+
+namespace vulkan {
+	// size and write time of a file, cooked assets store their source's to detect stale caches. 0 when it does not exist
+	uint64_t getFileStamp(const char* path);
+	// writer fills a file beside path that then replaces it, a crash never leaves a half written file behind
+	void writeFileAtomic(const char* path, const std::function<void(std::ostream&)>& writer);
+
+	// read-only memory mapping of a whole file, the view lives as long as the object
+	class MappedFile {
+	public:
+		explicit MappedFile(const char* path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(const MappedFile&&) = delete;
+		MappedFile& operator= (const MappedFile&) = delete;
+		MappedFile& operator= (const MappedFile&&) = delete;
+
+		const uint8_t* getData() const;
+		size_t getSize() const;
+
+	private:
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+#ifdef _WIN32
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#else
+		int m_file = -1;
+#endif
+	};
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <vector>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+namespace vulkan {
+	class MemoryBlock;
+
+	/**
+	* @AllocationStrategy:
+	*   FreeList: best-fit over a sorted free list, neighbours are coalesced on free. General purpose.
+	*   Buddy: power-of-two split/merge, O(log n) and fragmentation-resistant for many small, similar sized resources.
+	*   Linear: bump pointer, the block is rewound once every allocation in it is freed. For staging and per-frame data.
+	*/
+	enum class AllocationStrategy {
+		FreeList = 0,
+		Buddy,
+		Linear
+	};
+
+	struct MemoryAllocation {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		uint8_t* mapped = nullptr;
+		uint32_t memoryTypeIndex = 0;
+
+		// range actually reserved in the block, includes alignment padding / buddy rounding
+		VkDeviceSize reservedOffset = 0;
+		VkDeviceSize reservedSize = 0;
+		MemoryBlock* block = nullptr;
+	};
+
+	struct MemoryAllocatorStats {
+		uint32_t blockCount = 0;
+		uint32_t dedicatedBlockCount = 0;
+		uint32_t allocationCount = 0;
+		VkDeviceSize blockBytes = 0;
+		VkDeviceSize usedBytes = 0;
+		VkDeviceSize wastedBytes = 0;
+		VkDeviceSize freeBytes = 0;
+		VkDeviceSize largestFreeRange = 0;
+		// 0 when all free memory is one contiguous range, approaching 1 as it splinters
+		float fragmentation = 0.0f;
+	};
+
+	class MemoryAllocator {
+	public:
+		static const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+		explicit MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+		~MemoryAllocator();
+
+		MemoryAllocator(const MemoryAllocator&) = delete;
+		MemoryAllocator(const MemoryAllocator&&) = delete;
+		MemoryAllocator& operator= (const MemoryAllocator&) = delete;
+		MemoryAllocator& operator= (const MemoryAllocator&&) = delete;
+
+		MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationStrategy strategy = AllocationStrategy::FreeList);
+		void free(MemoryAllocation& allocation);
+
+		MemoryAllocatorStats getStats() const;
+		void printStats() const;
+
+		VkPhysicalDevice getPhysicalDevice() const;
+		VkDevice getDevice() const;
+
+	private:
+		struct Pool {
+			uint32_t memoryTypeIndex = 0;
+			AllocationStrategy strategy = AllocationStrategy::FreeList;
+			VkDeviceSize blockSize = 0;
+			std::vector<std::unique_ptr<MemoryBlock>> blocks;
+		};
+
+		std::unique_ptr<MemoryBlock> createBlock(uint32_t memoryTypeIndex, AllocationStrategy strategy, VkDeviceSize size, bool dedicated);
+
+	private:
+		VkPhysicalDevice m_physicalDevice;
+		VkDevice m_device;
+		VkDeviceSize m_blockSize;
+		VkDeviceSize m_bufferImageGranularity;
+		VkPhysicalDeviceMemoryProperties m_memProperties;
+
+		std::map<std::pair<uint32_t, AllocationStrategy>, Pool> m_pools;
+		std::vector<std::unique_ptr<MemoryBlock>> m_dedicatedBlocks;
+
+		mutable std::mutex m_mutex;
+	};
+
+}
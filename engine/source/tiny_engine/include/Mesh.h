@@ -6,33 +6,60 @@
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
 
+#include "MemoryAllocator.h"
+#include "UploadManager.h"
+#include "VkUtil.h"
+#include "VertexLayout.h"
+
 namespace vulkan
 {
-	class Vertex;
+	class DeletionQueue;
 
 	class Mesh
 	{
 	public:
-        static std::shared_ptr<Mesh> Mesh::load(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool cmdPool,
-            const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+        static std::shared_ptr<Mesh> Mesh::load(MemoryAllocator& allocator, VkDevice device, UploadManager& uploader, DeletionQueue& deletionQueue,
+            const MeshData& data, const VertexLayout& layout = VertexLayout::getDefault());
+        // one already encoded array per layout stream, copied into the staging ring right away so they may point into a mapped file
+        static std::shared_ptr<Mesh> Mesh::load(MemoryAllocator& allocator, VkDevice device, UploadManager& uploader, DeletionQueue& deletionQueue,
+            const VertexLayout& layout, const void* const* streams, uint32_t vertexCount,
+            const void* indices, uint32_t indexCount, VkIndexType indexType, const MeshBounds& bounds,
+            const Meshlet* meshlets = nullptr, uint32_t meshletCount = 0, const MeshLod* lods = nullptr, uint32_t lodCount = 0);
         Mesh() = default;
 		Mesh(const Mesh&) = delete;
 		Mesh(const Mesh&&) = delete;
 		Mesh& operator= (const Mesh&) = delete;
 		Mesh& operator= (const Mesh&&) = delete;
+		// the buffers go to the deletion queue, frames in flight may still draw the mesh
 		~Mesh();
 		uint32_t getVertexCount() const;
 		uint32_t getIndexCount() const;
-		const VkBuffer& getVertexBuffer() const;
+		// one buffer per layout stream, bound at bindings 0..getStreamCount()-1
+		const VkBuffer* getVertexBuffers() const;
+		uint32_t getStreamCount() const;
+		const VertexLayout& getLayout() const;
 		const VkBuffer& getIndexBuffer() const;
+		VkIndexType getIndexType() const;
+		UploadTicket getUploadTicket() const;
+		const MeshBounds& getBounds() const;
+		// cpu copy for culling, empty when the mesh was not split
+		const std::vector<Meshlet>& getMeshlets() const;
+		// finest first, never empty, a mesh loaded without lods has one level over all of its indices
+		const std::vector<MeshLod>& getLods() const;
 
 	private:
-		VkDevice m_device;
+		DeletionQueue* m_deletionQueue;
 		uint32_t m_vertexCount;
 		uint32_t m_indexCount;
-		VkBuffer m_vertexBuffer;
-		VkBuffer m_indexBuffer;
-		VkDeviceMemory m_vertexBufferMemory;
-		VkDeviceMemory m_indexBufferMemory;
+		VertexLayout m_layout;
+		VkBuffer m_vertexBuffers[MAX_VERTEX_STREAMS] = {};
+		VkBuffer m_indexBuffer = VK_NULL_HANDLE;
+		VkIndexType m_indexType;
+		MemoryAllocation m_vertexBufferMemory[MAX_VERTEX_STREAMS];
+		MemoryAllocation m_indexBufferMemory;
+		UploadTicket m_uploadTicket = 0;
+		MeshBounds m_bounds;
+		std::vector<Meshlet> m_meshlets;
+		std::vector<MeshLod> m_lods;
 	};
 }
\ No newline at end of file
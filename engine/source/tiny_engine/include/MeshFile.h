@@ -0,0 +1,95 @@
+#pragma once
+
+#include <memory>
+
+#include "VkUtil.h"
+#include "MappedFile.h"
+#include "VertexLayout.h"
+
+namespace vulkan {
+	const uint32_t MESH_FILE_MAGIC = 0x48534D54; // "TMSH"
+	const uint32_t MESH_FILE_VERSION = 6;
+	const uint32_t MESH_FILE_ALIGNMENT = 16;
+
+	enum MeshSection {
+		// one section per vertex layout stream
+		MESH_SECTION_VERTEX_STREAM_0 = 0,
+		MESH_SECTION_INDICES = MESH_SECTION_VERTEX_STREAM_0 + MAX_VERTEX_STREAMS,
+		// meshlets are ranges of the index section and need no vertex or triangle lists of their own
+		MESH_SECTION_MESHLETS,
+		// MeshLod ranges of the index and meshlet sections, empty for a single level mesh
+		MESH_SECTION_LODS,
+		MESH_SECTION_COUNT
+	};
+
+	enum MeshFileFlags {
+		// the index section is IndexCodec data instead of a raw array, its stride is the decoded index size
+		MESH_FILE_COMPRESSED_INDICES = 1 << 0
+	};
+
+	struct MeshFileSection {
+		uint64_t offset;
+		uint64_t size;
+		uint32_t count;
+		uint32_t stride;
+	};
+
+	/**
+	* @MeshFileHeader: start of a cooked mesh, followed by the sections it points to.
+	*   Sections are raw, tightly packed arrays ready to be copied into gpu buffers, each aligned to MESH_FILE_ALIGNMENT.
+	*   Sections a mesh does not have are left with a zero size.
+	*/
+	struct MeshFileHeader {
+		uint32_t magic;
+		uint32_t version;
+		// size and write time of the source the mesh was cooked from, used to detect stale caches
+		uint64_t sourceStamp;
+		// VertexLayout::pack of the layout the streams were encoded with
+		uint32_t vertexLayout[VertexLayout::MAX_ATTRIBUTES];
+		uint32_t vertexAttributeCount;
+		// UINT16 whenever the vertex count allows it
+		uint32_t indexType;
+		uint32_t flags;
+		float boundsMin[3];
+		float boundsMax[3];
+		float boundsCenter[3];
+		float boundsRadius;
+		MeshFileSection sections[MESH_SECTION_COUNT];
+	};
+
+	MeshBounds computeBounds(const Vertex* vertices, size_t vertexCount);
+
+	// read-only view of a cooked mesh, the sections point straight into the mapped file
+	class MeshFile {
+	public:
+		explicit MeshFile(const char* path);
+
+		MeshFile(const MeshFile&) = delete;
+		MeshFile(const MeshFile&&) = delete;
+		MeshFile& operator= (const MeshFile&) = delete;
+		MeshFile& operator= (const MeshFile&&) = delete;
+
+	public:
+		static void write(const char* path, const MeshData& mesh, uint64_t sourceStamp, const VertexLayout& layout = VertexLayout::getDefault(), uint32_t flags = 0);
+		static uint64_t getSourceStamp(const char* sourcePath);
+		// false when the cooked file is missing, from another version or layout, or older than its source
+		static bool isUpToDate(const char* path, const char* sourcePath, const VertexLayout& layout = VertexLayout::getDefault());
+
+		const MeshFileHeader& getHeader() const;
+		const void* getSectionData(MeshSection section) const;
+		uint32_t getSectionCount(MeshSection section) const;
+		MeshBounds getBounds() const;
+		const VertexLayout& getLayout() const;
+		// the vertex stream section pointers in layout order, as Mesh::load takes them
+		void getVertexStreams(const void** streams) const;
+		VkIndexType getIndexType() const;
+		// points into the mapped file, or decodes into scratch when the indices are compressed
+		const void* getIndices(std::vector<uint8_t>& scratch) const;
+
+	private:
+		std::unique_ptr<MappedFile> m_file;
+		const MeshFileHeader* m_header;
+		VertexLayout m_layout;
+	};
+
+}
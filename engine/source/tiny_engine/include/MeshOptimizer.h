@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+#include "VkUtil.h"
+
+namespace vulkan {
+	struct VertexCacheStats {
+		// average cache miss ratio: transformed vertices per triangle, 0.5 is the practical optimum for regular grids
+		float acmr = 0.0f;
+		// average transform to vertex ratio: transformed vertices per unique vertex, 1.0 is optimal
+		float atvr = 0.0f;
+	};
+
+	struct MeshOptimizationStats {
+		VertexCacheStats before;
+		VertexCacheStats after;
+		uint32_t clusterCount = 0;
+		float optimizeMs = 0.0f;
+	};
+
+	/**
+	* @MeshOptimizer: index and vertex reordering for imported meshes, none of it changes what is drawn.
+	*   optimizeVertexCache: Forsyth's linear-speed reordering for a post-transform cache of VERTEX_CACHE_SIZE entries.
+	*   optimizeOverdraw: splits the cache optimized order into clusters and draws the outward facing ones first (Tipsify).
+	*   optimizeVertexFetch: renumbers vertices in first-use order so fetches walk memory linearly, drops unused ones.
+	*/
+	class MeshOptimizer {
+	public:
+		static const uint32_t VERTEX_CACHE_SIZE = 32;
+		// fifo size used for the metrics, close to what current hardware reuses
+		static const uint32_t ANALYZE_CACHE_SIZE = 16;
+
+		static void optimize(MeshData& mesh, MeshOptimizationStats* stats = nullptr);
+
+		static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+		// threshold is how much worse than the input acmr a cluster may get, returns the cluster count
+		static uint32_t optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+		static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+		static VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = ANALYZE_CACHE_SIZE);
+	};
+
+}
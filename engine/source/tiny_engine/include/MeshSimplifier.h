@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include "VkUtil.h"
+
+namespace vulkan {
+	struct MeshLodStats {
+		uint32_t lodCount = 0;
+		uint32_t triangleCounts[MAX_MESH_LODS] = {};
+		float errors[MAX_MESH_LODS] = {};
+		float simplifyMs = 0.0f;
+	};
+
+	/**
+	* @MeshSimplifier: quadric error edge collapse (Garland and Heckbert) over the existing vertices.
+	*   Every collapse moves a vertex onto a neighbour, so simplified index buffers share the full mesh's vertex buffer.
+	*   Vertices on open borders and on attribute seams (a position split into several vertices) never move, which keeps
+	*   outlines and uv charts intact at the cost of a coarser floor for heavily seamed meshes.
+	*/
+	class MeshSimplifier {
+	public:
+		// every level aims for half the triangles of the one before it
+		static const uint32_t MIN_LOD_TRIANGLES = 64;
+
+		// returns at least targetIndexCount indices, fewer collapses when the next would exceed targetError,
+		// error receives the object space deviation of the result
+		static std::vector<uint32_t> simplify(const std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount,
+			size_t targetIndexCount, float targetError, float* error = nullptr);
+
+		// appends up to maxLods - 1 coarser levels behind the current indices and fills mesh.lods, vertices are untouched.
+		// maxError is relative to the mesh's bounding radius
+		static void generateLods(MeshData& mesh, uint32_t maxLods = MAX_MESH_LODS, float maxError = 0.1f, MeshLodStats* stats = nullptr);
+	};
+
+}
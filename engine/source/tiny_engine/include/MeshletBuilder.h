@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+#include "VkUtil.h"
+
+namespace vulkan {
+	/**
+	* @MeshletBuilder: splits an index buffer into meshlets without reordering it.
+	*   Triangles are taken in index order, which after MeshOptimizer is already spatially coherent, and a meshlet is
+	*   closed as soon as the next triangle would exceed either limit. Each meshlet gets a bounding sphere and a normal cone.
+	*/
+	class MeshletBuilder {
+	public:
+		static const uint32_t MAX_VERTICES = 64;
+		// 124 keeps the local index data of a meshlet below 384 bytes for a later mesh shader path
+		static const uint32_t MAX_TRIANGLES = 124;
+
+		static std::vector<Meshlet> build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+		// meshlets of an index range, their firstIndex stays relative to the whole index buffer
+		static std::vector<Meshlet> build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t firstIndex, size_t indexCount);
+		// splits every lod separately and fills in its meshlet range, run after MeshSimplifier::generateLods
+		static void build(MeshData& mesh);
+	};
+
+	// true when every triangle of the meshlet faces away from the eye, both given in the mesh's object space
+	bool isMeshletBackfacing(const Meshlet& meshlet, const glm::vec3& eye);
+
+}
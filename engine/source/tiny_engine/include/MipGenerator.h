@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace vulkan {
+	enum class MipFilter {
+		// averages the footprint of each texel, soft but never rings
+		Box = 0,
+		// kaiser windowed sinc over two texels of the smaller level on each side, keeps more detail
+		Kaiser
+	};
+
+	// rgba8 levels back to back, largest first, as UploadManager::uploadImage takes them
+	struct MipChain {
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<uint8_t> data;
+		// byte offset of every level into data
+		std::vector<size_t> offsets;
+
+		uint32_t getLevelCount() const;
+	};
+
+	/**
+	* @MipGenerator: builds mip chains on the cpu, for assets cooked offline and formats the gpu cannot blit.
+	*   Every level is filtered from the one above with a separable kernel, in linear light when the texels are srgb,
+	*   alpha is always linear. Level sizes follow vulkan, each is half the one above rounded down and at least 1,
+	*   so odd sizes are filtered over their real footprint instead of dropping a row or column.
+	*   On x86 every texel is one sse vector, other targets take the scalar path.
+	*   Depends on nothing but the standard library, so the offline cooker can link it.
+	*/
+	class MipGenerator {
+	public:
+		// full chain down to 1x1
+		static uint32_t getLevelCount(uint32_t width, uint32_t height);
+
+		// maxLevels 0 generates the full chain down to 1x1
+		static MipChain generate(const uint8_t* pixels, uint32_t width, uint32_t height, MipFilter filter = MipFilter::Kaiser,
+			bool srgb = true, uint32_t maxLevels = 0);
+
+		// one level from the one above, both as linear rgba floats
+		static void downsample(const float* src, uint32_t srcWidth, uint32_t srcHeight, float* dst, uint32_t dstWidth, uint32_t dstHeight,
+			MipFilter filter);
+	};
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "VkUtil.h"
+
+namespace vulkan {
+	class JobSystem;
+
+	struct ObjImportStats {
+		float readMs = 0.0f;
+		float parseMs = 0.0f;
+		float dedupMs = 0.0f;
+		uint32_t chunkCount = 0;
+		uint32_t cornerCount = 0;
+	};
+
+	/**
+	* @ObjImporter: Wavefront obj reader for positions, texture coordinates, normals and polygonal faces.
+	*   The file is split at line boundaries into chunks that are parsed as jobs. Relative (negative) indices are
+	*   resolved once every chunk's element counts are known. Corners are then welded into unique vertices by
+	*   value through an open-addressing table, so the result matches welding with Vertex::operator==.
+	*   Polygons are triangulated as fans, groups and materials are ignored.
+	*/
+	class ObjImporter {
+	public:
+		static MeshData load(const char* path, JobSystem& jobs, ObjImportStats* stats = nullptr);
+
+		// chunks smaller than this are not worth a job
+		static const size_t MIN_CHUNK_SIZE = 256 * 1024;
+	};
+
+}
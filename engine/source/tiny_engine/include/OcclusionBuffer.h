@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "DepthPyramid.h"
+
+namespace vulkan {
+	/**
+	* @OcclusionBuffer: cpu copy of a previous frame's depth pyramid, from its readback level down to 1x1.
+	*   Boxes are projected with the clip matrix that frame was rendered with, not the current one, so the test stays
+	*   correct for any camera motion, geometry that was hidden then and is uncovered now appears one frame late.
+	*/
+	class OcclusionBuffer {
+	public:
+		OcclusionBuffer() = default;
+
+		// rebuilds the max chain, an invalid readback leaves the buffer empty and nothing occluded
+		void update(const DepthReadback& readback);
+		bool isValid() const;
+
+		// box in the space modelToClip maps from, boxes crossing the near plane are never occluded
+		bool isOccluded(const glm::vec3& min, const glm::vec3& max, const glm::mat4& modelToClip) const;
+		// the readback frame's clip matrix
+		const glm::mat4& getViewProjection() const;
+
+	private:
+		struct Level {
+			uint32_t width;
+			uint32_t height;
+			// offset into m_depth
+			size_t offset;
+		};
+
+		std::vector<float> m_depth;
+		std::vector<Level> m_levels;
+		glm::mat4 m_viewProjection = glm::mat4(1.0f);
+		bool m_valid = false;
+	};
+
+}
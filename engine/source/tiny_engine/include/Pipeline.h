@@ -3,25 +3,74 @@
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
 
+#include <string>
 #include <utility>
 
+#include "VertexLayout.h"
+
 namespace vulkan {
+	class PipelineCache;
+
+	/**
+	* @PipelineDesc: every piece of state a graphics pipeline is compiled from.
+	*   Viewport and scissor are dynamic and not part of it, so one pipeline serves every framebuffer size.
+	*/
+	struct PipelineDesc {
+		// spir-v files in engine/shaders
+		std::string vertexShader = "vert.spv";
+		std::string fragmentShader = "frag.spv";
+		VertexLayout vertexLayout = VertexLayout::getDefault();
+		// appends the InstanceData binding behind the vertex streams
+		bool instanced = true;
+
+		VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+		VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+		VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+		bool depthTest = true;
+		bool depthWrite = true;
+		VkCompareOp depthCompare = VK_COMPARE_OP_LESS;
+
+		bool blendEnable = false;
+		VkBlendFactor srcColorBlend = VK_BLEND_FACTOR_ONE;
+		VkBlendFactor dstColorBlend = VK_BLEND_FACTOR_ZERO;
+		VkBlendOp colorBlendOp = VK_BLEND_OP_ADD;
+		VkBlendFactor srcAlphaBlend = VK_BLEND_FACTOR_ONE;
+		VkBlendFactor dstAlphaBlend = VK_BLEND_FACTOR_ZERO;
+		VkBlendOp alphaBlendOp = VK_BLEND_OP_ADD;
+		VkColorComponentFlags colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		uint32_t subpass = 0;
+		VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+
+		uint64_t hash() const;
+		bool operator==(const PipelineDesc& other) const;
+		bool operator!=(const PipelineDesc& other) const;
+	};
 
 	class Pipeline {
 	public:
-		explicit Pipeline(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t width, uint32_t height, VkExtent2D extent, VkDescriptorSetLayout descriptorSetLayout, VkRenderPass renderPass);
+		// the layout and shader modules stay owned by the caller
+		explicit Pipeline(VkDevice device, PipelineCache& pipelineCache, const PipelineDesc& desc, VkPipelineLayout pipelineLayout,
+			VkShaderModule vertexShader, VkShaderModule fragmentShader);
 		~Pipeline();
-	
+
+		Pipeline(const Pipeline&) = delete;
+		Pipeline(const Pipeline&&) = delete;
+		Pipeline& operator= (const Pipeline&) = delete;
+		Pipeline& operator= (const Pipeline&&) = delete;
+
 	public:
 		VkPipeline getPipeline() const;
 		VkPipelineLayout getPipelineLayout() const;
 
 	private:
-		VkPhysicalDevice m_physicalDevice;
 		VkDevice m_device;
 
 		VkPipelineLayout m_pipelineLayout;
 		VkPipeline m_graphicsPipeline;
 	};
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+namespace vulkan {
+	const uint32_t PIPELINE_CACHE_MAGIC = 0x48435050; // "PPCH"
+	const uint32_t PIPELINE_CACHE_VERSION = 1;
+
+	// precedes the driver's blob, a file whose fields do not match the running device and shaders is ignored
+	struct PipelineCacheHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint32_t padding;
+		uint64_t shaderHash;
+		uint64_t dataSize;
+		// catches truncated or corrupted blobs before the driver sees them
+		uint64_t dataHash;
+	};
+
+	struct PipelineCacheStats {
+		// a matching file was found at startup
+		bool loaded = false;
+		uint64_t loadedBytes = 0;
+		float loadMs = 0.0f;
+		uint32_t hitCount = 0;
+		uint32_t missCount = 0;
+		float hitMs = 0.0f;
+		float missMs = 0.0f;
+	};
+
+	/**
+	* @PipelineCache: a VkPipelineCache persisted next to the executable between runs.
+	*   The file is keyed by vendor, device, driver version, the driver's cache uuid and a hash of every compiled shader,
+	*   anything else starts from an empty cache. It is written back on destruction when the driver's data has changed.
+	*   Creation times are split into cache hits and misses, reported by VK_EXT_pipeline_creation_feedback when the
+	*   device has it, otherwise every pipeline created from a loaded file counts as a hit.
+	*   Pipelines may be created from several threads, VkPipelineCache is internally synchronized.
+	*/
+	class PipelineCache {
+	public:
+		explicit PipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path, const std::string& shaderDirectory, bool creationFeedback);
+		~PipelineCache();
+
+		PipelineCache(const PipelineCache&) = delete;
+		PipelineCache(const PipelineCache&&) = delete;
+		PipelineCache& operator= (const PipelineCache&) = delete;
+		PipelineCache& operator= (const PipelineCache&&) = delete;
+
+	public:
+		VkPipeline createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo);
+		VkPipeline createComputePipeline(const VkComputePipelineCreateInfo& createInfo);
+
+		void save();
+
+		VkPipelineCache getCache() const;
+		PipelineCacheStats getStats() const;
+		void printStats() const;
+
+		// hash of the .spv files in a directory, names included
+		static uint64_t hashShaders(const std::string& shaderDirectory);
+
+	private:
+		void load(std::vector<char>& data);
+		void recordCreation(float ms, const VkPipelineCreationFeedbackEXT& feedback);
+
+	private:
+		VkPhysicalDevice m_physicalDevice;
+		VkDevice m_device;
+		std::string m_path;
+		bool m_creationFeedback;
+
+		VkPhysicalDeviceProperties m_properties;
+		uint64_t m_shaderHash;
+		// hash of the data last loaded or saved, saving is skipped while the driver's data still matches it
+		uint64_t m_dataHash = 0;
+
+		VkPipelineCache m_cache = VK_NULL_HANDLE;
+
+		mutable std::mutex m_mutex;
+		PipelineCacheStats m_stats;
+	};
+
+}
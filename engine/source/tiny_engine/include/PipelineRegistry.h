@@ -0,0 +1,104 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "RenderCfg.h"
+#include "Pipeline.h"
+#include "JobSystem.h"
+
+namespace vulkan {
+	class PipelineCache;
+
+	typedef uint32_t PipelineHandle;
+	const PipelineHandle INVALID_PIPELINE = ~0u;
+
+	struct PipelineRegistryStats {
+		uint32_t requestCount = 0;
+		// requests answered with an existing variant
+		uint32_t dedupedCount = 0;
+		uint32_t pipelineCount = 0;
+		uint32_t failedCount = 0;
+		// summed over the compile jobs, not wall time
+		float compileMs = 0.0f;
+	};
+
+	/**
+	* @PipelineRegistry: graphics pipelines keyed by the hash of their PipelineDesc.
+	*   request() returns the handle of an identical earlier request, otherwise it queues the variant on the job system
+	*   and returns at once. getPipeline() is lock-free and yields VK_NULL_HANDLE until the compile job has finished,
+	*   draws using a variant that is not ready yet are skipped rather than stalling the frame.
+	*   Shader modules and pipeline layouts are shared between variants and live as long as the registry.
+	*/
+	class PipelineRegistry {
+	public:
+		explicit PipelineRegistry(VkDevice device, PipelineCache& pipelineCache, JobSystem& jobs, const std::string& shaderDirectory);
+		~PipelineRegistry();
+
+		PipelineRegistry(const PipelineRegistry&) = delete;
+		PipelineRegistry(const PipelineRegistry&&) = delete;
+		PipelineRegistry& operator= (const PipelineRegistry&) = delete;
+		PipelineRegistry& operator= (const PipelineRegistry&&) = delete;
+
+	public:
+		// safe to call from jobs
+		PipelineHandle request(const PipelineDesc& desc);
+
+		VkPipeline getPipeline(PipelineHandle handle) const;
+		// valid as soon as request() returns
+		VkPipelineLayout getPipelineLayout(PipelineHandle handle) const;
+		bool isReady(PipelineHandle handle) const;
+
+		// block until the variants are compiled, throws if one of them failed
+		void wait(PipelineHandle handle);
+		void waitAll();
+
+		PipelineRegistryStats getStats() const;
+		void printStats() const;
+
+	private:
+		struct Entry {
+			PipelineDesc desc;
+			VkPipelineLayout layout = VK_NULL_HANDLE;
+			std::unique_ptr<Pipeline> pipeline;
+			// published once pipeline is set, read without the lock
+			std::atomic<VkPipeline> handle{ VK_NULL_HANDLE };
+			std::atomic<bool> failed{ false };
+			JobCounter compiled;
+		};
+
+		void compile(PipelineHandle handle);
+		VkShaderModule getShaderModule(const std::string& name);
+		VkPipelineLayout getLayout(VkDescriptorSetLayout descriptorSetLayout);
+
+	private:
+		VkDevice m_device;
+		PipelineCache& m_pipelineCache;
+		JobSystem& m_jobs;
+		std::string m_shaderDirectory;
+
+		// fixed size so handles and entries never move while compile jobs and readers use them
+		std::unique_ptr<Entry[]> m_entries;
+		std::atomic<uint32_t> m_entryCount{ 0 };
+
+		// guards the lookup, layouts and stats
+		mutable std::mutex m_mutex;
+		// several descs may share a hash, operator== tells them apart
+		std::unordered_map<uint64_t, std::vector<PipelineHandle>> m_lookup;
+		std::map<VkDescriptorSetLayout, VkPipelineLayout> m_layouts;
+		PipelineRegistryStats m_stats;
+
+		// separate from m_mutex, request() does not wait for shader files to be read
+		std::mutex m_shaderMutex;
+		std::map<std::string, VkShaderModule> m_shaderModules;
+	};
+
+}
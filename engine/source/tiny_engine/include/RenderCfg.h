@@ -8,3 +8,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 
 const int MAX_FRAMES_IN_FLIGHT = 3;
+// one descriptor set per scene material
+const int MAX_MATERIALS = 64;
+// distinct pipeline variants the registry holds
+const int MAX_PIPELINES = 256;
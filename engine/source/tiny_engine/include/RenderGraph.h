@@ -0,0 +1,201 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "MemoryAllocator.h"
+
+namespace vulkan {
+	typedef uint32_t RenderGraphResource;
+	const RenderGraphResource INVALID_RESOURCE = ~0u;
+
+	// how a pass touches a resource, each one maps to a stage, access mask and image layout
+	enum class ResourceUsage : uint8_t {
+		ColorAttachment = 0,
+		DepthAttachment,
+		SampledFragment,
+		SampledCompute,
+		// GENERAL layout, read() only reads, write() reads and writes
+		StorageCompute,
+		TransferSrc,
+		TransferDst,
+		IndirectBuffer,
+		VertexBuffer,
+		Count
+	};
+
+	struct RenderGraphImageDesc {
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent = { 0, 0 };
+		uint32_t mipLevels = 1;
+		VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	};
+
+	struct RenderGraphStats {
+		uint32_t passCount = 0;
+		uint32_t culledPassCount = 0;
+		uint32_t transientImageCount = 0;
+		// transient memory without and with aliasing
+		VkDeviceSize transientBytes = 0;
+		VkDeviceSize allocatedBytes = 0;
+		// barriers recorded by the last execute
+		uint32_t barrierCount = 0;
+	};
+
+	/**
+	* @RenderGraph: a frame described as passes that declare which resources they read and write.
+	*   compile() culls passes whose results never reach an exported resource, creates the transient images and
+	*   places transients whose pass ranges do not overlap at the same memory. execute() records the passes in
+	*   declaration order and puts the barriers and layout transitions in front of each one, tracked per memory
+	*   range, so a transient reusing an alias waits for the previous owner's last reads as well.
+	*   Synchronization state persists between executes, the graph assumes its frames are submitted to one queue in order.
+	*   Destroying the graph does not wait for the device, the owner keeps it until the frames that executed it have completed.
+	*/
+	class RenderGraph {
+	public:
+		typedef std::function<void(VkCommandBuffer commandBuffer)> ExecuteFunc;
+
+		class Pass {
+		public:
+			Pass& read(RenderGraphResource resource, ResourceUsage usage);
+			// leftInLayout is the layout the pass itself leaves the image in, e.g. a render pass's finalLayout
+			Pass& write(RenderGraphResource resource, ResourceUsage usage, VkImageLayout leftInLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+			// never culled, for passes with effects the graph cannot see
+			Pass& setSideEffects();
+
+		private:
+			friend class RenderGraph;
+
+			struct Access {
+				RenderGraphResource resource;
+				ResourceUsage usage;
+				bool write;
+				VkImageLayout leftInLayout;
+			};
+
+			Pass& addAccess(RenderGraphResource resource, ResourceUsage usage, bool write, VkImageLayout leftInLayout);
+
+			std::string m_name;
+			ExecuteFunc m_execute;
+			std::vector<Access> m_accesses;
+			bool m_sideEffects = false;
+			bool m_culled = false;
+		};
+
+		explicit RenderGraph(MemoryAllocator& allocator, VkDevice device);
+		~RenderGraph();
+
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph(const RenderGraph&&) = delete;
+		RenderGraph& operator= (const RenderGraph&) = delete;
+		RenderGraph& operator= (const RenderGraph&&) = delete;
+
+	public:
+		// declaration, the graph has to be compiled again afterwards
+		RenderGraphResource createImage(const char* name, const RenderGraphImageDesc& desc);
+		RenderGraphResource importImage(const char* name, const RenderGraphImageDesc& desc);
+		RenderGraphResource importBuffer(const char* name);
+		Pass& addPass(const char* name, ExecuteFunc execute);
+		// the state the resource is left in after execute, exported resources keep the passes writing them alive
+		void exportImage(RenderGraphResource resource, VkImageLayout finalLayout,
+			VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VkAccessFlags dstAccess = 0);
+		void exportBuffer(RenderGraphResource resource, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+		// drops passes and resources and frees transient memory, waits for the device
+		void clear();
+
+		void compile();
+
+		// binds an imported image, the graph waits on readyStage before the first barrier that touches it.
+		// the layout and sync state of imported images carry over between executes until they are bound again
+		void setImportedImage(RenderGraphResource resource, VkImage image, VkImageView view, VkImageLayout currentLayout,
+			VkPipelineStageFlags readyStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		void setImportedBuffer(RenderGraphResource resource, VkBuffer buffer);
+
+		// outside a render pass
+		void execute(VkCommandBuffer commandBuffer);
+
+		VkImage getImage(RenderGraphResource resource) const;
+		VkImageView getImageView(RenderGraphResource resource) const;
+		VkBuffer getBuffer(RenderGraphResource resource) const;
+		const RenderGraphStats& getStats() const;
+
+	private:
+		// the last write to a memory range and everything that has read it since
+		struct SyncState {
+			VkPipelineStageFlags writeStages = 0;
+			VkAccessFlags writeAccess = 0;
+			VkPipelineStageFlags readStages = 0;
+			// stages and accesses the last write has been made visible to
+			VkPipelineStageFlags visibleStages = 0;
+			VkAccessFlags visibleAccess = 0;
+		};
+
+		struct Resource {
+			std::string name;
+			bool isImage = true;
+			bool imported = false;
+			RenderGraphImageDesc desc;
+			VkImageUsageFlags usage = 0;
+
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkBuffer buffer = VK_NULL_HANDLE;
+
+			bool exported = false;
+			VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags finalStage = 0;
+			VkAccessFlags finalAccess = 0;
+
+			// first and last surviving pass, transients are only alive in between
+			uint32_t firstPass = ~0u;
+			uint32_t lastPass = 0;
+			// index into m_syncStates, shared by transients aliasing the same memory, imported resources keep their own
+			uint32_t syncState = 0;
+			SyncState state;
+
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			bool touched = false;
+		};
+
+		struct Heap {
+			uint32_t memoryTypeBits = 0;
+			VkDeviceSize size = 0;
+			VkDeviceSize alignment = 1;
+			MemoryAllocation memory;
+		};
+
+		struct BarrierBatch {
+			VkPipelineStageFlags srcStages = 0;
+			VkPipelineStageFlags dstStages = 0;
+			std::vector<VkImageMemoryBarrier> imageBarriers;
+			std::vector<VkBufferMemoryBarrier> bufferBarriers;
+		};
+
+		void cullPasses();
+		void createTransients();
+		void destroyTransients();
+		SyncState& getSyncState(Resource& resource);
+		void addBarrier(BarrierBatch& batch, Resource& resource, VkImageLayout newLayout, VkPipelineStageFlags stages,
+			VkAccessFlags readAccess, VkAccessFlags writeAccess);
+		void flushBarriers(VkCommandBuffer commandBuffer, BarrierBatch& batch);
+
+	private:
+		MemoryAllocator& m_allocator;
+		VkDevice m_device;
+
+		std::vector<Resource> m_resources;
+		std::vector<std::unique_ptr<Pass>> m_passes;
+		std::vector<SyncState> m_syncStates;
+		std::vector<Heap> m_heaps;
+		BarrierBatch m_batch;
+
+		bool m_compiled = false;
+		RenderGraphStats m_stats;
+	};
+
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <mutex>
 #include <vector>
 #include <memory>
 
@@ -13,9 +14,15 @@
 #include "SwapChain.h"
 #include "Uniform.h"
 #include "Sampler.h"
-#include "SyncResources.h"
+#include "FramePacer.h"
 #include "Camera.h"
 #include "Texture.h"
+#include "Scene.h"
+#include "CommandRecorder.h"
+#include "RenderGraph.h"
+#include "PipelineRegistry.h"
+#include "DepthPyramid.h"
+#include "OcclusionBuffer.h"
 
 namespace sss {
 	class ArcBallCamera;
@@ -26,8 +33,8 @@ namespace vulkan {
 	class Texture;
 	class Descriptor;
 	class Mesh;
-	class Pipeline;
 	class Vertex;
+	class JobSystem;
 
 	enum TextureType {
 		ALBEDO = 0,
@@ -39,7 +46,7 @@ namespace vulkan {
 
 	class Renderer {
 	public:
-		explicit Renderer(void* windowHandle, uint32_t width, uint32_t height);
+		explicit Renderer(void* windowHandle, uint32_t width, uint32_t height, JobSystem& jobs);
 		~Renderer();
 
 	public:
@@ -47,36 +54,65 @@ namespace vulkan {
 		void Renderer::recordCommandBuffer();
 
 	public:
+		// safe to call from jobs
 		void createTexture(const char* path, TextureType texType);
-		void loadObjModel(const char* path);
+		MeshHandle loadObjModel(const char* path);
+		MaterialHandle createMaterial(TextureType texType);
 		void updateUniformBuffer(uint32_t currentImage);
 	
 	private:
-		void createDescriptor(TextureType texType);
-		void createPipleline();
 		void createCommandBuffers();
+		void createRenderGraph();
+		// non-blocking, the replaced swap chain and targets are released once their frames complete
+		void recreateSwapChain();
+		void recordScenePass(VkCommandBuffer commandBuffer);
+		void recordBatches(VkCommandBuffer commandBuffer, uint32_t first, uint32_t last);
 		
 	private:
+		JobSystem& m_jobs;
 		VKContext m_context;
 		Uniform m_uniform;
 		Sampler m_sampler;
 		SwapChain m_swapChain;
-		SyncResources m_syncResrc;
+		FramePacer m_pacer;
 
-		std::vector<Vertex> vertices;
-		std::vector<uint32_t> indices;
+		Scene m_scene;
+		CommandRecorder m_recorder;
 
 		std::map<TextureType, std::shared_ptr<Texture>> m_textures;
+		// guards m_textures and scene mesh registration while assets load on jobs
+		std::mutex m_assetMutex;
 
-		std::shared_ptr<Mesh> m_mesh;
-		std::shared_ptr<Descriptor> m_descriptor;
-		std::shared_ptr<Pipeline> m_pipeline;
+		// indexed by MaterialHandle
+		std::vector<std::shared_ptr<Descriptor>> m_materialDescriptors;
+		std::vector<PipelineHandle> m_materialPipelines;
+
+		// scene, depth pyramid and readback passes, the graph places every barrier between them
+		std::unique_ptr<RenderGraph> m_renderGraph;
+		RenderGraphResource m_colorTarget = INVALID_RESOURCE;
+		RenderGraphResource m_depthTarget = INVALID_RESOURCE;
+		RenderGraphResource m_pyramidTarget = INVALID_RESOURCE;
+		RenderGraphResource m_readbackTarget = INVALID_RESOURCE;
+
+		PipelineRegistry m_pipelineRegistry;
+
+		// built from every frame's depth, the newest completed frame's copy culls the next one
+		std::unique_ptr<DepthPyramid> m_depthPyramid;
+		OcclusionBuffer m_occlusion;
 
 		std::vector<VkCommandBuffer> m_commandBuffers;
 
 		Camera m_camera;
 		uint32_t m_width, m_height;
+		// frame slot handed out by the pacer for the frame being recorded
 		uint32_t currentFrame = 0;
+		// swap chain image acquired for the frame being recorded
+		uint32_t m_imageIndex = 0;
+		uint32_t m_uboOffset = 0;
+		// newest upload the frame being recorded has acquired, meshes and textures from later batches are not drawn yet
+		UploadTicket m_acquiredTicket = 0;
+		// commands per vkCmdDrawIndexedIndirect, 1 without multiDrawIndirect
+		uint32_t m_maxDrawIndirectCount = 1;
 
 		bool framebufferResized = false;
 		
@@ -4,9 +4,23 @@
 #include <vulkan/vulkan.h>
 
 namespace vulkan {
+	struct SamplerDesc {
+		VkFilter filter = VK_FILTER_LINEAR;
+		VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		// added to the computed lod, negative values sharpen at the cost of aliasing
+		float mipLodBias = 0.0f;
+		float minLod = 0.0f;
+		float maxLod = VK_LOD_CLAMP_NONE;
+		// clamped to the device limit, 1 or a device without samplerAnisotropy turns it off
+		float maxAnisotropy = 16.0f;
+	};
+
 	class Sampler {
 	public:
-		explicit Sampler(VkPhysicalDevice physicalDevice, VkDevice device);
+		// enabledFeatures as passed to vkCreateDevice
+		explicit Sampler(VkPhysicalDevice physicalDevice, VkDevice device, const VkPhysicalDeviceFeatures& enabledFeatures,
+			const SamplerDesc& desc = SamplerDesc{});
 		~Sampler();
 
 	public:
@@ -14,11 +28,17 @@ namespace vulkan {
 	
 	public:
 		VkSampler getTextureSampler() const;
+		const SamplerDesc& getDesc() const;
+		// what the sampler was created with, 1 when anisotropic filtering is off
+		float getAnisotropy() const;
 
 	private:
 		VkPhysicalDevice m_physicalDevice;
 		VkDevice m_device;
 		VkSampler m_textureSampler;
+		SamplerDesc m_desc;
+		bool m_anisotropySupported;
+		float m_anisotropy = 1.0f;
 	};
 
 }
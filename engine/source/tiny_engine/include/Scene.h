@@ -0,0 +1,165 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include "RenderCfg.h"
+#include "VkUtil.h"
+#include "MemoryAllocator.h"
+#include "Frustum.h"
+#include "FrustumCuller.h"
+
+namespace vulkan {
+	class Mesh;
+	class Texture;
+	class Buffer;
+	class OcclusionBuffer;
+
+	typedef uint32_t MeshHandle;
+	typedef uint32_t MaterialHandle;
+	typedef uint32_t NodeHandle;
+
+	const uint32_t INVALID_HANDLE = ~0u;
+
+	struct Material {
+		std::shared_ptr<Texture> albedo;
+	};
+
+	struct SceneNode {
+		glm::mat4 localTransform = glm::mat4(1.0f);
+		glm::mat4 worldTransform = glm::mat4(1.0f);
+		NodeHandle parent = INVALID_HANDLE;
+		// a node without a mesh is a pure transform
+		MeshHandle mesh = INVALID_HANDLE;
+		MaterialHandle material = INVALID_HANDLE;
+	};
+
+	/**
+	* @DrawBatch: every node sharing a (material, mesh) pair, drawn by one multi-draw of indirect commands.
+	*   The batch's nodes are contiguous in the draw order starting at firstNode. Its visible instances are
+	*   contiguous in the frame's instance buffer starting at firstInstance, grouped by their selected lod.
+	*   Without cluster culling a batch is one command per lod in use, each with firstInstance 0 so devices without
+	*   drawIndirectFirstInstance can draw it, the lod's instances are bound at lodFirstInstance[command] past the batch's.
+	*   With it a batch is one command per visible (instance, meshlet) pair of the instance's lod, drawn by one multi-draw,
+	*   and firstInstance of the commands is relative to the batch.
+	*/
+	struct DrawBatch {
+		MeshHandle mesh;
+		MaterialHandle material;
+		uint32_t firstNode;
+		uint32_t nodeCount;
+		// written by Scene::update for the frame being recorded
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+		uint32_t firstCommand;
+		uint32_t commandCount;
+		bool clustered;
+		// per command without cluster culling, relative to firstInstance
+		uint32_t lodFirstInstance[MAX_MESH_LODS];
+	};
+
+	// the camera a frame is culled for
+	struct SceneView {
+		glm::mat4 viewProjection = glm::mat4(1.0f);
+		glm::vec3 eye = glm::vec3(0.0f);
+		// a previous frame's depth, nodes and clusters that survive the frustum are tested against it when set
+		const OcclusionBuffer* occlusion = nullptr;
+		// pixels covered by one unit at distance one, viewport height / (2 tan(fovy / 2)), zero keeps every object at lod 0
+		float lodScale = 0.0f;
+		// the coarsest lod whose error projects to at most this many pixels is drawn
+		float lodErrorThreshold = 1.0f;
+	};
+
+	struct SceneCullStats {
+		uint32_t objectCount = 0;
+		uint32_t visibleObjectCount = 0;
+		uint32_t clusterCount = 0;
+		uint32_t visibleClusterCount = 0;
+		// inside the frustum but behind the occlusion buffer's depth
+		uint32_t occludedObjectCount = 0;
+		uint32_t occludedClusterCount = 0;
+		// submitted by the frame's commands, after lod selection
+		uint32_t triangleCount = 0;
+		float cullMs = 0.0f;
+	};
+
+	class Scene {
+	public:
+		explicit Scene(MemoryAllocator& allocator, VkDevice device);
+		~Scene();
+
+		Scene(const Scene&) = delete;
+		Scene(const Scene&&) = delete;
+		Scene& operator= (const Scene&) = delete;
+		Scene& operator= (const Scene&&) = delete;
+
+	public:
+		MeshHandle addMesh(std::shared_ptr<Mesh> mesh);
+		MaterialHandle addMaterial(std::shared_ptr<Texture> albedo);
+		// parents have to be added before their children
+		NodeHandle addNode(MeshHandle mesh, MaterialHandle material, const glm::mat4& transform, NodeHandle parent = INVALID_HANDLE);
+		void setTransform(NodeHandle node, const glm::mat4& transform);
+
+		// resolves world transforms, frustum and occlusion culls nodes and clusters and writes this frame's instance and indirect buffers,
+		// the frame's previous submission has to be complete
+		void update(uint32_t frameIndex, const SceneView& view);
+		// per meshlet frustum and normal cone culling, needs multiDrawIndirect and drawIndirectFirstInstance
+		void setClusterCulling(bool enabled);
+
+		const std::vector<DrawBatch>& getBatches() const;
+		const Mesh& getMesh(MeshHandle mesh) const;
+		const Material& getMaterial(MaterialHandle material) const;
+		uint32_t getMaterialCount() const;
+		uint32_t getNodeCount() const;
+		const SceneCullStats& getCullStats() const;
+		VkBuffer getInstanceBuffer(uint32_t frameIndex) const;
+		VkBuffer getIndirectBuffer(uint32_t frameIndex) const;
+
+	private:
+		void buildBatches();
+		void reserveFrameBuffers(uint32_t frameIndex);
+		uint32_t selectLod(const Mesh& mesh, const glm::mat4& transform, const SceneView& view) const;
+
+	private:
+		MemoryAllocator& m_allocator;
+		VkDevice m_device;
+
+		std::vector<std::shared_ptr<Mesh>> m_meshes;
+		// object space meshlet spheres per mesh and lod, tested against the frustum moved into each instance's space
+		std::vector<std::vector<std::unique_ptr<FrustumCuller>>> m_meshletBounds;
+		std::vector<Material> m_materials;
+		std::vector<SceneNode> m_nodes;
+
+		// node indices sorted by (material, mesh), rebuilt only when nodes are added
+		std::vector<uint32_t> m_drawOrder;
+		std::vector<DrawBatch> m_batches;
+		bool m_batchesDirty = false;
+		// worst case of commands per frame, every cluster of every instance visible
+		uint32_t m_maxCommandCount = 0;
+		// worst case without cluster culling, every lod of every batch in use
+		uint32_t m_maxBatchCommandCount = 0;
+
+		// world boxes in draw order
+		FrustumCuller m_nodeBounds;
+		std::vector<uint32_t> m_visibleNodes;
+		std::vector<uint32_t> m_visibleMeshlets;
+		// selected lod per visible node
+		std::vector<uint8_t> m_visibleLods;
+		// draw order index and lod per slot of the frame's instance buffer
+		std::vector<uint32_t> m_instanceNodes;
+		std::vector<uint8_t> m_instanceLods;
+		// MAX_MESH_LODS instance counts per batch
+		std::vector<uint32_t> m_lodInstanceCounts;
+
+		bool m_clusterCulling = false;
+		SceneCullStats m_cullStats;
+
+		std::unique_ptr<Buffer> m_instanceBuffers[MAX_FRAMES_IN_FLIGHT];
+		std::unique_ptr<Buffer> m_indirectBuffers[MAX_FRAMES_IN_FLIGHT];
+	};
+
+}
@@ -4,14 +4,18 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 
+#include "MemoryAllocator.h"
+
 namespace vulkan
 {
 	class VKContext;
+	class DeletionQueue;
 
 	class SwapChain
 	{
 	public:
-		explicit SwapChain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, uint32_t width, uint32_t height);
+		explicit SwapChain(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator, DeletionQueue& deletionQueue,
+			VkSurfaceKHR surface, uint32_t width, uint32_t height);
 		~SwapChain();
 		
 		SwapChain(SwapChain&) = delete;
@@ -28,14 +32,33 @@ namespace vulkan
 		VkRenderPass getRenderPass() const;
 		VkFramebuffer getFramebuffer(uint32_t index) const;
 		VkSwapchainKHR getSwapchain() const;
+		// stored by the render pass and left in DEPTH_STENCIL_ATTACHMENT_OPTIMAL, sampled by the depth pyramid
+		VkImage getDepthImage() const;
+		VkImageView getDepthImageView() const;
+		VkFormat getDepthFormat() const;
 
+		// builds the new swap chain from the current one without waiting for the device. the old chain, views,
+		// framebuffers and depth buffer may still be used by frames in flight and go to the deletion queue.
+		// the render pass is kept, pipelines built against it stay valid
 		void recreate(uint32_t width, uint32_t height);
 	
 	private:
-		void createSwapChain(uint32_t width, uint32_t height);
+		// everything that depends on the extent, handed over whole on recreate
+		struct Generation {
+			VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+			std::vector<VkImage> images;
+			std::vector<VkImageView> imageViews;
+			std::vector<VkFramebuffer> framebuffers;
+			VkImage depthImage = VK_NULL_HANDLE;
+			MemoryAllocation depthImageMemory;
+			VkImageView depthImageView = VK_NULL_HANDLE;
+		};
+
+		void createSwapChain(uint32_t width, uint32_t height, VkSwapchainKHR oldSwapChain);
 		void createRenderPass();
 		void createDepthBuffer();
 		void createFramebuffers();
+		void retireGeneration(Generation& generation);
 		void destroy();
 
 	private:
@@ -45,18 +68,14 @@ namespace vulkan
 	private:
 		VkPhysicalDevice m_physicalDevice;
 		VkDevice m_device;
+		MemoryAllocator& m_allocator;
+		DeletionQueue& m_deletionQueue;
 		VkSurfaceKHR m_surface;
-		VkSwapchainKHR m_swapChain;
 		VkFormat m_swapChainImageFormat;
 		VkExtent2D m_swapChainExtent;
-		std::vector<VkImage> m_swapChainImages;
-		std::vector<VkImageView> m_swapChainImageViews;
-
 		VkRenderPass m_renderPass;
-		std::vector<VkFramebuffer> m_swapChainFramebuffers;
+		VkFormat m_depthFormat;
 
-		VkImage m_depthImage;
-		VkDeviceMemory m_depthImageMemory;
-		VkImageView m_depthImageView;
+		Generation m_current;
 	};
 }
\ No newline at end of file
@@ -5,14 +5,34 @@
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
 
+#include "MemoryAllocator.h"
+#include "UploadManager.h"
+
 namespace vulkan
 {
+	class DeletionQueue;
+	class TextureFile;
+
+	// where the levels below the full size image come from
+	enum class TextureMips {
+		None = 0,
+		// blitted on the gpu from level 0, needs a format with linear blit support
+		Gpu,
+		// filtered on the cpu while loading, slower but sharper and works for every format
+		Cpu
+	};
+
 	class Texture
 	{
 	public:
-		static std::shared_ptr<Texture> load(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool cmdPool, const char* path, bool cube = false);
+		static std::shared_ptr<Texture> load(MemoryAllocator& allocator, VkDevice device, UploadManager& uploader, DeletionQueue& deletionQueue,
+			const char* path, bool cube = false, TextureMips mips = TextureMips::Gpu);
+		// cooked levels are uploaded as stored, block compressed data is never decoded on the cpu
+		static std::shared_ptr<Texture> load(MemoryAllocator& allocator, VkDevice device, UploadManager& uploader, DeletionQueue& deletionQueue,
+			const TextureFile& file);
 		
 		explicit Texture() = default;
+		// the image and view go to the deletion queue, frames in flight may still sample them
 		~Texture();
 		
 		Texture(const Texture&) = delete;
@@ -29,12 +49,18 @@ namespace vulkan
 		uint32_t getDepth() const;
 		uint32_t getLevels() const;
 		uint32_t getLayers() const;
+		UploadTicket getUploadTicket() const;
+
+	private:
+		// image and view of a 2d texture with every level, left in an undefined layout
+		static std::shared_ptr<Texture> create(MemoryAllocator& allocator, VkDevice device, DeletionQueue& deletionQueue, VkFormat format,
+			uint32_t width, uint32_t height, uint32_t mipLevels, VkImageUsageFlags usage, bool cube);
 
 	private:
-		VkDevice m_device;
-		VkImageView m_view;
-		VkImage m_image;
-		VkDeviceMemory m_deviceMemory;
+		DeletionQueue* m_deletionQueue;
+		VkImageView m_view = VK_NULL_HANDLE;
+		VkImage m_image = VK_NULL_HANDLE;
+		MemoryAllocation m_deviceMemory;
 		VkImageType m_imageType;
 		VkFormat m_format;
 		uint32_t m_width;
@@ -42,5 +68,6 @@ namespace vulkan
 		uint32_t m_depth;
 		uint32_t m_mipLevels;
 		uint32_t m_arrayLayers;
+		UploadTicket m_uploadTicket = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "MappedFile.h"
+#include "BlockCompressor.h"
+
+namespace vulkan {
+	const uint32_t TEXTURE_FILE_MAGIC = 0x58455454; // "TTEX"
+	const uint32_t TEXTURE_FILE_VERSION = 1;
+	const uint32_t TEXTURE_FILE_ALIGNMENT = 16;
+	// enough for a 32k texture
+	const uint32_t MAX_TEXTURE_LEVELS = 16;
+
+	struct TextureFileLevel {
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	/**
+	* @TextureFileHeader: start of a cooked texture, followed by its levels.
+	*   Levels are stored largest first and back to back in the format the image is created with, the first one aligned to
+	*   TEXTURE_FILE_ALIGNMENT, so the whole chain is copied into staging in one go as UploadManager::uploadImage takes it.
+	*/
+	struct TextureFileHeader {
+		uint32_t magic;
+		uint32_t version;
+		// size and write time of the source the texture was cooked from, used to detect stale caches
+		uint64_t sourceStamp;
+		// VkFormat of the levels, rgba8 or one of the bc formats
+		uint32_t format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levelCount;
+		TextureFileLevel levels[MAX_TEXTURE_LEVELS];
+	};
+
+	// bc5 has no srgb variant, it is meant for data
+	VkFormat getBlockFormat(BlockFormat format, bool srgb);
+	bool isBlockCompressed(VkFormat format);
+
+	// read-only view of a cooked texture, the levels point straight into the mapped file
+	class TextureFile {
+	public:
+		explicit TextureFile(const char* path);
+
+		TextureFile(const TextureFile&) = delete;
+		TextureFile(const TextureFile&&) = delete;
+		TextureFile& operator= (const TextureFile&) = delete;
+		TextureFile& operator= (const TextureFile&&) = delete;
+
+	public:
+		// levels are the encoded mip chain, largest first
+		static void write(const char* path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels,
+			uint64_t sourceStamp);
+		// false when the cooked file is missing, from another version or older than its source
+		static bool isUpToDate(const char* path, const char* sourcePath);
+
+		const TextureFileHeader& getHeader() const;
+		VkFormat getFormat() const;
+		uint32_t getWidth() const;
+		uint32_t getHeight() const;
+		uint32_t getLevelCount() const;
+		const uint8_t* getLevelData(uint32_t level) const;
+		// all levels, contiguous
+		const uint8_t* getData() const;
+		uint64_t getDataSize() const;
+
+	private:
+		std::unique_ptr<MappedFile> m_file;
+		const TextureFileHeader* m_header;
+	};
+
+}
@@ -5,25 +5,50 @@
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
 
+#include "MemoryAllocator.h"
+
 namespace vulkan {
+	/**
+	* @Uniform: one persistently mapped buffer split into MAX_FRAMES_IN_FLIGHT regions.
+	*   Each frame writes its per-frame / per-object blocks linearly into its own region and binds them
+	*   through VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC offsets, so no map/unmap and no descriptor set per block.
+	*/
 	class Uniform {
 	public:
-		Uniform(VkPhysicalDevice physicalDevice, VkDevice device);
+		static const VkDeviceSize DEFAULT_FRAME_CAPACITY = 2ull * 1024 * 1024;
+
+		Uniform(MemoryAllocator& allocator, VkDevice device, VkDeviceSize frameCapacity = DEFAULT_FRAME_CAPACITY);
 		~Uniform();
 
 	public:
 		void createUniformBuffers();
 
+		// rewinds the write head to the start of this frame's region, the GPU must be done with it
+		void beginFrame(uint32_t frameIndex);
+		// copies a block into the current frame's region and returns its dynamic offset
+		uint32_t push(const void* data, VkDeviceSize size);
+
+		template<typename T>
+		uint32_t push(const T& value) {
+			return push(&value, sizeof(T));
+		}
+
 	public:
-		VkBuffer getUniformBuffer(uint32_t index) const;
-		VkDeviceMemory getUniformMemory(uint32_t index) const;
+		VkBuffer getUniformBuffer() const;
+		const MemoryAllocation& getUniformMemory() const;
+		VkDeviceSize getFrameCapacity() const;
 
 	private:
-		VkPhysicalDevice m_physicalDevice;
+		MemoryAllocator& m_allocator;
 		VkDevice m_device;
 
-		std::vector<VkBuffer> m_uniformBuffers;
-		std::vector<VkDeviceMemory> m_uniformBuffersMemory;
+		VkBuffer m_uniformBuffer;
+		MemoryAllocation m_uniformBufferMemory;
+
+		VkDeviceSize m_alignment;
+		VkDeviceSize m_frameCapacity;
+		VkDeviceSize m_frameBegin = 0;
+		VkDeviceSize m_head = 0;
 	};
 
-}
\ No newline at end of file
+}
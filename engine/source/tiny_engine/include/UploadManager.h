@@ -0,0 +1,146 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <vector>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "MemoryAllocator.h"
+#include "VkUtil.h"
+
+namespace vulkan {
+	/**
+	* @UploadTicket: monotonically increasing id of the batch an upload was recorded into.
+	*   A ticket is complete once its batch's fence has signaled, so any ticket <= the last retired one is done.
+	*/
+	typedef uint64_t UploadTicket;
+
+	struct StagingRegion {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		uint8_t* mapped = nullptr;
+	};
+
+	/**
+	* @UploadManager: batches host to device copies through a staging ring and submits them to its own queue.
+	*   When that queue belongs to a dedicated transfer family the destinations are released to the graphics family
+	*   at the end of each batch, the frame that first reads them records the acquire with recordAcquire() and waits
+	*   on getSemaphore() for the returned ticket. Each destination is expected to be written by a single batch.
+	*/
+	class UploadManager {
+	public:
+		static const VkDeviceSize DEFAULT_STAGING_SIZE = 64ull * 1024 * 1024;
+		// where the graphics queue reads uploaded data
+		static const VkPipelineStageFlags CONSUMER_STAGES = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		// where the submission recording the acquire has to wait, mip chains are blitted right after it
+		static const VkPipelineStageFlags ACQUIRE_STAGES = CONSUMER_STAGES | VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+		// dstQueueFamilyIndex is the family the uploaded resources are used on. queueMutex is held around every submit,
+		// uploads submit from jobs and the queue may be the one frames are submitted to
+		explicit UploadManager(MemoryAllocator& allocator, VkDevice device, VkQueue queue, std::mutex& queueMutex, uint32_t queueFamilyIndex,
+			uint32_t dstQueueFamilyIndex, VkDeviceSize stagingSize = DEFAULT_STAGING_SIZE);
+		~UploadManager();
+
+		UploadManager(const UploadManager&) = delete;
+		UploadManager(const UploadManager&&) = delete;
+		UploadManager& operator= (const UploadManager&) = delete;
+		UploadManager& operator= (const UploadManager&&) = delete;
+
+	public:
+		// copy host data into the staging ring and record the transfer into the current batch
+		UploadTicket uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+		// data holds mipLevels tightly packed levels, largest first. with generateMips it holds level 0 only and the levels
+		// below are blitted from it, on the upload queue when it can blit, otherwise where the acquire is recorded
+		UploadTicket uploadImage(VkImage image, VkFormat format, const void* data, VkDeviceSize size, uint32_t width, uint32_t height,
+			uint32_t mipLevels = 1, bool generateMips = false);
+
+		UploadTicket copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
+		// the image has to be in TRANSFER_DST_OPTIMAL, it is released to the destination family in SHADER_READ_ONLY_OPTIMAL like uploadImage()
+		UploadTicket copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDeviceSize bufferOffset = 0);
+		UploadTicket transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
+		// takes ownership of a staging buffer, destroyed once the batch reading from it has completed
+		UploadTicket releaseStaging(VkBuffer buffer, MemoryAllocation& allocation);
+
+		// submits everything recorded so far as one command buffer, never waits
+		UploadTicket flush();
+		// retires completed batches, call once per frame
+		void update();
+
+		// records the acquire half of every batch submitted since the last call into a command buffer of the destination family,
+		// returns the ticket the submission has to wait for on getSemaphore(), 0 when there is nothing to wait for
+		UploadTicket recordAcquire(VkCommandBuffer commandBuffer);
+		// newest ticket submitted before the last recordAcquire(), what it uploaded may be used by the submission recording that acquire
+		UploadTicket getAcquiredTicket();
+		// timeline semaphore, reaches a ticket's value once its batch has completed
+		VkSemaphore getSemaphore() const;
+
+		bool isComplete(UploadTicket ticket);
+		void wait(UploadTicket ticket);
+		void waitIdle();
+
+	private:
+		struct MipGeneration {
+			VkImage image;
+			uint32_t width;
+			uint32_t height;
+			uint32_t mipLevels;
+		};
+
+		struct Batch {
+			UploadTicket ticket = 0;
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			VkFence fence = VK_NULL_HANDLE;
+			// ring position up to which this batch reads, released when the batch retires
+			VkDeviceSize ringEnd = 0;
+			std::vector<std::pair<VkBuffer, MemoryAllocation>> staging;
+			// destinations handed to the destination family when the batch is submitted
+			QueueOwnershipTransfer release;
+			// images still in TRANSFER_DST_OPTIMAL, their chains are blitted on the destination family
+			QueueOwnershipTransfer mipRelease;
+			std::vector<MipGeneration> mipmaps;
+		};
+
+		StagingRegion acquireStaging(VkDeviceSize size, VkDeviceSize alignment);
+		VkCommandBuffer beginRecording();
+		UploadTicket submitRecording();
+		void retireCompleted(bool wait, UploadTicket ticket);
+		void retire(Batch& batch);
+
+	private:
+		MemoryAllocator& m_allocator;
+		VkDevice m_device;
+		VkQueue m_queue;
+		std::mutex& m_queueMutex;
+		VkCommandPool m_commandPool;
+		VkSemaphore m_timeline;
+		QueueOwnershipTransfer m_transfer;
+		QueueOwnershipTransfer m_mipTransfer;
+
+		// persistently mapped staging ring, head and tail grow monotonically and wrap modulo the size
+		VkBuffer m_ringBuffer;
+		MemoryAllocation m_ringMemory;
+		VkDeviceSize m_ringSize;
+		VkDeviceSize m_ringHead = 0;
+		VkDeviceSize m_ringTail = 0;
+
+		std::unique_ptr<Batch> m_recording;
+		std::deque<Batch> m_inFlight;
+		std::vector<Batch> m_freeBatches;
+
+		UploadTicket m_nextTicket = 1;
+		UploadTicket m_completedTicket = 0;
+
+		// released by submitted batches, not acquired yet
+		QueueOwnershipTransfer m_pendingAcquire;
+		QueueOwnershipTransfer m_pendingMipAcquire;
+		std::vector<MipGeneration> m_pendingMipmaps;
+		UploadTicket m_pendingAcquireTicket = 0;
+		UploadTicket m_acquiredTicket = 0;
+
+		std::mutex m_mutex;
+	};
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "VkUtil.h"
+
+namespace vulkan {
+	// shader locations are fixed per attribute so one shader works with every layout, 3..6 belong to InstanceData
+	enum class VertexAttribute : uint8_t {
+		Position = 0,
+		Color,
+		TexCoord,
+		Normal,
+		Count
+	};
+
+	/**
+	* @VertexFormat:
+	*   Float3 / Float2: full precision.
+	*   Half4: xyz as half floats, w padding, three component half formats are not supported for vertex input on most hardware.
+	*   Half2: uv as half floats, exact up to 1/2048 in [0, 1] and still valid for wrapping uvs.
+	*   Unorm16x2: uv clamped to [0, 1].
+	*   Unorm8x4: colors.
+	*   Snorm8x4: unit vectors, xyz with w padding.
+	*   Octahedral16: unit vectors folded onto an octahedron in 2 x snorm16, decoded in the shader.
+	*/
+	enum class VertexFormat : uint8_t {
+		Float3 = 0,
+		Float2,
+		Half4,
+		Half2,
+		Unorm16x2,
+		Unorm8x4,
+		Snorm8x4,
+		Octahedral16,
+		Count
+	};
+
+	struct VertexAttributeDesc {
+		VertexAttribute attribute;
+		VertexFormat format;
+		// binding the attribute is stored in, every stream is its own tightly packed buffer
+		uint8_t stream;
+		uint8_t offset;
+	};
+
+	class VertexLayout {
+	public:
+		static const uint32_t MAX_STREAMS = MAX_VERTEX_STREAMS;
+		static const uint32_t MAX_ATTRIBUTES = static_cast<uint32_t>(VertexAttribute::Count);
+
+		VertexLayout() = default;
+
+		// attributes are packed in the order they are added
+		VertexLayout& add(VertexAttribute attribute, VertexFormat format, uint32_t stream = 0);
+
+		// float position alone in stream 0 for depth-only passes, half uv in stream 1, no color
+		static const VertexLayout& getDefault();
+		// the old interleaved 32 byte float layout
+		static const VertexLayout& getFull();
+
+	public:
+		std::vector<VkVertexInputBindingDescription> getBindingDescriptions() const;
+		std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() const;
+		// the bindings and attributes of a single stream, e.g. position only
+		std::vector<VkVertexInputBindingDescription> getBindingDescriptions(uint32_t stream) const;
+		std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(uint32_t stream) const;
+
+		// converts source vertices into one byte array per stream
+		std::vector<std::vector<uint8_t>> encode(const Vertex* vertices, size_t vertexCount) const;
+
+		uint32_t getStreamCount() const;
+		uint32_t getStride(uint32_t stream) const;
+		uint32_t getVertexSize() const;
+		const std::vector<VertexAttributeDesc>& getAttributes() const;
+		bool hasAttribute(VertexAttribute attribute) const;
+
+		// one word per attribute, stored in cooked files
+		uint32_t pack(uint32_t* words) const;
+		static VertexLayout unpack(const uint32_t* words, uint32_t count);
+
+		bool operator==(const VertexLayout& other) const;
+		bool operator!=(const VertexLayout& other) const;
+
+		static uint32_t getFormatSize(VertexFormat format);
+		static VkFormat getVkFormat(VertexFormat format);
+		static uint32_t getLocation(VertexAttribute attribute);
+
+	private:
+		std::vector<VertexAttributeDesc> m_attributes;
+		uint32_t m_strides[MAX_STREAMS] = {};
+		uint32_t m_streamCount = 0;
+	};
+
+	uint16_t floatToHalf(float value);
+	float halfToFloat(uint16_t value);
+	// unit vector to [-1, 1]^2
+	glm::vec2 encodeOctahedral(const glm::vec3& normal);
+	glm::vec3 decodeOctahedral(const glm::vec2& encoded);
+
+}
@@ -2,9 +2,15 @@
 
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
+#include <mutex>
 #include <vector>
+#include <memory>
 
 namespace vulkan {
+	class MemoryAllocator;
+	class UploadManager;
+	class PipelineCache;
+	class DeletionQueue;
 	
 	void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
 
@@ -31,13 +37,27 @@ namespace vulkan {
 		VkPhysicalDevice getPhysicalDevice() const;
 		VkQueue getGraphicsQueue() const;
 		VkQueue getPresentQueue() const;
+		// the graphics queue when the device has no dedicated family, submits to it must then be serialized with rendering
+		VkQueue getTransferQueue() const;
+		VkQueue getComputeQueue() const;
+		// one per distinct queue, held around every submit and present since uploads submit from jobs
+		std::mutex& getQueueMutex(VkQueue queue) const;
 		VkCommandPool getGraphicsCommandPool() const;
 		VkSurfaceKHR getSurface() const;
 		VkDescriptorPool getDescriptorPool() const;
-		// VkPhysicalDeviceFeatures getDeviceFeatures() const;
-		// VkPhysicalDeviceFeatures getEnabledDeviceFeatures() const;
-		// VkPhysicalDeviceProperties getDeviceProperties() const;
+		MemoryAllocator& getAllocator() const;
+		UploadManager& getUploadManager() const;
+		PipelineCache& getPipelineCache() const;
+		DeletionQueue& getDeletionQueue() const;
+		VkPhysicalDeviceFeatures getDeviceFeatures() const;
+		VkPhysicalDeviceFeatures getEnabledDeviceFeatures() const;
+		VkPhysicalDeviceProperties getDeviceProperties() const;
 		uint32_t getGraphicsQueueFamilyIndex() const;
+		uint32_t getTransferQueueFamilyIndex() const;
+		uint32_t getComputeQueueFamilyIndex() const;
+		// resources moving between a dedicated family and the graphics family need a QueueOwnershipTransfer
+		bool hasDedicatedTransferQueue() const;
+		bool hasAsyncComputeQueue() const;
 
 	private:
 		VkInstance m_instance;
@@ -47,12 +67,23 @@ namespace vulkan {
 		VkSurfaceKHR m_surface;
 		VkQueue m_graphicsQueue;
 		VkQueue m_presentQueue;
+		VkQueue m_transferQueue;
+		VkQueue m_computeQueue;
 		VkCommandPool m_graphicsCommandPool;
 		VkDescriptorPool m_descriptorPool;
-		// VkPhysicalDeviceFeatures m_features;
-		// VkPhysicalDeviceFeatures m_enabledFeatures;
-		// VkPhysicalDeviceProperties m_properties;
+		// queues sharing a handle share the mutex, declared ahead of the upload manager that holds a reference
+		std::vector<std::pair<VkQueue, std::unique_ptr<std::mutex>>> m_queueMutexes;
+		std::unique_ptr<MemoryAllocator> m_allocator;
+		std::unique_ptr<UploadManager> m_uploadManager;
+		std::unique_ptr<PipelineCache> m_pipelineCache;
+		std::unique_ptr<DeletionQueue> m_deletionQueue;
+		VkPhysicalDeviceFeatures m_features;
+		VkPhysicalDeviceFeatures m_enabledFeatures;
+		VkPhysicalDeviceProperties m_properties;
 		uint32_t m_graphicsQueueFamilyIndex;
+		uint32_t m_transferQueueFamilyIndex;
+		uint32_t m_computeQueueFamilyIndex;
+		bool m_pipelineCreationFeedback = false;
 	};
 
 }
@@ -9,6 +9,8 @@
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
 
+#include "MemoryAllocator.h"
+
 namespace vulkan {
     // Util
     std::vector<char> readFile(const std::string& filename);
@@ -20,6 +22,13 @@ namespace vulkan {
     const bool enableValidationLayers = true;
 #endif
 
+    // load timings, asset and cache statistics on stdout
+#ifdef NDEBUG
+    const bool enableVerboseOutput = false;
+#else
+    const bool enableVerboseOutput = true;
+#endif
+
     const std::vector<const char*> validationLayers = {
         "VK_LAYER_KHRONOS_validation"
     };
@@ -31,56 +40,144 @@ namespace vulkan {
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        // a family without graphics and compute when there is one, its queues run alongside the graphics queue.
+        // both fall back to the graphics family
+        std::optional<uint32_t> transferFamily;
+        // a compute family without graphics when there is one
+        std::optional<uint32_t> computeFamily;
 
         bool isComplete() {
             return graphicsFamily.has_value() && presentFamily.has_value();
         }
     };
 
+    /**
+    * @QueueOwnershipTransfer: hands exclusive buffers and images from one queue family to another.
+    *   recordRelease() goes into a command buffer of the source queue, recordAcquire() into one of the destination queue
+    *   that is submitted waiting for the release's submission. Image layouts change once, between the two halves.
+    *   With equal families recordRelease() is an ordinary barrier from srcStage to dstStage and recordAcquire() records nothing.
+    */
+    struct QueueOwnershipTransfer {
+        uint32_t srcFamily = VK_QUEUE_FAMILY_IGNORED;
+        uint32_t dstFamily = VK_QUEUE_FAMILY_IGNORED;
+        VkPipelineStageFlags srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        VkAccessFlags srcAccess = VK_ACCESS_TRANSFER_WRITE_BIT;
+        VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkAccessFlags dstAccess = VK_ACCESS_MEMORY_READ_BIT;
+
+        std::vector<VkBufferMemoryBarrier> buffers;
+        std::vector<VkImageMemoryBarrier> images;
+
+        // whole buffer, adding a buffer twice is a no-op
+        void addBuffer(VkBuffer buffer);
+        // every mip level of a single layer color image, adding an image twice keeps the first layouts
+        void addImage(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels = 1);
+
+        bool isOwnershipTransfer() const;
+        bool empty() const;
+        void clear();
+
+        void recordRelease(VkCommandBuffer commandBuffer) const;
+        void recordAcquire(VkCommandBuffer commandBuffer) const;
+    };
+
     struct SwapChainSupportDetails {
         VkSurfaceCapabilitiesKHR capabilities;
         std::vector<VkSurfaceFormatKHR> formats;
         std::vector<VkPresentModeKHR> presentModes;
     };
 
+    // cpu side vertex as imported, the gpu copy is encoded through a VertexLayout
     struct Vertex {
         glm::vec3 pos;
         glm::vec3 color;
         glm::vec2 texCoord;
+        glm::vec3 normal;
+
+        bool operator==(const Vertex& other) const {
+            return pos == other.pos && color == other.color && texCoord == other.texCoord && normal == other.normal;
+        }
+    };
+
+    // vertex streams occupy bindings 0..MAX_VERTEX_STREAMS-1, per-instance data follows
+    const uint32_t MAX_VERTEX_STREAMS = 4;
+
+    struct MeshBounds {
+        glm::vec3 min = glm::vec3(0.0f);
+        glm::vec3 max = glm::vec3(0.0f);
+        // bounding sphere around the box center
+        glm::vec3 center = glm::vec3(0.0f);
+        float radius = 0.0f;
+    };
+
+    /**
+    * @Meshlet: a cluster of at most 64 vertices and 124 triangles, drawn as a contiguous range of the mesh's index buffer.
+    *   The normal cone bounds the cluster's face normals, from every eye with
+    *   dot(center - eye, coneAxis) >= coneCutoff * length(center - eye) + radius all of its triangles face away.
+    *   A coneCutoff of 1 never passes that test.
+    */
+    struct Meshlet {
+        glm::vec3 center;
+        float radius;
+        glm::vec3 coneAxis;
+        float coneCutoff;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        uint32_t vertexCount;
+        uint32_t padding;
+    };
+
+    const uint32_t MAX_MESH_LODS = 8;
+
+    /**
+    * @MeshLod: one level of detail, a range of the mesh's index buffer over the shared vertex buffer and the range of
+    *   meshlets splitting it. error is the object space distance the level may deviate from the full mesh.
+    */
+    struct MeshLod {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        uint32_t firstMeshlet;
+        uint32_t meshletCount;
+        float error;
+        uint32_t padding;
+    };
+
+    // cpu side geometry, as produced by the importers and consumed by Mesh::load
+    struct MeshData {
+        std::vector<Vertex> vertices;
+        // every lod's indices back to back, lod 0 first
+        std::vector<uint32_t> indices;
+        // empty until MeshletBuilder::build ran
+        std::vector<Meshlet> meshlets;
+        // empty until MeshSimplifier::generateLods ran, a mesh without lods is a single level over all indices
+        std::vector<MeshLod> lods;
+    };
+
+    // per-instance vertex stream, a mat4 occupies locations 3..6
+    struct InstanceData {
+        glm::mat4 model;
 
         static VkVertexInputBindingDescription getBindingDescription() {
             VkVertexInputBindingDescription bindingDescription{};
-            bindingDescription.binding = 0;
-            bindingDescription.stride = sizeof(Vertex);
-            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+            bindingDescription.binding = MAX_VERTEX_STREAMS;
+            bindingDescription.stride = sizeof(InstanceData);
+            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 
             return bindingDescription;
         }
 
-        static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
-            std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
-
-            attributeDescriptions[0].binding = 0;
-            attributeDescriptions[0].location = 0;
-            attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attributeDescriptions[0].offset = offsetof(Vertex, pos);
+        static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions() {
+            std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
 
-            attributeDescriptions[1].binding = 0;
-            attributeDescriptions[1].location = 1;
-            attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-            attributeDescriptions[2].binding = 0;
-            attributeDescriptions[2].location = 2;
-            attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-            attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
+            for (uint32_t i = 0; i < 4; i++) {
+                attributeDescriptions[i].binding = MAX_VERTEX_STREAMS;
+                attributeDescriptions[i].location = 3 + i;
+                attributeDescriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+                attributeDescriptions[i].offset = offsetof(InstanceData, model) + sizeof(glm::vec4) * i;
+            }
 
             return attributeDescriptions;
         }
-
-        bool operator==(const Vertex& other) const {
-            return pos == other.pos && color == other.color && texCoord == other.texCoord;
-        }
     };
 
     struct UniformBufferObject {
@@ -112,23 +209,28 @@ namespace vulkan {
 
     VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
 
-    void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkBufferCreateInfo bufferInfo, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-
-    VkCommandBuffer beginSingleTimeCommands(VkDevice device, VkCommandPool commandPool);
-
-    void endSingleTimeCommands(VkDevice device, VkQueue graphicsQueue, VkCommandPool commandPool, VkCommandBuffer commandBuffer);
+    void createBuffer(MemoryAllocator& allocator, VkDevice device, VkBufferCreateInfo bufferInfo, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory, AllocationStrategy strategy = AllocationStrategy::FreeList);
 
     bool isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface);
 
-    void copyBuffer(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-
-    void createImage(VkPhysicalDevice physicalDevice, VkDevice device, const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+    void createImage(MemoryAllocator& allocator, VkDevice device, const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocation& imageMemory);
     
     VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
 
-    void transitionImageLayout(VkDevice device, VkQueue graphicsQueue, VkCommandPool commandPool, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
+    void recordImageLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels = 1);
+
+    // width and height of the level, not of the image
+    void recordCopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDeviceSize bufferOffset = 0, uint32_t mipLevel = 0);
+
+    // bytes of one tightly packed level
+    VkDeviceSize getImageLevelSize(VkFormat format, uint32_t width, uint32_t height);
+
+    // vkCmdBlitImage with a linear filter needs all three on optimal tiling
+    bool supportsLinearBlit(VkPhysicalDevice physicalDevice, VkFormat format);
 
-    void copyBufferToImage(VkDevice device, VkQueue graphicsQueue, VkCommandPool commandPool, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+    // every level in TRANSFER_DST_OPTIMAL with level 0 written by a transfer, each level is blitted from the one above.
+    // leaves the whole chain in SHADER_READ_ONLY_OPTIMAL for fragment shaders, needs a graphics queue
+    void recordGenerateMipmaps(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels);
 
     VkShaderModule createShaderModule(VkDevice device, const std::vector<char>& code);
 
@@ -0,0 +1,449 @@
+#include "BlockCompressor.h"
+#include "JobSystem.h"
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+namespace vulkan {
+    namespace {
+        const uint32_t BLOCK_TEXELS = 16;
+        const uint32_t POWER_ITERATIONS = 8;
+        // rows of blocks per job
+        const uint32_t ROW_GRAIN = 4;
+
+        // bc7 4 bit index weights out of 64
+        const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+        struct BitWriter {
+            uint8_t* data;
+            uint32_t position = 0;
+
+            // least significant bit first, the order every bc format packs its fields in
+            void write(uint32_t value, uint32_t count)
+            {
+                for (uint32_t i = 0; i < count; i++, position++) {
+                    if (value & (1u << i)) {
+                        data[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+                    }
+                }
+            }
+        };
+
+        // principal axis over the first channels of the texels, zero when they are all equal
+        void computeAxis(const float texels[][4], uint32_t channels, float mean[4], float axis[4])
+        {
+            float lo[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+            float hi[4] = {};
+            for (uint32_t c = 0; c < channels; c++) {
+                mean[c] = 0.0f;
+                for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                    mean[c] += texels[i][c];
+                    lo[c] = std::min(lo[c], texels[i][c]);
+                    hi[c] = std::max(hi[c], texels[i][c]);
+                }
+                mean[c] /= BLOCK_TEXELS;
+            }
+
+            float covariance[4][4] = {};
+            for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                for (uint32_t a = 0; a < channels; a++) {
+                    for (uint32_t b = 0; b < channels; b++) {
+                        covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+                    }
+                }
+            }
+
+            // power iteration, starting from the bounding box diagonal converges in a few steps
+            for (uint32_t c = 0; c < channels; c++) {
+                axis[c] = hi[c] - lo[c];
+            }
+            for (uint32_t iteration = 0; iteration < POWER_ITERATIONS; iteration++) {
+                float next[4] = {};
+                float length = 0.0f;
+                for (uint32_t a = 0; a < channels; a++) {
+                    for (uint32_t b = 0; b < channels; b++) {
+                        next[a] += covariance[a][b] * axis[b];
+                    }
+                    length += next[a] * next[a];
+                }
+                length = std::sqrt(length);
+                if (length < 1e-6f) {
+                    break;
+                }
+                for (uint32_t c = 0; c < channels; c++) {
+                    axis[c] = next[c] / length;
+                }
+            }
+
+            float length = 0.0f;
+            for (uint32_t c = 0; c < channels; c++) {
+                length += axis[c] * axis[c];
+            }
+            length = std::sqrt(length);
+            for (uint32_t c = 0; c < channels; c++) {
+                axis[c] = length < 1e-6f ? 0.0f : axis[c] / length;
+            }
+        }
+
+        // endpoints spanning the texels projected onto the principal axis
+        void computeEndpoints(const float texels[][4], uint32_t channels, float lo[4], float hi[4])
+        {
+            float mean[4];
+            float axis[4];
+            computeAxis(texels, channels, mean, axis);
+
+            float tmin = 0.0f;
+            float tmax = 0.0f;
+            for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                float t = 0.0f;
+                for (uint32_t c = 0; c < channels; c++) {
+                    t += (texels[i][c] - mean[c]) * axis[c];
+                }
+                tmin = std::min(tmin, t);
+                tmax = std::max(tmax, t);
+            }
+
+            for (uint32_t c = 0; c < channels; c++) {
+                lo[c] = std::clamp(mean[c] + tmin * axis[c], 0.0f, 255.0f);
+                hi[c] = std::clamp(mean[c] + tmax * axis[c], 0.0f, 255.0f);
+            }
+        }
+
+        // least squares endpoints for texels that interpolate from lo to hi by weights, false when the system is singular
+        bool refineEndpoints(const float texels[][4], uint32_t channels, const float weights[16], float lo[4], float hi[4])
+        {
+            float aa = 0.0f;
+            float ab = 0.0f;
+            float bb = 0.0f;
+            float ax[4] = {};
+            float bx[4] = {};
+            for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                const float b = weights[i];
+                const float a = 1.0f - b;
+                aa += a * a;
+                ab += a * b;
+                bb += b * b;
+                for (uint32_t c = 0; c < channels; c++) {
+                    ax[c] += a * texels[i][c];
+                    bx[c] += b * texels[i][c];
+                }
+            }
+
+            const float determinant = aa * bb - ab * ab;
+            if (std::abs(determinant) < 1e-6f) {
+                return false;
+            }
+            for (uint32_t c = 0; c < channels; c++) {
+                lo[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+                hi[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+            }
+            return true;
+        }
+
+        uint32_t findNearest(const float texel[4], const int palette[][4], uint32_t paletteSize, uint32_t channels, float& error)
+        {
+            uint32_t best = 0;
+            error = 1e30f;
+            for (uint32_t p = 0; p < paletteSize; p++) {
+                float distance = 0.0f;
+                for (uint32_t c = 0; c < channels; c++) {
+                    float d = texel[c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < error) {
+                    error = distance;
+                    best = p;
+                }
+            }
+            return best;
+        }
+
+        uint16_t packRgb565(const float color[4])
+        {
+            uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+            uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+            uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+            return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+        }
+
+        void unpackRgb565(uint16_t packed, int color[4])
+        {
+            int r = (packed >> 11) & 31;
+            int g = (packed >> 5) & 63;
+            int b = packed & 31;
+            color[0] = (r << 3) | (r >> 2);
+            color[1] = (g << 2) | (g >> 4);
+            color[2] = (b << 3) | (b >> 2);
+            color[3] = 255;
+        }
+
+        struct ColorBlock {
+            uint16_t color0;
+            uint16_t color1;
+            uint32_t indices[16];
+            float error;
+        };
+
+        ColorBlock evaluateColorBlock(const float texels[][4], const float lo[4], const float hi[4])
+        {
+            ColorBlock block;
+            block.color0 = packRgb565(hi);
+            block.color1 = packRgb565(lo);
+
+            int palette[4][4];
+            unpackRgb565(block.color0, palette[0]);
+            unpackRgb565(block.color1, palette[1]);
+            for (uint32_t c = 0; c < 3; c++) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+
+            block.error = 0.0f;
+            for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                float error;
+                block.indices[i] = findNearest(texels[i], palette, 4, 3, error);
+                block.error += error;
+            }
+            return block;
+        }
+
+        // four color mode only, bc3 decodes its color block that way whatever the endpoint order
+        void encodeColorBlock(const float texels[][4], uint8_t* out)
+        {
+            float lo[4];
+            float hi[4];
+            computeEndpoints(texels, 3, lo, hi);
+            ColorBlock best = evaluateColorBlock(texels, lo, hi);
+
+            // weight of color1 for every index
+            const float indexWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+            float weights[16];
+            for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                weights[i] = indexWeights[best.indices[i]];
+            }
+            if (refineEndpoints(texels, 3, weights, hi, lo)) {
+                ColorBlock refined = evaluateColorBlock(texels, lo, hi);
+                if (refined.error < best.error) {
+                    best = refined;
+                }
+            }
+
+            // color0 > color1 selects four colors, equal endpoints decode index 0 in both modes
+            if (best.color0 < best.color1) {
+                std::swap(best.color0, best.color1);
+                for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                    best.indices[i] ^= 1;
+                }
+            }
+            else if (best.color0 == best.color1) {
+                std::fill(best.indices, best.indices + BLOCK_TEXELS, 0);
+            }
+
+            std::fill(out, out + 8, 0);
+            BitWriter writer{ out };
+            writer.write(best.color0, 16);
+            writer.write(best.color1, 16);
+            for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                writer.write(best.indices[i], 2);
+            }
+        }
+
+        // bc4 block of one channel, the eight value mode since min and max are always the endpoints
+        void encodeChannelBlock(const float texels[][4], uint32_t channel, uint8_t* out)
+        {
+            float lo = 255.0f;
+            float hi = 0.0f;
+            for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                lo = std::min(lo, texels[i][channel]);
+                hi = std::max(hi, texels[i][channel]);
+            }
+
+            const int value0 = static_cast<int>(hi + 0.5f);
+            const int value1 = static_cast<int>(lo + 0.5f);
+
+            int palette[8][4] = {};
+            palette[0][0] = value0;
+            palette[1][0] = value1;
+            for (int i = 2; i < 8; i++) {
+                palette[i][0] = ((8 - i) * value0 + (i - 1) * value1) / 7;
+            }
+
+            std::fill(out, out + 8, 0);
+            BitWriter writer{ out };
+            writer.write(value0, 8);
+            writer.write(value1, 8);
+            for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                float texel[4] = { texels[i][channel] };
+                float error;
+                writer.write(value0 == value1 ? 0 : findNearest(texel, palette, 8, 1, error), 3);
+            }
+        }
+
+        struct Mode6Block {
+            // 7 bit endpoints with the p-bit appended
+            int endpoint0[4];
+            int endpoint1[4];
+            uint32_t indices[16];
+            float error;
+        };
+
+        Mode6Block evaluateMode6Block(const float texels[][4], const float lo[4], const float hi[4])
+        {
+            Mode6Block best;
+            best.error = 1e30f;
+
+            // every p-bit is shared by all four channels of its endpoint, each combination is tried
+            for (int pbits = 0; pbits < 4; pbits++) {
+                Mode6Block block;
+                for (uint32_t c = 0; c < 4; c++) {
+                    const int p0 = pbits & 1;
+                    const int p1 = pbits >> 1;
+                    block.endpoint0[c] = std::clamp(static_cast<int>(std::lround((lo[c] - p0) * 0.5f)), 0, 127) * 2 + p0;
+                    block.endpoint1[c] = std::clamp(static_cast<int>(std::lround((hi[c] - p1) * 0.5f)), 0, 127) * 2 + p1;
+                }
+
+                int palette[16][4];
+                for (uint32_t i = 0; i < 16; i++) {
+                    for (uint32_t c = 0; c < 4; c++) {
+                        palette[i][c] = ((64 - BC7_WEIGHTS[i]) * block.endpoint0[c] + BC7_WEIGHTS[i] * block.endpoint1[c] + 32) >> 6;
+                    }
+                }
+
+                block.error = 0.0f;
+                for (uint32_t i = 0; i < BLOCK_TEXELS && block.error < best.error; i++) {
+                    float error;
+                    block.indices[i] = findNearest(texels[i], palette, 16, 4, error);
+                    block.error += error;
+                }
+                if (block.error < best.error) {
+                    best = block;
+                }
+            }
+            return best;
+        }
+
+        void encodeMode6Block(const float texels[][4], uint8_t* out)
+        {
+            float lo[4];
+            float hi[4];
+            computeEndpoints(texels, 4, lo, hi);
+            Mode6Block best = evaluateMode6Block(texels, lo, hi);
+
+            float weights[16];
+            for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                weights[i] = BC7_WEIGHTS[best.indices[i]] / 64.0f;
+            }
+            if (refineEndpoints(texels, 4, weights, lo, hi)) {
+                Mode6Block refined = evaluateMode6Block(texels, lo, hi);
+                if (refined.error < best.error) {
+                    best = refined;
+                }
+            }
+
+            // the anchor index drops its top bit, so the first texel has to sit in the lower half
+            if (best.indices[0] & 8) {
+                std::swap(best.endpoint0, best.endpoint1);
+                for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                    best.indices[i] = 15 - best.indices[i];
+                }
+            }
+
+            std::fill(out, out + 16, 0);
+            BitWriter writer{ out };
+            // mode 6 is six zero bits followed by a one
+            writer.write(1u << 6, 7);
+            for (uint32_t c = 0; c < 4; c++) {
+                writer.write(best.endpoint0[c] >> 1, 7);
+                writer.write(best.endpoint1[c] >> 1, 7);
+            }
+            writer.write(best.endpoint0[0] & 1, 1);
+            writer.write(best.endpoint1[0] & 1, 1);
+            for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                writer.write(best.indices[i], i == 0 ? 3 : 4);
+            }
+        }
+    }
+
+    uint32_t BlockCompressor::getBlockSize(BlockFormat format)
+    {
+        switch (format) {
+        case BlockFormat::BC1:
+            return 8;
+        case BlockFormat::BC3:
+        case BlockFormat::BC5:
+        case BlockFormat::BC7:
+            return 16;
+        }
+        throw std::invalid_argument("unsupported block format!");
+    }
+
+    size_t BlockCompressor::getCompressedSize(BlockFormat format, uint32_t width, uint32_t height)
+    {
+        const size_t blocksX = (width + BLOCK_DIM - 1) / BLOCK_DIM;
+        const size_t blocksY = (height + BLOCK_DIM - 1) / BLOCK_DIM;
+        return blocksX * blocksY * getBlockSize(format);
+    }
+
+    std::vector<uint8_t> BlockCompressor::compress(const uint8_t* pixels, uint32_t width, uint32_t height, BlockFormat format, JobSystem* jobs)
+    {
+        const uint32_t blocksX = (width + BLOCK_DIM - 1) / BLOCK_DIM;
+        const uint32_t blocksY = (height + BLOCK_DIM - 1) / BLOCK_DIM;
+        const uint32_t blockSize = getBlockSize(format);
+
+        std::vector<uint8_t> blocks(getCompressedSize(format, width, height));
+
+        auto compressRows = [&](uint32_t first, uint32_t last) {
+            uint8_t texels[BLOCK_TEXELS * 4];
+            for (uint32_t by = first; by < last; by++) {
+                for (uint32_t bx = 0; bx < blocksX; bx++) {
+                    for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                        const uint32_t x = std::min(bx * BLOCK_DIM + i % BLOCK_DIM, width - 1);
+                        const uint32_t y = std::min(by * BLOCK_DIM + i / BLOCK_DIM, height - 1);
+                        std::copy_n(pixels + (static_cast<size_t>(y) * width + x) * 4, 4, texels + i * 4);
+                    }
+                    compressBlock(texels, format, blocks.data() + (static_cast<size_t>(by) * blocksX + bx) * blockSize);
+                }
+            }
+        };
+
+        if (jobs) {
+            jobs->parallelFor(blocksY, ROW_GRAIN, compressRows);
+        }
+        else {
+            compressRows(0, blocksY);
+        }
+
+        return blocks;
+    }
+
+    void BlockCompressor::compressBlock(const uint8_t* texels, BlockFormat format, uint8_t* block)
+    {
+        float values[BLOCK_TEXELS][4];
+        for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+            for (uint32_t c = 0; c < 4; c++) {
+                values[i][c] = texels[i * 4 + c];
+            }
+        }
+
+        switch (format) {
+        case BlockFormat::BC1:
+            encodeColorBlock(values, block);
+            break;
+        case BlockFormat::BC3:
+            encodeChannelBlock(values, 3, block);
+            encodeColorBlock(values, block + 8);
+            break;
+        case BlockFormat::BC5:
+            encodeChannelBlock(values, 0, block);
+            encodeChannelBlock(values, 1, block + 8);
+            break;
+        case BlockFormat::BC7:
+            encodeMode6Block(values, block);
+            break;
+        default:
+            throw std::invalid_argument("unsupported block format!");
+        }
+    }
+
+}
@@ -5,37 +5,15 @@
 #include "VkUtil.h"
 
 namespace vulkan {
-	Buffer::Buffer(VkPhysicalDevice physicalDevice, VkDevice device, const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags requiredFlags)
-		: m_physicalDevice(physicalDevice), m_device(device), m_size(createInfo.size), m_mappedPtr() 
+	Buffer::Buffer(MemoryAllocator& allocator, VkDevice device, const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags requiredFlags, AllocationStrategy strategy)
+		: m_allocator(allocator), m_device(device), m_size(createInfo.size), m_mappedPtr() 
 	{
-        createBuffer(createInfo, requiredFlags, m_buffer, m_memory);
+        createBuffer(m_allocator, m_device, createInfo, requiredFlags, m_buffer, m_memory, strategy);
 	}
 
     Buffer::~Buffer() {
         vkDestroyBuffer(m_device, m_buffer, nullptr);
-        vkFreeMemory(m_device, m_memory, nullptr);
-    }
-
-    void Buffer::createBuffer(const VkBufferCreateInfo& bufferInfo, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
-        if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create buffer!");
-        }
-
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(m_device, buffer, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(m_physicalDevice, memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(m_device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate buffer memory!");
-        }
-
-        if (vkBindBufferMemory(m_device, buffer, bufferMemory, 0) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate buffer memory!");
-        }
+        m_allocator.free(m_memory);
     }
 
     VkBuffer Buffer::getBuffer() const
@@ -45,7 +23,12 @@ namespace vulkan {
     
     VkDeviceMemory Buffer::getMemory() const
     {
-        return m_memory;
+        return m_memory.memory;
+    }
+
+    VkDeviceSize Buffer::getOffset() const
+    {
+        return m_memory.offset;
     }
     
     size_t Buffer::getSize() const
@@ -55,23 +38,20 @@ namespace vulkan {
     
     uint8_t* Buffer::map()
     {
+        // host visible blocks are persistently mapped by the allocator, mapping is just a lookup
         if (!m_mappedPtr)
         {
-            if (vkMapMemory(m_device, m_memory, 0, m_size, 0, (void**)&m_mappedPtr) != VK_SUCCESS)
+            if (!m_memory.mapped)
             {
                 throw std::runtime_error("Failed to map constant buffer memory!");
             }
+            m_mappedPtr = m_memory.mapped;
         }
         return m_mappedPtr;
     }
     
     void Buffer::unmap()
     {
-        if (m_mappedPtr)
-        {
-            vkUnmapMemory(m_device, m_memory);
-            m_mappedPtr = nullptr;
-        }
+        m_mappedPtr = nullptr;
     }
 }
-
@@ -0,0 +1,111 @@
+#include "CommandRecorder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "JobSystem.h"
+
+namespace vulkan {
+    CommandRecorder::CommandRecorder(VkDevice device, uint32_t queueFamilyIndex, JobSystem& jobs)
+        : m_device(device), m_jobs(jobs)
+    {
+        m_contexts.resize(m_jobs.getThreadCount());
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        // buffers are never reset individually, the whole pool is reset per frame
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+        for (ThreadContext& context : m_contexts) {
+            for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+                if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &context.commandPools[frame]) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create recording command pool!");
+                }
+                context.usedBuffers[frame] = 0;
+            }
+        }
+    }
+
+    CommandRecorder::~CommandRecorder()
+    {
+        for (ThreadContext& context : m_contexts) {
+            for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+                vkDestroyCommandPool(m_device, context.commandPools[frame], nullptr);
+            }
+        }
+    }
+
+    void CommandRecorder::beginFrame(uint32_t frameIndex)
+    {
+        for (ThreadContext& context : m_contexts) {
+            vkResetCommandPool(m_device, context.commandPools[frameIndex], 0);
+            context.usedBuffers[frameIndex] = 0;
+        }
+    }
+
+    const std::vector<VkCommandBuffer>& CommandRecorder::record(uint32_t frameIndex, uint32_t itemCount,
+        const VkCommandBufferInheritanceInfo& inheritanceInfo, const RecordFunc& recordFunc)
+    {
+        uint32_t sliceCount = (itemCount + MIN_ITEMS_PER_SLICE - 1) / MIN_ITEMS_PER_SLICE;
+        sliceCount = std::max(std::min(sliceCount, m_jobs.getThreadCount()), 1u);
+
+        m_sliceBuffers.assign(sliceCount, VK_NULL_HANDLE);
+
+        JobCounter counter;
+        for (uint32_t slice = 0; slice < sliceCount; slice++) {
+            m_jobs.run([&, slice] {
+                uint32_t first = static_cast<uint32_t>((uint64_t)itemCount * slice / sliceCount);
+                uint32_t last = static_cast<uint32_t>((uint64_t)itemCount * (slice + 1) / sliceCount);
+
+                VkCommandBuffer commandBuffer = acquireCommandBuffer(frameIndex);
+
+                VkCommandBufferBeginInfo beginInfo{};
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+                beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+                if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to begin recording secondary command buffer!");
+                }
+
+                recordFunc(commandBuffer, first, last);
+
+                if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to record secondary command buffer!");
+                }
+
+                m_sliceBuffers[slice] = commandBuffer;
+            }, &counter);
+        }
+
+        m_jobs.wait(counter);
+
+        return m_sliceBuffers;
+    }
+
+    VkCommandBuffer CommandRecorder::acquireCommandBuffer(uint32_t frameIndex)
+    {
+        // slices only run as jobs, so this is always a pool thread
+        ThreadContext& context = m_contexts[m_jobs.getThreadIndex()];
+        std::vector<VkCommandBuffer>& buffers = context.commandBuffers[frameIndex];
+        uint32_t& used = context.usedBuffers[frameIndex];
+
+        if (used == buffers.size()) {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = context.commandPools[frameIndex];
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer commandBuffer;
+            if (vkAllocateCommandBuffers(m_device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate secondary command buffer!");
+            }
+            buffers.push_back(commandBuffer);
+        }
+
+        return buffers[used++];
+    }
+
+}
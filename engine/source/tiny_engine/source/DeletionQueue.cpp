@@ -0,0 +1,127 @@
+#include "DeletionQueue.h"
+
+#include <vector>
+
+namespace vulkan {
+    DeletionQueue::DeletionQueue(MemoryAllocator& allocator, VkDevice device)
+        : m_allocator(allocator), m_device(device)
+    {
+    }
+
+    DeletionQueue::~DeletionQueue()
+    {
+        vkDeviceWaitIdle(m_device);
+        release(~0ull);
+    }
+
+    void DeletionQueue::retire(VkBuffer buffer, const MemoryAllocation& memory)
+    {
+        push(Type::Buffer, (uint64_t)buffer, memory);
+    }
+
+    void DeletionQueue::retire(VkImage image, const MemoryAllocation& memory)
+    {
+        push(Type::Image, (uint64_t)image, memory);
+    }
+
+    void DeletionQueue::retire(VkImageView view)
+    {
+        push(Type::ImageView, (uint64_t)view);
+    }
+
+    void DeletionQueue::retire(VkFramebuffer framebuffer)
+    {
+        push(Type::Framebuffer, (uint64_t)framebuffer);
+    }
+
+    void DeletionQueue::retire(VkRenderPass renderPass)
+    {
+        push(Type::RenderPass, (uint64_t)renderPass);
+    }
+
+    void DeletionQueue::retire(VkSwapchainKHR swapChain)
+    {
+        push(Type::SwapChain, (uint64_t)swapChain);
+    }
+
+    void DeletionQueue::retire(std::function<void()> func)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.push_back({ m_frameValue, Type::Func, 0, MemoryAllocation{}, std::move(func) });
+    }
+
+    void DeletionQueue::push(Type type, uint64_t handle, const MemoryAllocation& memory)
+    {
+        if (handle == 0) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.push_back({ m_frameValue, type, handle, memory, nullptr });
+    }
+
+    void DeletionQueue::beginFrame(uint64_t frameValue)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frameValue = frameValue;
+    }
+
+    void DeletionQueue::release(uint64_t completedValue)
+    {
+        // destroyed outside the lock, a retired object's destructor may retire handles of its own
+        std::vector<Entry> released;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            while (!m_entries.empty() && m_entries.front().value <= completedValue) {
+                released.push_back(std::move(m_entries.front()));
+                m_entries.pop_front();
+            }
+            m_releasedCount += released.size();
+        }
+
+        // in retire order, owners retire framebuffers and views ahead of what they point at
+        for (Entry& entry : released) {
+            destroy(entry);
+        }
+    }
+
+    void DeletionQueue::destroy(Entry& entry)
+    {
+        switch (entry.type) {
+        case Type::Func:
+            entry.func();
+            break;
+        case Type::Framebuffer:
+            vkDestroyFramebuffer(m_device, (VkFramebuffer)entry.handle, nullptr);
+            break;
+        case Type::RenderPass:
+            vkDestroyRenderPass(m_device, (VkRenderPass)entry.handle, nullptr);
+            break;
+        case Type::ImageView:
+            vkDestroyImageView(m_device, (VkImageView)entry.handle, nullptr);
+            break;
+        case Type::Image:
+            vkDestroyImage(m_device, (VkImage)entry.handle, nullptr);
+            m_allocator.free(entry.memory);
+            break;
+        case Type::Buffer:
+            vkDestroyBuffer(m_device, (VkBuffer)entry.handle, nullptr);
+            m_allocator.free(entry.memory);
+            break;
+        case Type::SwapChain:
+            vkDestroySwapchainKHR(m_device, (VkSwapchainKHR)entry.handle, nullptr);
+            break;
+        }
+    }
+
+    DeletionQueueStats DeletionQueue::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        DeletionQueueStats stats{};
+        stats.pendingCount = static_cast<uint32_t>(m_entries.size());
+        stats.releasedCount = m_releasedCount;
+        return stats;
+    }
+
+}
@@ -0,0 +1,321 @@
+#include "DepthPyramid.h"
+
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+
+#include "VkUtil.h"
+#include "Buffer.h"
+#include "PipelineCache.h"
+#include "common_utils.h"
+
+namespace vulkan {
+    namespace {
+        const uint32_t GROUP_SIZE = 8;
+
+        struct PyramidParams {
+            int32_t srcSize[2];
+            int32_t dstSize[2];
+        };
+
+        uint32_t previousPowerOfTwo(uint32_t value) {
+            uint32_t result = 1;
+            while (result * 2 <= value) {
+                result *= 2;
+            }
+            return result;
+        }
+    }
+
+    DepthPyramid::DepthPyramid(MemoryAllocator& allocator, VkDevice device, PipelineCache& pipelineCache, VkImageView depthView, VkExtent2D depthExtent)
+        : m_allocator(allocator), m_device(device), m_depthView(depthView), m_depthExtent(depthExtent)
+    {
+        createPyramid();
+        createDescriptors();
+        createPipeline(pipelineCache);
+    }
+
+    DepthPyramid::~DepthPyramid()
+    {
+        destroy();
+    }
+
+    void DepthPyramid::createPyramid()
+    {
+        VkExtent2D extent = { previousPowerOfTwo(m_depthExtent.width), previousPowerOfTwo(m_depthExtent.height) };
+        while (true) {
+            m_levelExtents.push_back(extent);
+            if (extent.width == 1 && extent.height == 1) {
+                break;
+            }
+            extent = { std::max(extent.width / 2, 1u), std::max(extent.height / 2, 1u) };
+        }
+
+        // nearest, the shader only uses texelFetch
+        VkSamplerCreateInfo samplerInfo{ VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.maxLod = 0.0f;
+
+        if (vkCreateSampler(m_device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create depth pyramid sampler!");
+        }
+
+        m_readbackLevel = 0;
+        while (std::max(m_levelExtents[m_readbackLevel].width, m_levelExtents[m_readbackLevel].height) > READBACK_SIZE) {
+            m_readbackLevel++;
+        }
+
+        const VkExtent2D& readbackExtent = m_levelExtents[m_readbackLevel];
+        for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+            VkBufferCreateInfo createInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+            createInfo.size = readbackExtent.width * readbackExtent.height * sizeof(float);
+            createInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            m_readbackBuffers[frame] = std::make_unique<Buffer>(m_allocator, m_device, createInfo,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            m_readbackData[frame] = reinterpret_cast<const float*>(m_readbackBuffers[frame]->map());
+        }
+    }
+
+    void DepthPyramid::createDescriptors()
+    {
+        std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+        bindings[0].binding = 0;
+        bindings[0].descriptorCount = 1;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorCount = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+
+        if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create depth pyramid descriptor set layout!");
+        }
+
+        const uint32_t levelCount = getLevelCount();
+
+        std::array<VkDescriptorPoolSize, 2> poolSizes{};
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        poolSizes[0].descriptorCount = levelCount;
+        poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        poolSizes[1].descriptorCount = levelCount;
+
+        VkDescriptorPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.maxSets = levelCount;
+
+        if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create depth pyramid descriptor pool!");
+        }
+
+        std::vector<VkDescriptorSetLayout> layouts(levelCount, m_descriptorSetLayout);
+        VkDescriptorSetAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+        allocInfo.descriptorPool = m_descriptorPool;
+        allocInfo.descriptorSetCount = levelCount;
+        allocInfo.pSetLayouts = layouts.data();
+
+        m_descriptorSets.resize(levelCount);
+        if (vkAllocateDescriptorSets(m_device, &allocInfo, m_descriptorSets.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate depth pyramid descriptor sets!");
+        }
+    }
+
+    void DepthPyramid::createPipeline(PipelineCache& pipelineCache)
+    {
+        auto source_path = Utils::getCurrentProcessDirectory().parent_path().parent_path();
+        auto comp_shader_path = source_path / "engine/shaders/depth_pyramid.spv";
+
+        auto compShaderCode = readFile(comp_shader_path.string().data());
+        VkShaderModule compShaderModule = createShaderModule(m_device, compShaderCode);
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(PyramidParams);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create depth pyramid pipeline layout!");
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = compShaderModule;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = m_pipelineLayout;
+
+        m_pipeline = pipelineCache.createComputePipeline(pipelineInfo);
+
+        vkDestroyShaderModule(m_device, compShaderModule, nullptr);
+    }
+
+    void DepthPyramid::destroy()
+    {
+        vkDestroyPipeline(m_device, m_pipeline, nullptr);
+        vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+        vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+        vkDestroySampler(m_device, m_sampler, nullptr);
+
+        destroyViews();
+    }
+
+    void DepthPyramid::destroyViews()
+    {
+        for (VkImageView view : m_levelViews) {
+            vkDestroyImageView(m_device, view, nullptr);
+        }
+        m_levelViews.clear();
+    }
+
+    RenderGraphImageDesc DepthPyramid::getImageDesc() const
+    {
+        RenderGraphImageDesc desc{};
+        desc.format = VK_FORMAT_R32_SFLOAT;
+        desc.extent = m_levelExtents[0];
+        desc.mipLevels = getLevelCount();
+        return desc;
+    }
+
+    void DepthPyramid::setImage(VkImage image)
+    {
+        // the graph waits for the device before it replaces its images, so the old views are no longer in use
+        destroyViews();
+        m_image = image;
+
+        m_levelViews.resize(m_levelExtents.size());
+        for (uint32_t level = 0; level < m_levelViews.size(); level++) {
+            VkImageViewCreateInfo viewInfo{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+            viewInfo.image = m_image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = VK_FORMAT_R32_SFLOAT;
+            viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+
+            if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_levelViews[level]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create depth pyramid view!");
+            }
+        }
+
+        for (uint32_t level = 0; level < getLevelCount(); level++) {
+            VkDescriptorImageInfo srcInfo{};
+            srcInfo.sampler = m_sampler;
+            srcInfo.imageView = level == 0 ? m_depthView : m_levelViews[level - 1];
+            srcInfo.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+            VkDescriptorImageInfo dstInfo{};
+            dstInfo.imageView = m_levelViews[level];
+            dstInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+            std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[0].dstSet = m_descriptorSets[level];
+            descriptorWrites[0].dstBinding = 0;
+            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            descriptorWrites[0].descriptorCount = 1;
+            descriptorWrites[0].pImageInfo = &srcInfo;
+
+            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[1].dstSet = m_descriptorSets[level];
+            descriptorWrites[1].dstBinding = 1;
+            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            descriptorWrites[1].descriptorCount = 1;
+            descriptorWrites[1].pImageInfo = &dstInfo;
+
+            vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+        }
+    }
+
+    void DepthPyramid::recordReduce(VkCommandBuffer commandBuffer)
+    {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+
+        VkExtent2D srcExtent = m_depthExtent;
+        for (uint32_t level = 0; level < getLevelCount(); level++) {
+            const VkExtent2D& dstExtent = m_levelExtents[level];
+
+            // the previous level's writes become visible to this level's reads
+            if (level > 0) {
+                VkImageMemoryBarrier barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+                barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+                barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = m_image;
+                barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 1, 0, 1 };
+
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    0, 0, nullptr, 0, nullptr, 1, &barrier);
+            }
+
+            PyramidParams params{};
+            params.srcSize[0] = static_cast<int32_t>(srcExtent.width);
+            params.srcSize[1] = static_cast<int32_t>(srcExtent.height);
+            params.dstSize[0] = static_cast<int32_t>(dstExtent.width);
+            params.dstSize[1] = static_cast<int32_t>(dstExtent.height);
+
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSets[level], 0, nullptr);
+            vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+            vkCmdDispatch(commandBuffer, (dstExtent.width + GROUP_SIZE - 1) / GROUP_SIZE, (dstExtent.height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+
+            srcExtent = dstExtent;
+        }
+    }
+
+    void DepthPyramid::recordReadback(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::mat4& viewProjection)
+    {
+        VkBufferImageCopy region{};
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, m_readbackLevel, 0, 1 };
+        region.imageExtent = { m_levelExtents[m_readbackLevel].width, m_levelExtents[m_readbackLevel].height, 1 };
+        vkCmdCopyImageToBuffer(commandBuffer, m_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_readbackBuffers[frameIndex]->getBuffer(), 1, &region);
+
+        m_readbackViewProjections[frameIndex] = viewProjection;
+        m_readbackValid[frameIndex] = true;
+    }
+
+    VkBuffer DepthPyramid::getReadbackBuffer(uint32_t frameIndex) const
+    {
+        return m_readbackBuffers[frameIndex]->getBuffer();
+    }
+
+    DepthReadback DepthPyramid::getReadback(uint32_t frameIndex) const
+    {
+        DepthReadback readback{};
+        readback.depth = m_readbackData[frameIndex];
+        readback.width = m_levelExtents[m_readbackLevel].width;
+        readback.height = m_levelExtents[m_readbackLevel].height;
+        readback.viewProjection = m_readbackViewProjections[frameIndex];
+        readback.valid = m_readbackValid[frameIndex];
+        return readback;
+    }
+
+    uint32_t DepthPyramid::getLevelCount() const
+    {
+        return static_cast<uint32_t>(m_levelExtents.size());
+    }
+
+    VkExtent2D DepthPyramid::getExtent(uint32_t level) const
+    {
+        return m_levelExtents[level];
+    }
+
+}
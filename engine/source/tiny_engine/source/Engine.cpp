@@ -3,7 +3,7 @@
 namespace vulkan {
 	Engine::Engine()
 		: m_window(WIDTH, HEIGHT, "Vk Engine Demo"),
-			m_renderer((GLFWwindow*)m_window.getWindowHandle(), WIDTH, HEIGHT)
+			m_renderer((GLFWwindow*)m_window.getWindowHandle(), WIDTH, HEIGHT, m_jobs)
 	{
 	}
 
@@ -12,6 +12,7 @@ namespace vulkan {
 		while (!m_window.shouldClose()) {
 			if (!m_window.isIconified()) {
 				m_window.PollEvents();
+				m_jobs.pumpMainThread();
 				m_renderer.Render(WIDTH, HEIGHT, m_window.getUserInput());
 			}
 		}
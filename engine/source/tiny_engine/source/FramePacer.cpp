@@ -0,0 +1,199 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "DeletionQueue.h"
+
+namespace vulkan {
+    FramePacer::FramePacer(VkDevice device, DeletionQueue& deletionQueue)
+        : m_device(device), m_deletionQueue(deletionQueue)
+    {
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        timelineInfo.pNext = &typeInfo;
+
+        if (vkCreateSemaphore(m_device, &timelineInfo, nullptr, &m_timeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timeline semaphore!");
+        }
+
+        m_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+        m_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]) != VK_SUCCESS ||
+                vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create semaphores!");
+            }
+        }
+    }
+
+    FramePacer::~FramePacer()
+    {
+        wait(m_submittedValue);
+        m_deletionQueue.release(m_submittedValue);
+
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            vkDestroySemaphore(m_device, m_renderFinishedSemaphores[i], nullptr);
+            vkDestroySemaphore(m_device, m_imageAvailableSemaphores[i], nullptr);
+        }
+        vkDestroySemaphore(m_device, m_timeline, nullptr);
+    }
+
+    uint32_t FramePacer::beginFrame()
+    {
+        // the slot's semaphores and per frame buffers were last used MAX_FRAMES_IN_FLIGHT frames back
+        uint64_t frameValue = getFrameValue();
+        if (frameValue > MAX_FRAMES_IN_FLIGHT) {
+            wait(frameValue - MAX_FRAMES_IN_FLIGHT);
+        }
+
+        collect();
+        m_deletionQueue.beginFrame(frameValue);
+        return getFrameIndex();
+    }
+
+    VkSemaphore FramePacer::submit(VkQueue queue, std::mutex& queueMutex, VkCommandBuffer commandBuffer, VkPipelineStageFlags waitStage)
+    {
+        uint32_t frameIndex = getFrameIndex();
+        uint64_t frameValue = getFrameValue();
+
+        // the acquired image first, then whatever waitFor() added
+        m_waitSemaphores.insert(m_waitSemaphores.begin(), m_imageAvailableSemaphores[frameIndex]);
+        m_waitValues.insert(m_waitValues.begin(), 0);
+        m_waitStages.insert(m_waitStages.begin(), waitStage);
+
+        VkSemaphore signalSemaphores[] = { m_renderFinishedSemaphores[frameIndex], m_timeline };
+        // binary semaphores ignore their value
+        uint64_t signalValues[] = { 0, frameValue };
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(m_waitValues.size());
+        timelineInfo.pWaitSemaphoreValues = m_waitValues.data();
+        timelineInfo.signalSemaphoreValueCount = 2;
+        timelineInfo.pSignalSemaphoreValues = signalValues;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(m_waitSemaphores.size());
+        submitInfo.pWaitSemaphores = m_waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = m_waitStages.data();
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        submitInfo.signalSemaphoreCount = 2;
+        submitInfo.pSignalSemaphores = signalSemaphores;
+
+        {
+            std::lock_guard<std::mutex> queueLock(queueMutex);
+            if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+                throw std::runtime_error("failed to submit draw command buffer!");
+            }
+        }
+
+        m_waitSemaphores.clear();
+        m_waitValues.clear();
+        m_waitStages.clear();
+
+        m_submittedValue = frameValue;
+        return m_renderFinishedSemaphores[frameIndex];
+    }
+
+    void FramePacer::waitFor(VkSemaphore timeline, uint64_t value, VkPipelineStageFlags waitStage)
+    {
+        m_waitSemaphores.push_back(timeline);
+        m_waitValues.push_back(value);
+        m_waitStages.push_back(waitStage);
+    }
+
+    void FramePacer::defer(std::function<void()> func)
+    {
+        m_deletionQueue.retire(std::move(func));
+    }
+
+    void FramePacer::collect()
+    {
+        queryCompletedValue();
+        m_deletionQueue.release(m_completedValue);
+    }
+
+    bool FramePacer::isComplete(uint64_t value)
+    {
+        if (value > m_completedValue) {
+            queryCompletedValue();
+        }
+        return value <= m_completedValue;
+    }
+
+    void FramePacer::wait(uint64_t value)
+    {
+        if (isComplete(value)) {
+            return;
+        }
+
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &m_timeline;
+        waitInfo.pValues = &value;
+
+        if (vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+            throw std::runtime_error("failed to wait for frame!");
+        }
+        m_completedValue = std::max(m_completedValue, value);
+    }
+
+    void FramePacer::queryCompletedValue()
+    {
+        uint64_t value = 0;
+        if (vkGetSemaphoreCounterValue(m_device, m_timeline, &value) != VK_SUCCESS) {
+            throw std::runtime_error("failed to query timeline semaphore!");
+        }
+        m_completedValue = std::max(m_completedValue, value);
+    }
+
+    uint32_t FramePacer::getFrameIndex() const
+    {
+        return static_cast<uint32_t>(m_submittedValue % MAX_FRAMES_IN_FLIGHT);
+    }
+
+    uint64_t FramePacer::getFrameValue() const
+    {
+        return m_submittedValue + 1;
+    }
+
+    uint64_t FramePacer::getSubmittedValue() const
+    {
+        return m_submittedValue;
+    }
+
+    uint64_t FramePacer::getCompletedValue() const
+    {
+        return m_completedValue;
+    }
+
+    VkSemaphore FramePacer::getImageAvailSemaphore() const
+    {
+        return m_imageAvailableSemaphores[getFrameIndex()];
+    }
+
+    VkSemaphore FramePacer::getRenderFinishedSemaphore() const
+    {
+        return m_renderFinishedSemaphores[getFrameIndex()];
+    }
+
+    VkSemaphore FramePacer::getTimelineSemaphore() const
+    {
+        return m_timeline;
+    }
+
+}
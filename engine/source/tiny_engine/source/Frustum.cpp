@@ -0,0 +1,38 @@
+#include "Frustum.h"
+
+namespace vulkan {
+    Frustum Frustum::fromMatrix(const glm::mat4& viewProjection)
+    {
+        // Gribb/Hartmann, rows of the matrix combined per clip plane
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++) {
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        }
+
+        Frustum frustum{};
+        frustum.planes[FRUSTUM_PLANE_LEFT] = rows[3] + rows[0];
+        frustum.planes[FRUSTUM_PLANE_RIGHT] = rows[3] - rows[0];
+        frustum.planes[FRUSTUM_PLANE_BOTTOM] = rows[3] + rows[1];
+        frustum.planes[FRUSTUM_PLANE_TOP] = rows[3] - rows[1];
+        // 0 <= z, not -w <= z
+        frustum.planes[FRUSTUM_PLANE_NEAR] = rows[2];
+        frustum.planes[FRUSTUM_PLANE_FAR] = rows[3] - rows[2];
+
+        for (glm::vec4& plane : frustum.planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+
+        return frustum;
+    }
+
+    bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+    {
+        for (const glm::vec4& plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,363 @@
+#include "FrustumCuller.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CULL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// msvc accepts avx intrinsics anywhere, gcc and clang need the function to be compiled for avx
+#if defined(CULL_X86) && !defined(_MSC_VER)
+#define CULL_TARGET_AVX __attribute__((target("avx")))
+#else
+#define CULL_TARGET_AVX
+#endif
+
+namespace vulkan {
+    namespace {
+        struct BoxPlanes {
+            float nx[FRUSTUM_PLANE_COUNT], ny[FRUSTUM_PLANE_COUNT], nz[FRUSTUM_PLANE_COUNT], w[FRUSTUM_PLANE_COUNT];
+            float ax[FRUSTUM_PLANE_COUNT], ay[FRUSTUM_PLANE_COUNT], az[FRUSTUM_PLANE_COUNT];
+
+            explicit BoxPlanes(const Frustum& frustum)
+            {
+                for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+                    nx[p] = frustum.planes[p].x;
+                    ny[p] = frustum.planes[p].y;
+                    nz[p] = frustum.planes[p].z;
+                    w[p] = frustum.planes[p].w;
+                    ax[p] = std::abs(nx[p]);
+                    ay[p] = std::abs(ny[p]);
+                    az[p] = std::abs(nz[p]);
+                }
+            }
+        };
+
+        uint32_t countTrailingZeros(uint32_t mask)
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return index;
+#else
+            return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+        }
+
+        // appends the set lanes of mask, in lane order
+        uint32_t emitVisible(uint32_t mask, uint32_t base, uint32_t* visible, uint32_t count)
+        {
+            while (mask) {
+                visible[count++] = base + countTrailingZeros(mask);
+                mask &= mask - 1;
+            }
+            return count;
+        }
+
+        uint32_t cullSpheresScalar(const BoxPlanes& planes, const float* x, const float* y, const float* z, const float* radius,
+            uint32_t first, uint32_t last, uint32_t* visible, uint32_t count)
+        {
+            for (uint32_t i = first; i < last; i++) {
+                bool inside = true;
+                for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+                    inside &= planes.nx[p] * x[i] + planes.ny[p] * y[i] + planes.nz[p] * z[i] + planes.w[p] >= -radius[i];
+                }
+                visible[count] = i;
+                count += inside ? 1 : 0;
+            }
+            return count;
+        }
+
+        uint32_t cullBoxesScalar(const BoxPlanes& planes, const float* cx, const float* cy, const float* cz,
+            const float* ex, const float* ey, const float* ez, uint32_t first, uint32_t last, uint32_t* visible, uint32_t count)
+        {
+            for (uint32_t i = first; i < last; i++) {
+                bool inside = true;
+                for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+                    float distance = planes.nx[p] * cx[i] + planes.ny[p] * cy[i] + planes.nz[p] * cz[i] + planes.w[p];
+                    float extent = planes.ax[p] * ex[i] + planes.ay[p] * ey[i] + planes.az[p] * ez[i];
+                    inside &= distance >= -extent;
+                }
+                visible[count] = i;
+                count += inside ? 1 : 0;
+            }
+            return count;
+        }
+
+#ifdef CULL_X86
+        uint32_t cullSpheresSSE(const BoxPlanes& planes, const float* x, const float* y, const float* z, const float* radius,
+            uint32_t count, uint32_t* visible)
+        {
+            __m128 nx[FRUSTUM_PLANE_COUNT], ny[FRUSTUM_PLANE_COUNT], nz[FRUSTUM_PLANE_COUNT], w[FRUSTUM_PLANE_COUNT];
+            for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+                nx[p] = _mm_set1_ps(planes.nx[p]);
+                ny[p] = _mm_set1_ps(planes.ny[p]);
+                nz[p] = _mm_set1_ps(planes.nz[p]);
+                w[p] = _mm_set1_ps(planes.w[p]);
+            }
+            const __m128 signMask = _mm_set1_ps(-0.0f);
+
+            uint32_t visibleCount = 0;
+            uint32_t simdCount = count & ~3u;
+            for (uint32_t i = 0; i < simdCount; i += 4) {
+                __m128 px = _mm_loadu_ps(x + i);
+                __m128 py = _mm_loadu_ps(y + i);
+                __m128 pz = _mm_loadu_ps(z + i);
+                __m128 negRadius = _mm_xor_ps(_mm_loadu_ps(radius + i), signMask);
+
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], px), _mm_mul_ps(ny[p], py)), _mm_add_ps(_mm_mul_ps(nz[p], pz), w[p]));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+                }
+                visibleCount = emitVisible(static_cast<uint32_t>(_mm_movemask_ps(inside)), i, visible, visibleCount);
+            }
+
+            return cullSpheresScalar(planes, x, y, z, radius, simdCount, count, visible, visibleCount);
+        }
+
+        uint32_t cullBoxesSSE(const BoxPlanes& planes, const float* cx, const float* cy, const float* cz,
+            const float* ex, const float* ey, const float* ez, uint32_t count, uint32_t* visible)
+        {
+            __m128 nx[FRUSTUM_PLANE_COUNT], ny[FRUSTUM_PLANE_COUNT], nz[FRUSTUM_PLANE_COUNT], w[FRUSTUM_PLANE_COUNT];
+            __m128 ax[FRUSTUM_PLANE_COUNT], ay[FRUSTUM_PLANE_COUNT], az[FRUSTUM_PLANE_COUNT];
+            for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+                nx[p] = _mm_set1_ps(planes.nx[p]);
+                ny[p] = _mm_set1_ps(planes.ny[p]);
+                nz[p] = _mm_set1_ps(planes.nz[p]);
+                w[p] = _mm_set1_ps(planes.w[p]);
+                ax[p] = _mm_set1_ps(planes.ax[p]);
+                ay[p] = _mm_set1_ps(planes.ay[p]);
+                az[p] = _mm_set1_ps(planes.az[p]);
+            }
+            const __m128 signMask = _mm_set1_ps(-0.0f);
+
+            uint32_t visibleCount = 0;
+            uint32_t simdCount = count & ~3u;
+            for (uint32_t i = 0; i < simdCount; i += 4) {
+                __m128 px = _mm_loadu_ps(cx + i);
+                __m128 py = _mm_loadu_ps(cy + i);
+                __m128 pz = _mm_loadu_ps(cz + i);
+                __m128 qx = _mm_loadu_ps(ex + i);
+                __m128 qy = _mm_loadu_ps(ey + i);
+                __m128 qz = _mm_loadu_ps(ez + i);
+
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], px), _mm_mul_ps(ny[p], py)), _mm_add_ps(_mm_mul_ps(nz[p], pz), w[p]));
+                    __m128 extent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], qx), _mm_mul_ps(ay[p], qy)), _mm_mul_ps(az[p], qz));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_xor_ps(extent, signMask)));
+                }
+                visibleCount = emitVisible(static_cast<uint32_t>(_mm_movemask_ps(inside)), i, visible, visibleCount);
+            }
+
+            return cullBoxesScalar(planes, cx, cy, cz, ex, ey, ez, simdCount, count, visible, visibleCount);
+        }
+
+        CULL_TARGET_AVX uint32_t cullSpheresAVX(const BoxPlanes& planes, const float* x, const float* y, const float* z, const float* radius,
+            uint32_t count, uint32_t* visible)
+        {
+            __m256 nx[FRUSTUM_PLANE_COUNT], ny[FRUSTUM_PLANE_COUNT], nz[FRUSTUM_PLANE_COUNT], w[FRUSTUM_PLANE_COUNT];
+            for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+                nx[p] = _mm256_set1_ps(planes.nx[p]);
+                ny[p] = _mm256_set1_ps(planes.ny[p]);
+                nz[p] = _mm256_set1_ps(planes.nz[p]);
+                w[p] = _mm256_set1_ps(planes.w[p]);
+            }
+            const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+            uint32_t visibleCount = 0;
+            uint32_t simdCount = count & ~7u;
+            for (uint32_t i = 0; i < simdCount; i += 8) {
+                __m256 px = _mm256_loadu_ps(x + i);
+                __m256 py = _mm256_loadu_ps(y + i);
+                __m256 pz = _mm256_loadu_ps(z + i);
+                __m256 negRadius = _mm256_xor_ps(_mm256_loadu_ps(radius + i), signMask);
+
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+                    __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], px), _mm256_mul_ps(ny[p], py)), _mm256_add_ps(_mm256_mul_ps(nz[p], pz), w[p]));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+                }
+                visibleCount = emitVisible(static_cast<uint32_t>(_mm256_movemask_ps(inside)), i, visible, visibleCount);
+            }
+
+            return cullSpheresScalar(planes, x, y, z, radius, simdCount, count, visible, visibleCount);
+        }
+
+        CULL_TARGET_AVX uint32_t cullBoxesAVX(const BoxPlanes& planes, const float* cx, const float* cy, const float* cz,
+            const float* ex, const float* ey, const float* ez, uint32_t count, uint32_t* visible)
+        {
+            __m256 nx[FRUSTUM_PLANE_COUNT], ny[FRUSTUM_PLANE_COUNT], nz[FRUSTUM_PLANE_COUNT], w[FRUSTUM_PLANE_COUNT];
+            __m256 ax[FRUSTUM_PLANE_COUNT], ay[FRUSTUM_PLANE_COUNT], az[FRUSTUM_PLANE_COUNT];
+            for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+                nx[p] = _mm256_set1_ps(planes.nx[p]);
+                ny[p] = _mm256_set1_ps(planes.ny[p]);
+                nz[p] = _mm256_set1_ps(planes.nz[p]);
+                w[p] = _mm256_set1_ps(planes.w[p]);
+                ax[p] = _mm256_set1_ps(planes.ax[p]);
+                ay[p] = _mm256_set1_ps(planes.ay[p]);
+                az[p] = _mm256_set1_ps(planes.az[p]);
+            }
+            const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+            uint32_t visibleCount = 0;
+            uint32_t simdCount = count & ~7u;
+            for (uint32_t i = 0; i < simdCount; i += 8) {
+                __m256 px = _mm256_loadu_ps(cx + i);
+                __m256 py = _mm256_loadu_ps(cy + i);
+                __m256 pz = _mm256_loadu_ps(cz + i);
+                __m256 qx = _mm256_loadu_ps(ex + i);
+                __m256 qy = _mm256_loadu_ps(ey + i);
+                __m256 qz = _mm256_loadu_ps(ez + i);
+
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+                    __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], px), _mm256_mul_ps(ny[p], py)), _mm256_add_ps(_mm256_mul_ps(nz[p], pz), w[p]));
+                    __m256 extent = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], qx), _mm256_mul_ps(ay[p], qy)), _mm256_mul_ps(az[p], qz));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_xor_ps(extent, signMask), _CMP_GE_OQ));
+                }
+                visibleCount = emitVisible(static_cast<uint32_t>(_mm256_movemask_ps(inside)), i, visible, visibleCount);
+            }
+
+            return cullBoxesScalar(planes, cx, cy, cz, ex, ey, ez, simdCount, count, visible, visibleCount);
+        }
+
+        bool cpuSupportsAVX()
+        {
+            uint32_t ecx;
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 1);
+            ecx = static_cast<uint32_t>(info[2]);
+#else
+            uint32_t eax, ebx, edx;
+            if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+                return false;
+            }
+#endif
+            // the cpu has avx and the os saves the ymm registers
+            const uint32_t osxsave = 1u << 27, avx = 1u << 28;
+            if ((ecx & (osxsave | avx)) != (osxsave | avx)) {
+                return false;
+            }
+#ifdef _MSC_VER
+            uint64_t xcr0 = _xgetbv(0);
+#else
+            uint32_t xcrLow, xcrHigh;
+            __asm__ volatile("xgetbv" : "=a"(xcrLow), "=d"(xcrHigh) : "c"(0));
+            uint64_t xcr0 = (uint64_t(xcrHigh) << 32) | xcrLow;
+#endif
+            return (xcr0 & 0x6) == 0x6;
+        }
+#endif
+    }
+
+    void FrustumCuller::resize(uint32_t count)
+    {
+        m_count = count;
+        for (std::vector<float>* stream : { &m_sphereX, &m_sphereY, &m_sphereZ, &m_radius, &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ }) {
+            stream->resize(count);
+        }
+    }
+
+    void FrustumCuller::setSphere(uint32_t index, const glm::vec3& center, float radius)
+    {
+        m_sphereX[index] = center.x;
+        m_sphereY[index] = center.y;
+        m_sphereZ[index] = center.z;
+        m_radius[index] = radius;
+    }
+
+    void FrustumCuller::setBox(uint32_t index, const glm::vec3& min, const glm::vec3& max)
+    {
+        m_centerX[index] = (min.x + max.x) * 0.5f;
+        m_centerY[index] = (min.y + max.y) * 0.5f;
+        m_centerZ[index] = (min.z + max.z) * 0.5f;
+        m_extentX[index] = (max.x - min.x) * 0.5f;
+        m_extentY[index] = (max.y - min.y) * 0.5f;
+        m_extentZ[index] = (max.z - min.z) * 0.5f;
+    }
+
+    void FrustumCuller::setBox(uint32_t index, const glm::vec3& min, const glm::vec3& max, const glm::mat4& transform)
+    {
+        glm::vec3 center = (min + max) * 0.5f;
+        glm::vec3 extent = (max - min) * 0.5f;
+
+        // Arvo: the transformed extent along each world axis is the abs of the matrix applied to the local extent
+        glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+        glm::vec3 worldExtent(0.0f);
+        for (int axis = 0; axis < 3; axis++) {
+            glm::vec3 column = glm::abs(glm::vec3(transform[axis])) * extent[axis];
+            worldExtent += column;
+        }
+
+        m_centerX[index] = worldCenter.x;
+        m_centerY[index] = worldCenter.y;
+        m_centerZ[index] = worldCenter.z;
+        m_extentX[index] = worldExtent.x;
+        m_extentY[index] = worldExtent.y;
+        m_extentZ[index] = worldExtent.z;
+    }
+
+    uint32_t FrustumCuller::getCount() const
+    {
+        return m_count;
+    }
+
+    uint32_t FrustumCuller::cullSpheres(const Frustum& frustum, uint32_t* visible) const
+    {
+        return cullSpheres(frustum, visible, getBestPath());
+    }
+
+    uint32_t FrustumCuller::cullBoxes(const Frustum& frustum, uint32_t* visible) const
+    {
+        return cullBoxes(frustum, visible, getBestPath());
+    }
+
+    uint32_t FrustumCuller::cullSpheres(const Frustum& frustum, uint32_t* visible, CullPath path) const
+    {
+        BoxPlanes planes(frustum);
+#ifdef CULL_X86
+        if (path == CullPath::AVX) {
+            return cullSpheresAVX(planes, m_sphereX.data(), m_sphereY.data(), m_sphereZ.data(), m_radius.data(), m_count, visible);
+        }
+        if (path == CullPath::SSE) {
+            return cullSpheresSSE(planes, m_sphereX.data(), m_sphereY.data(), m_sphereZ.data(), m_radius.data(), m_count, visible);
+        }
+#endif
+        return cullSpheresScalar(planes, m_sphereX.data(), m_sphereY.data(), m_sphereZ.data(), m_radius.data(), 0, m_count, visible, 0);
+    }
+
+    uint32_t FrustumCuller::cullBoxes(const Frustum& frustum, uint32_t* visible, CullPath path) const
+    {
+        BoxPlanes planes(frustum);
+#ifdef CULL_X86
+        if (path == CullPath::AVX) {
+            return cullBoxesAVX(planes, m_centerX.data(), m_centerY.data(), m_centerZ.data(), m_extentX.data(), m_extentY.data(), m_extentZ.data(), m_count, visible);
+        }
+        if (path == CullPath::SSE) {
+            return cullBoxesSSE(planes, m_centerX.data(), m_centerY.data(), m_centerZ.data(), m_extentX.data(), m_extentY.data(), m_extentZ.data(), m_count, visible);
+        }
+#endif
+        return cullBoxesScalar(planes, m_centerX.data(), m_centerY.data(), m_centerZ.data(), m_extentX.data(), m_extentY.data(), m_extentZ.data(), 0, m_count, visible, 0);
+    }
+
+    CullPath FrustumCuller::getBestPath()
+    {
+#ifdef CULL_X86
+        static const CullPath path = cpuSupportsAVX() ? CullPath::AVX : CullPath::SSE;
+        return path;
+#else
+        return CullPath::Scalar;
+#endif
+    }
+
+}
@@ -6,11 +6,11 @@
 
 namespace vulkan {
 	
-	Image::Image(VkPhysicalDevice physicalDevice, VkDevice device, const VkImageCreateInfo& createInfo, 
+	Image::Image(MemoryAllocator& allocator, VkDevice device, const VkImageCreateInfo& createInfo, 
 		VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags, VkImageViewType viewType, const VkImageSubresourceRange& subresourceRange)
-		: m_physicalDevice(physicalDevice), m_device(device)
+		: m_allocator(allocator), m_device(device)
 	{
-		createImage(m_physicalDevice, m_device, createInfo, requiredFlags, m_image, m_memory);
+		createImage(m_allocator, m_device, createInfo, requiredFlags, m_image, m_memory);
 	    
         VkImageViewCreateInfo viewCreateInfo{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
         viewCreateInfo.viewType = viewType;
@@ -28,6 +28,7 @@ namespace vulkan {
         // vkDestroySampler(device, textureSampler, nullptr);
         vkDestroyImageView(m_device, m_view, nullptr);
         vkDestroyImage(m_device, m_image, nullptr);
+        m_allocator.free(m_memory);
     }
 
     const VkImage& Image::getImage() const
@@ -42,7 +43,7 @@ namespace vulkan {
 
     const VkDeviceMemory& Image::getMemory() const
     {
-        return m_memory;
+        return m_memory.memory;
     }
 
 }
@@ -0,0 +1,84 @@
+#include "IndexCodec.h"
+
+#include <stdexcept>
+
+namespace vulkan {
+    namespace {
+        template<typename T>
+        void decodeTo(const uint8_t* data, size_t size, T* dst, size_t indexCount)
+        {
+            const uint8_t* p = data;
+            const uint8_t* end = data + size;
+            uint32_t next = 0;
+
+            for (size_t i = 0; i < indexCount; i++) {
+                uint32_t value = 0;
+                uint32_t shift = 0;
+                while (true) {
+                    if (p >= end || shift > 28) {
+                        throw std::runtime_error("failed to decode indices, data is truncated!");
+                    }
+                    uint8_t byte = *p++;
+                    value |= uint32_t(byte & 0x7f) << shift;
+                    if (!(byte & 0x80)) {
+                        break;
+                    }
+                    shift += 7;
+                }
+
+                int32_t delta = static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+                uint32_t index = next - static_cast<uint32_t>(delta);
+                dst[i] = static_cast<T>(index);
+                if (index >= next) {
+                    next = index + 1;
+                }
+            }
+        }
+    }
+
+    std::vector<uint8_t> IndexCodec::encode(const uint32_t* indices, size_t indexCount)
+    {
+        std::vector<uint8_t> data;
+        data.reserve(indexCount + indexCount / 2);
+        uint32_t next = 0;
+
+        for (size_t i = 0; i < indexCount; i++) {
+            uint32_t index = indices[i];
+            int32_t delta = static_cast<int32_t>(next - index);
+            uint32_t value = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+
+            while (value >= 0x80) {
+                data.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            data.push_back(static_cast<uint8_t>(value));
+
+            if (index >= next) {
+                next = index + 1;
+            }
+        }
+
+        return data;
+    }
+
+    void IndexCodec::decode(const uint8_t* data, size_t size, void* dst, size_t indexCount, VkIndexType indexType)
+    {
+        if (indexType == VK_INDEX_TYPE_UINT16) {
+            decodeTo(data, size, static_cast<uint16_t*>(dst), indexCount);
+        }
+        else {
+            decodeTo(data, size, static_cast<uint32_t*>(dst), indexCount);
+        }
+    }
+
+    VkIndexType chooseIndexType(size_t vertexCount)
+    {
+        return vertexCount <= 0x10000 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    }
+
+    uint32_t getIndexSize(VkIndexType indexType)
+    {
+        return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+
+}
@@ -0,0 +1,300 @@
+#include "JobSystem.h"
+
+#include <iostream>
+#include <algorithm>
+
+namespace vulkan {
+    namespace {
+        thread_local const JobSystem* t_jobSystem = nullptr;
+        thread_local uint32_t t_threadIndex = ~0u;
+    }
+
+    bool JobCounter::isDone() const
+    {
+        return m_count.load() == 0;
+    }
+
+    JobSystem::JobSystem(uint32_t workerCount)
+        : m_mainThreadId(std::this_thread::get_id())
+    {
+        // one queue per worker plus one for the main thread
+        for (uint32_t i = 0; i < workerCount + 1; i++) {
+            m_queues.push_back(std::make_unique<WorkQueue>());
+        }
+
+        t_jobSystem = this;
+        t_threadIndex = workerCount;
+
+        for (uint32_t i = 0; i < workerCount; i++) {
+            m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+        }
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_quit = true;
+        }
+        m_sleepCondition.notify_all();
+
+        for (std::thread& worker : m_workers) {
+            worker.join();
+        }
+
+        if (t_jobSystem == this) {
+            t_jobSystem = nullptr;
+            t_threadIndex = ~0u;
+        }
+    }
+
+    uint32_t JobSystem::defaultWorkerCount()
+    {
+        uint32_t cores = std::thread::hardware_concurrency();
+        // the main thread takes part in wait(), so it counts as one of the cores
+        return cores > 1 ? cores - 1 : 1;
+    }
+
+    uint32_t JobSystem::getThreadIndex() const
+    {
+        return t_jobSystem == this ? t_threadIndex : ~0u;
+    }
+
+    uint32_t JobSystem::getThreadCount() const
+    {
+        return static_cast<uint32_t>(m_queues.size());
+    }
+
+    void JobSystem::run(std::function<void()> func, JobCounter* counter, JobAffinity affinity)
+    {
+        if (counter) {
+            counter->m_count++;
+        }
+
+        Job job{};
+        job.func = std::move(func);
+        job.counter = counter;
+
+        push(std::move(job), affinity == JobAffinity::MainThread);
+    }
+
+    void JobSystem::runAfter(JobCounter& dependency, std::function<void()> func, JobCounter* counter, JobAffinity affinity)
+    {
+        if (counter) {
+            counter->m_count++;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(dependency.m_mutex);
+            if (dependency.m_count.load() != 0) {
+                dependency.m_continuations.push_back({ std::move(func), counter, affinity == JobAffinity::MainThread });
+                return;
+            }
+        }
+
+        Job job{};
+        job.func = std::move(func);
+        job.counter = counter;
+
+        push(std::move(job), affinity == JobAffinity::MainThread);
+    }
+
+    void JobSystem::parallelFor(uint32_t count, uint32_t grainSize, const RangeFunc& func)
+    {
+        if (count == 0) {
+            return;
+        }
+
+        grainSize = std::max(grainSize, 1u);
+        // a few ranges per thread so stealing can even out uneven ranges
+        uint32_t rangeCount = std::min((count + grainSize - 1) / grainSize, getThreadCount() * 4);
+
+        if (rangeCount <= 1) {
+            func(0, count);
+            return;
+        }
+
+        JobCounter counter;
+        for (uint32_t range = 0; range < rangeCount; range++) {
+            uint32_t first = static_cast<uint32_t>((uint64_t)count * range / rangeCount);
+            uint32_t last = static_cast<uint32_t>((uint64_t)count * (range + 1) / rangeCount);
+
+            run([&func, first, last] { func(first, last); }, &counter);
+        }
+
+        wait(counter);
+    }
+
+    void JobSystem::wait(JobCounter& counter)
+    {
+        uint32_t threadIndex = getThreadIndex();
+        bool mainThread = std::this_thread::get_id() == m_mainThreadId;
+
+        while (!counter.isDone()) {
+            if (mainThread) {
+                pumpMainThread();
+            }
+            // foreign threads only block, jobs may rely on running on a pool thread
+            if (threadIndex == ~0u || !tryExecuteOne(threadIndex)) {
+                std::this_thread::yield();
+            }
+        }
+
+        // the last job may still be releasing the counter
+        std::lock_guard<std::mutex> lock(counter.m_mutex);
+        if (counter.m_error) {
+            std::exception_ptr error = counter.m_error;
+            counter.m_error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    void JobSystem::pumpMainThread()
+    {
+        while (true) {
+            Job job;
+            {
+                std::lock_guard<std::mutex> lock(m_mainQueue.mutex);
+                if (m_mainQueue.jobs.empty()) {
+                    return;
+                }
+                job = std::move(m_mainQueue.jobs.front());
+                m_mainQueue.jobs.pop_front();
+            }
+            execute(job);
+        }
+    }
+
+    void JobSystem::push(Job job, bool mainThread)
+    {
+        if (mainThread) {
+            std::lock_guard<std::mutex> lock(m_mainQueue.mutex);
+            m_mainQueue.jobs.push_back(std::move(job));
+            return;
+        }
+
+        // pool threads keep their own work local, anybody else spreads it round robin
+        uint32_t threadIndex = getThreadIndex();
+        uint32_t queueIndex = threadIndex != ~0u ? threadIndex : m_nextQueue.fetch_add(1) % getThreadCount();
+
+        {
+            std::lock_guard<std::mutex> lock(m_queues[queueIndex]->mutex);
+            m_queues[queueIndex]->jobs.push_back(std::move(job));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_pendingJobs++;
+        }
+        m_sleepCondition.notify_one();
+    }
+
+    bool JobSystem::tryExecuteOne(uint32_t threadIndex)
+    {
+        Job job;
+        bool found = false;
+        uint32_t queueCount = getThreadCount();
+
+        // own queue, newest first while it is still hot in cache
+        if (threadIndex != ~0u) {
+            WorkQueue& queue = *m_queues[threadIndex];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty()) {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+                found = true;
+            }
+        }
+
+        // steal the oldest job of somebody else
+        uint32_t start = threadIndex != ~0u ? threadIndex + 1 : 0;
+        for (uint32_t i = 0; i < queueCount && !found; i++) {
+            uint32_t victim = (start + i) % queueCount;
+            if (victim == threadIndex) {
+                continue;
+            }
+
+            WorkQueue& queue = *m_queues[victim];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty()) {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+                found = true;
+            }
+        }
+
+        if (!found) {
+            return false;
+        }
+
+        m_pendingJobs--;
+        execute(job);
+        return true;
+    }
+
+    void JobSystem::execute(Job& job)
+    {
+        try {
+            job.func();
+        }
+        catch (...) {
+            if (job.counter) {
+                std::lock_guard<std::mutex> lock(job.counter->m_mutex);
+                if (!job.counter->m_error) {
+                    job.counter->m_error = std::current_exception();
+                }
+            }
+            else {
+                // nothing waits on a job without a counter, its error would be lost
+                try {
+                    throw;
+                }
+                catch (const std::exception& e) {
+                    std::cerr << "job failed: " << e.what() << std::endl;
+                }
+                catch (...) {
+                    std::cerr << "job failed with an unknown exception" << std::endl;
+                }
+            }
+        }
+
+        if (!job.counter) {
+            return;
+        }
+
+        std::vector<JobCounter::Continuation> continuations;
+        {
+            std::lock_guard<std::mutex> lock(job.counter->m_mutex);
+            if (job.counter->m_count.fetch_sub(1) == 1) {
+                continuations.swap(job.counter->m_continuations);
+            }
+        }
+        // the counter may already be gone here
+
+        for (JobCounter::Continuation& continuation : continuations) {
+            Job next{};
+            next.func = std::move(continuation.func);
+            next.counter = continuation.counter;
+            push(std::move(next), continuation.mainThread);
+        }
+    }
+
+    void JobSystem::workerLoop(uint32_t threadIndex)
+    {
+        t_jobSystem = this;
+        t_threadIndex = threadIndex;
+
+        while (true) {
+            if (tryExecuteOne(threadIndex)) {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_sleepCondition.wait(lock, [this] { return m_quit || m_pendingJobs.load() > 0; });
+            if (m_quit) {
+                return;
+            }
+        }
+    }
+
+}
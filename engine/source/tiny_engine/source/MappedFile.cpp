@@ -0,0 +1,147 @@
+#include "MappedFile.h"
+
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace vulkan {
+    uint64_t getFileStamp(const char* path)
+    {
+        std::error_code error;
+        uint64_t size = std::filesystem::file_size(path, error);
+        if (error) {
+            return 0;
+        }
+        uint64_t time = static_cast<uint64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+
+        return (size * 0x9E3779B97F4A7C15ull) ^ time;
+    }
+
+    void writeFileAtomic(const char* path, const std::function<void(std::ostream&)>& writer)
+    {
+        std::string tempPath = std::string(path) + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                throw std::runtime_error("failed to open " + tempPath + " for writing!");
+            }
+
+            writer(file);
+
+            if (!file.flush()) {
+                throw std::runtime_error("failed to write " + tempPath + "!");
+            }
+        }
+
+        std::filesystem::rename(tempPath, path);
+    }
+
+#ifdef _WIN32
+    MappedFile::MappedFile(const char* path)
+    {
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error(std::string("failed to open ") + path + "!");
+        }
+        m_file = file;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            CloseHandle(file);
+            throw std::runtime_error(std::string("failed to query size of ") + path + "!");
+        }
+        m_size = static_cast<size_t>(size.QuadPart);
+
+        // empty files cannot be mapped
+        if (m_size == 0) {
+            return;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            CloseHandle(file);
+            throw std::runtime_error(std::string("failed to map ") + path + "!");
+        }
+        m_mapping = mapping;
+
+        m_data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!m_data) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            throw std::runtime_error(std::string("failed to map view of ") + path + "!");
+        }
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (m_data) {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mapping) {
+            CloseHandle(m_mapping);
+        }
+        if (m_file) {
+            CloseHandle(m_file);
+        }
+    }
+#else
+    MappedFile::MappedFile(const char* path)
+    {
+        m_file = open(path, O_RDONLY);
+        if (m_file < 0) {
+            throw std::runtime_error(std::string("failed to open ") + path + "!");
+        }
+
+        struct stat info;
+        if (fstat(m_file, &info) != 0) {
+            close(m_file);
+            throw std::runtime_error(std::string("failed to query size of ") + path + "!");
+        }
+        m_size = static_cast<size_t>(info.st_size);
+
+        if (m_size == 0) {
+            return;
+        }
+
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+        if (data == MAP_FAILED) {
+            close(m_file);
+            throw std::runtime_error(std::string("failed to map ") + path + "!");
+        }
+        // the whole file is streamed out front to back
+        madvise(data, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const uint8_t*>(data);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (m_data) {
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+        }
+        if (m_file >= 0) {
+            close(m_file);
+        }
+    }
+#endif
+
+    const uint8_t* MappedFile::getData() const
+    {
+        return m_data;
+    }
+
+    size_t MappedFile::getSize() const
+    {
+        return m_size;
+    }
+
+}
@@ -0,0 +1,485 @@
+#include "MemoryAllocator.h"
+
+#include <set>
+#include <iostream>
+#include <algorithm>
+
+#include "VkUtil.h"
+
+namespace vulkan {
+
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static VkDeviceSize nextPowerOfTwo(VkDeviceSize value) {
+        VkDeviceSize result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    static VkDeviceSize prevPowerOfTwo(VkDeviceSize value) {
+        VkDeviceSize result = 1;
+        while ((result << 1) <= value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    static uint32_t log2(VkDeviceSize value) {
+        uint32_t result = 0;
+        while (value > 1) {
+            value >>= 1;
+            result++;
+        }
+        return result;
+    }
+
+    class MemoryBlock {
+    public:
+        MemoryBlock(VkDevice device, VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, AllocationStrategy strategy, uint8_t* mapped, bool dedicated)
+            : m_device(device), m_memory(memory), m_size(size), m_memoryTypeIndex(memoryTypeIndex), m_strategy(strategy), m_mapped(mapped), m_dedicated(dedicated)
+        {
+        }
+
+        virtual ~MemoryBlock() {
+            if (m_mapped) {
+                vkUnmapMemory(m_device, m_memory);
+            }
+            vkFreeMemory(m_device, m_memory, nullptr);
+        }
+
+        MemoryBlock(const MemoryBlock&) = delete;
+        MemoryBlock& operator= (const MemoryBlock&) = delete;
+
+        bool allocate(VkDeviceSize size, VkDeviceSize alignment, MemoryAllocation& allocation) {
+            if (!allocateRange(size, alignment, allocation.offset, allocation.reservedOffset, allocation.reservedSize)) {
+                return false;
+            }
+
+            allocation.memory = m_memory;
+            allocation.size = size;
+            allocation.mapped = m_mapped ? m_mapped + allocation.offset : nullptr;
+            allocation.memoryTypeIndex = m_memoryTypeIndex;
+            allocation.block = this;
+
+            m_allocationCount++;
+            m_usedBytes += size;
+            m_reservedBytes += allocation.reservedSize;
+            return true;
+        }
+
+        void free(const MemoryAllocation& allocation) {
+            m_allocationCount--;
+            m_usedBytes -= allocation.size;
+            m_reservedBytes -= allocation.reservedSize;
+            freeRange(allocation.reservedOffset, allocation.reservedSize);
+        }
+
+        bool isEmpty() const { return m_allocationCount == 0; }
+        bool isDedicated() const { return m_dedicated; }
+        uint32_t getMemoryTypeIndex() const { return m_memoryTypeIndex; }
+        AllocationStrategy getStrategy() const { return m_strategy; }
+        uint32_t getAllocationCount() const { return m_allocationCount; }
+        VkDeviceSize getSize() const { return m_size; }
+        VkDeviceSize getUsedBytes() const { return m_usedBytes; }
+        VkDeviceSize getReservedBytes() const { return m_reservedBytes; }
+
+        virtual VkDeviceSize getFreeBytes() const { return m_size - m_reservedBytes; }
+        virtual VkDeviceSize getLargestFreeRange() const = 0;
+
+    protected:
+        virtual bool allocateRange(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, VkDeviceSize& reservedOffset, VkDeviceSize& reservedSize) = 0;
+        virtual void freeRange(VkDeviceSize reservedOffset, VkDeviceSize reservedSize) = 0;
+
+    protected:
+        VkDevice m_device;
+        VkDeviceMemory m_memory;
+        VkDeviceSize m_size;
+        uint32_t m_memoryTypeIndex;
+        AllocationStrategy m_strategy;
+        uint8_t* m_mapped;
+        bool m_dedicated;
+
+        uint32_t m_allocationCount = 0;
+        VkDeviceSize m_usedBytes = 0;
+        VkDeviceSize m_reservedBytes = 0;
+    };
+
+    class FreeListBlock : public MemoryBlock {
+    public:
+        FreeListBlock(VkDevice device, VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, uint8_t* mapped, bool dedicated)
+            : MemoryBlock(device, memory, size, memoryTypeIndex, AllocationStrategy::FreeList, mapped, dedicated)
+        {
+            m_freeRanges[0] = size;
+        }
+
+        VkDeviceSize getLargestFreeRange() const override {
+            VkDeviceSize largest = 0;
+            for (const auto& range : m_freeRanges) {
+                largest = std::max(largest, range.second);
+            }
+            return largest;
+        }
+
+    protected:
+        bool allocateRange(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, VkDeviceSize& reservedOffset, VkDeviceSize& reservedSize) override {
+            // best fit: the smallest free range the aligned request still fits into
+            auto best = m_freeRanges.end();
+            VkDeviceSize bestAligned = 0;
+            for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it) {
+                VkDeviceSize aligned = alignUp(it->first, alignment);
+                if (aligned + size <= it->first + it->second && (best == m_freeRanges.end() || it->second < best->second)) {
+                    best = it;
+                    bestAligned = aligned;
+                }
+            }
+
+            if (best == m_freeRanges.end()) {
+                return false;
+            }
+
+            VkDeviceSize rangeOffset = best->first;
+            VkDeviceSize rangeEnd = best->first + best->second;
+            m_freeRanges.erase(best);
+
+            // alignment padding stays on the free list instead of being lost
+            if (bestAligned > rangeOffset) {
+                m_freeRanges[rangeOffset] = bestAligned - rangeOffset;
+            }
+            if (bestAligned + size < rangeEnd) {
+                m_freeRanges[bestAligned + size] = rangeEnd - (bestAligned + size);
+            }
+
+            offset = bestAligned;
+            reservedOffset = bestAligned;
+            reservedSize = size;
+            return true;
+        }
+
+        void freeRange(VkDeviceSize reservedOffset, VkDeviceSize reservedSize) override {
+            auto next = m_freeRanges.upper_bound(reservedOffset);
+            if (next != m_freeRanges.end() && reservedOffset + reservedSize == next->first) {
+                reservedSize += next->second;
+                next = m_freeRanges.erase(next);
+            }
+
+            if (next != m_freeRanges.begin()) {
+                auto prev = std::prev(next);
+                if (prev->first + prev->second == reservedOffset) {
+                    prev->second += reservedSize;
+                    return;
+                }
+            }
+
+            m_freeRanges[reservedOffset] = reservedSize;
+        }
+
+    private:
+        // offset -> size
+        std::map<VkDeviceSize, VkDeviceSize> m_freeRanges;
+    };
+
+    class BuddyBlock : public MemoryBlock {
+    public:
+        static const VkDeviceSize MIN_NODE_SIZE = 256;
+
+        BuddyBlock(VkDevice device, VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, uint8_t* mapped, bool dedicated)
+            : MemoryBlock(device, memory, size, memoryTypeIndex, AllocationStrategy::Buddy, mapped, dedicated)
+        {
+            // size is a power of two, see MemoryAllocator::allocate
+            m_freeNodes.resize(log2(size / MIN_NODE_SIZE) + 1);
+            m_freeNodes.back().insert(0);
+        }
+
+        VkDeviceSize getLargestFreeRange() const override {
+            for (size_t order = m_freeNodes.size(); order > 0; order--) {
+                if (!m_freeNodes[order - 1].empty()) {
+                    return MIN_NODE_SIZE << (order - 1);
+                }
+            }
+            return 0;
+        }
+
+    protected:
+        bool allocateRange(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, VkDeviceSize& reservedOffset, VkDeviceSize& reservedSize) override {
+            VkDeviceSize nodeSize = nextPowerOfTwo(std::max({ size, alignment, MIN_NODE_SIZE }));
+            if (nodeSize > m_size) {
+                return false;
+            }
+
+            uint32_t order = log2(nodeSize / MIN_NODE_SIZE);
+            uint32_t level = order;
+            while (level < m_freeNodes.size() && m_freeNodes[level].empty()) {
+                level++;
+            }
+            if (level == m_freeNodes.size()) {
+                return false;
+            }
+
+            VkDeviceSize node = *m_freeNodes[level].begin();
+            m_freeNodes[level].erase(m_freeNodes[level].begin());
+
+            // split down, keeping the lower half and releasing the upper buddy at each level
+            while (level > order) {
+                level--;
+                m_freeNodes[level].insert(node + (MIN_NODE_SIZE << level));
+            }
+
+            offset = node;
+            reservedOffset = node;
+            reservedSize = nodeSize;
+            return true;
+        }
+
+        void freeRange(VkDeviceSize reservedOffset, VkDeviceSize reservedSize) override {
+            uint32_t order = log2(reservedSize / MIN_NODE_SIZE);
+
+            while (order + 1 < m_freeNodes.size()) {
+                VkDeviceSize buddy = reservedOffset ^ (MIN_NODE_SIZE << order);
+                auto it = m_freeNodes[order].find(buddy);
+                if (it == m_freeNodes[order].end()) {
+                    break;
+                }
+                m_freeNodes[order].erase(it);
+                reservedOffset = std::min(reservedOffset, buddy);
+                order++;
+            }
+
+            m_freeNodes[order].insert(reservedOffset);
+        }
+
+    private:
+        // free node offsets per order, order 0 being MIN_NODE_SIZE
+        std::vector<std::set<VkDeviceSize>> m_freeNodes;
+    };
+
+    class LinearBlock : public MemoryBlock {
+    public:
+        LinearBlock(VkDevice device, VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, uint8_t* mapped, bool dedicated)
+            : MemoryBlock(device, memory, size, memoryTypeIndex, AllocationStrategy::Linear, mapped, dedicated)
+        {
+        }
+
+        VkDeviceSize getFreeBytes() const override {
+            return m_size - m_head;
+        }
+
+        VkDeviceSize getLargestFreeRange() const override {
+            return m_size - m_head;
+        }
+
+    protected:
+        bool allocateRange(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, VkDeviceSize& reservedOffset, VkDeviceSize& reservedSize) override {
+            VkDeviceSize aligned = alignUp(m_head, alignment);
+            if (aligned + size > m_size) {
+                return false;
+            }
+
+            offset = aligned;
+            reservedOffset = m_head;
+            reservedSize = aligned + size - m_head;
+            m_head = aligned + size;
+            return true;
+        }
+
+        void freeRange(VkDeviceSize, VkDeviceSize) override {
+            // individual frees are not reusable, the whole block rewinds once it drains
+            if (m_allocationCount == 0) {
+                m_head = 0;
+            }
+        }
+
+    private:
+        VkDeviceSize m_head = 0;
+    };
+
+    MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+        : m_physicalDevice(physicalDevice), m_device(device), m_blockSize(blockSize)
+    {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+        m_bufferImageGranularity = properties.limits.bufferImageGranularity;
+
+        vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memProperties);
+    }
+
+    MemoryAllocator::~MemoryAllocator()
+    {
+        MemoryAllocatorStats stats = getStats();
+        if (stats.allocationCount > 0) {
+            std::cerr << "memory allocator: " << stats.allocationCount << " allocations still alive on destruction" << std::endl;
+        }
+
+        m_dedicatedBlocks.clear();
+        m_pools.clear();
+    }
+
+    MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationStrategy strategy)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        uint32_t memoryTypeIndex = findMemoryType(m_physicalDevice, requirements.memoryTypeBits, properties);
+
+        // buffers and optimal-tiling images share blocks, so every allocation honours the granularity
+        VkDeviceSize alignment = std::max(requirements.alignment, m_bufferImageGranularity);
+
+        Pool& pool = m_pools[{ memoryTypeIndex, strategy }];
+        if (pool.blockSize == 0) {
+            VkDeviceSize heapSize = m_memProperties.memoryHeaps[m_memProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+
+            pool.memoryTypeIndex = memoryTypeIndex;
+            pool.strategy = strategy;
+            pool.blockSize = prevPowerOfTwo(std::min(m_blockSize, heapSize / 8));
+        }
+
+        MemoryAllocation allocation{};
+
+        // large resources get their own VkDeviceMemory instead of pinning a mostly empty block
+        if (requirements.size > pool.blockSize / 2) {
+            auto block = createBlock(memoryTypeIndex, AllocationStrategy::Linear, requirements.size, true);
+            block->allocate(requirements.size, requirements.alignment, allocation);
+            m_dedicatedBlocks.push_back(std::move(block));
+            return allocation;
+        }
+
+        for (auto& block : pool.blocks) {
+            if (block->allocate(requirements.size, alignment, allocation)) {
+                return allocation;
+            }
+        }
+
+        pool.blocks.push_back(createBlock(memoryTypeIndex, strategy, pool.blockSize, false));
+        if (!pool.blocks.back()->allocate(requirements.size, alignment, allocation)) {
+            throw std::runtime_error("failed to sub-allocate from a new memory block!");
+        }
+
+        return allocation;
+    }
+
+    void MemoryAllocator::free(MemoryAllocation& allocation)
+    {
+        if (!allocation.block) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        MemoryBlock* block = allocation.block;
+        block->free(allocation);
+        allocation = MemoryAllocation{};
+
+        if (!block->isEmpty()) {
+            return;
+        }
+
+        if (block->isDedicated()) {
+            m_dedicatedBlocks.erase(std::remove_if(m_dedicatedBlocks.begin(), m_dedicatedBlocks.end(),
+                [block](const std::unique_ptr<MemoryBlock>& b) { return b.get() == block; }), m_dedicatedBlocks.end());
+            return;
+        }
+
+        // keep one empty block per pool around so load/unload cycles don't thrash vkAllocateMemory
+        Pool& pool = m_pools[{ block->getMemoryTypeIndex(), block->getStrategy() }];
+        if (pool.blocks.size() > 1) {
+            pool.blocks.erase(std::remove_if(pool.blocks.begin(), pool.blocks.end(),
+                [block](const std::unique_ptr<MemoryBlock>& b) { return b.get() == block; }), pool.blocks.end());
+        }
+    }
+
+    std::unique_ptr<MemoryBlock> MemoryAllocator::createBlock(uint32_t memoryTypeIndex, AllocationStrategy strategy, VkDeviceSize size, bool dedicated)
+    {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+        VkDeviceMemory memory;
+        if (vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate memory block!");
+        }
+
+        // host visible blocks stay mapped for their whole lifetime
+        uint8_t* mapped = nullptr;
+        if (m_memProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            if (vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, (void**)&mapped) != VK_SUCCESS) {
+                vkFreeMemory(m_device, memory, nullptr);
+                throw std::runtime_error("failed to map memory block!");
+            }
+        }
+
+        switch (strategy) {
+        case AllocationStrategy::Buddy:
+            return std::make_unique<BuddyBlock>(m_device, memory, size, memoryTypeIndex, mapped, dedicated);
+        case AllocationStrategy::Linear:
+            return std::make_unique<LinearBlock>(m_device, memory, size, memoryTypeIndex, mapped, dedicated);
+        default:
+            return std::make_unique<FreeListBlock>(m_device, memory, size, memoryTypeIndex, mapped, dedicated);
+        }
+    }
+
+    MemoryAllocatorStats MemoryAllocator::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        MemoryAllocatorStats stats{};
+        VkDeviceSize largestFreeSum = 0;
+
+        auto accumulate = [&](const MemoryBlock& block) {
+            stats.blockCount++;
+            stats.allocationCount += block.getAllocationCount();
+            stats.blockBytes += block.getSize();
+            stats.usedBytes += block.getUsedBytes();
+            stats.wastedBytes += block.getReservedBytes() - block.getUsedBytes();
+
+            if (!block.isDedicated()) {
+                VkDeviceSize largest = block.getLargestFreeRange();
+                stats.freeBytes += block.getFreeBytes();
+                stats.largestFreeRange = std::max(stats.largestFreeRange, largest);
+                largestFreeSum += largest;
+            }
+        };
+
+        for (const auto& pool : m_pools) {
+            for (const auto& block : pool.second.blocks) {
+                accumulate(*block);
+            }
+        }
+
+        for (const auto& block : m_dedicatedBlocks) {
+            accumulate(*block);
+            stats.dedicatedBlockCount++;
+        }
+
+        if (stats.freeBytes > 0) {
+            stats.fragmentation = 1.0f - static_cast<float>(largestFreeSum) / static_cast<float>(stats.freeBytes);
+        }
+
+        return stats;
+    }
+
+    void MemoryAllocator::printStats() const
+    {
+        MemoryAllocatorStats stats = getStats();
+
+        std::cout << "memory allocator: "
+            << stats.blockCount << " blocks (" << stats.dedicatedBlockCount << " dedicated), "
+            << stats.allocationCount << " allocations, "
+            << stats.usedBytes << "/" << stats.blockBytes << " bytes used, "
+            << stats.wastedBytes << " bytes wasted, "
+            << "fragmentation " << stats.fragmentation << std::endl;
+    }
+
+    VkPhysicalDevice MemoryAllocator::getPhysicalDevice() const
+    {
+        return m_physicalDevice;
+    }
+
+    VkDevice MemoryAllocator::getDevice() const
+    {
+        return m_device;
+    }
+
+}
@@ -1,80 +1,95 @@
 #include "Mesh.h"
 
 #include "VkUtil.h"
+#include "MeshFile.h"
+#include "DeletionQueue.h"
+#include "IndexCodec.h"
 #include <vector>
 
 namespace vulkan {
-	std::shared_ptr<Mesh> Mesh::load(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool cmdPool,
-		const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	std::shared_ptr<Mesh> Mesh::load(MemoryAllocator& allocator, VkDevice device, UploadManager& uploader, DeletionQueue& deletionQueue,
+		const MeshData& data, const VertexLayout& layout)
 	{
-		VkDeviceSize vertexBufferSize = sizeof(vertices[0]) * vertices.size();
-		VkDeviceSize indexBufferSize = sizeof(indices[0]) * indices.size();
+		const std::vector<Vertex>& vertices = data.vertices;
+		const std::vector<uint32_t>& indices = data.indices;
+		MeshBounds bounds = computeBounds(vertices.data(), vertices.size());
+		uint32_t meshletCount = static_cast<uint32_t>(data.meshlets.size());
+		uint32_t lodCount = static_cast<uint32_t>(data.lods.size());
+
+		std::vector<std::vector<uint8_t>> encoded = layout.encode(vertices.data(), vertices.size());
+		const void* streams[MAX_VERTEX_STREAMS] = {};
+		for (size_t i = 0; i < encoded.size(); i++) {
+			streams[i] = encoded[i].data();
+		}
 
-		auto mesh = std::make_shared<Mesh>();
-		mesh->m_device = device;
-		mesh->m_indexCount = indexBufferSize;
-		mesh->m_vertexCount = vertexBufferSize;
+		VkIndexType indexType = chooseIndexType(vertices.size());
+		if (indexType == VK_INDEX_TYPE_UINT16) {
+			std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+			return load(allocator, device, uploader, deletionQueue, layout, streams, static_cast<uint32_t>(vertices.size()),
+				shortIndices.data(), static_cast<uint32_t>(indices.size()), indexType, bounds, data.meshlets.data(), meshletCount, data.lods.data(), lodCount);
+		}
 
-		// vertex buffer
-		{
-			VkBufferCreateInfo createInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-			createInfo.size = vertexBufferSize;
-			createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-			createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		return load(allocator, device, uploader, deletionQueue, layout, streams, static_cast<uint32_t>(vertices.size()),
+			indices.data(), static_cast<uint32_t>(indices.size()), indexType, bounds, data.meshlets.data(), meshletCount, data.lods.data(), lodCount);
+	}
+
+	std::shared_ptr<Mesh> Mesh::load(MemoryAllocator& allocator, VkDevice device, UploadManager& uploader, DeletionQueue& deletionQueue,
+		const VertexLayout& layout, const void* const* streams, uint32_t vertexCount,
+		const void* indices, uint32_t indexCount, VkIndexType indexType, const MeshBounds& bounds,
+		const Meshlet* meshlets, uint32_t meshletCount, const MeshLod* lods, uint32_t lodCount)
+	{
+		VkDeviceSize indexBufferSize = VkDeviceSize(getIndexSize(indexType)) * indexCount;
 
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingBufferMemory;
-			createBuffer(physicalDevice, device, createInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+		auto mesh = std::make_shared<Mesh>();
+		mesh->m_deletionQueue = &deletionQueue;
+		mesh->m_indexCount = indexCount;
+		mesh->m_indexType = indexType;
+		mesh->m_vertexCount = vertexCount;
+		mesh->m_bounds = bounds;
+		mesh->m_layout = layout;
+		mesh->m_meshlets.assign(meshlets, meshlets + meshletCount);
+		mesh->m_lods.assign(lods, lods + lodCount);
+		if (mesh->m_lods.empty()) {
+			mesh->m_lods.push_back({ 0, indexCount, 0, meshletCount, 0.0f, 0 });
+		}
 
-			void* data;
-			vkMapMemory(device, stagingBufferMemory, 0, vertexBufferSize, 0, &data);
-			memcpy(data, vertices.data(), (size_t)vertexBufferSize);
-			vkUnmapMemory(device, stagingBufferMemory);
+		// vertex buffers
+		for (uint32_t stream = 0; stream < layout.getStreamCount(); stream++) {
+			VkDeviceSize vertexBufferSize = VkDeviceSize(layout.getStride(stream)) * vertexCount;
+			if (vertexBufferSize == 0) {
+				continue;
+			}
 
+			VkBufferCreateInfo createInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+			createInfo.size = vertexBufferSize;
 			createInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-			createBuffer(physicalDevice, device, createInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh->m_vertexBuffer, mesh->m_vertexBufferMemory);
+			createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-			copyBuffer(device, cmdPool, queue, stagingBuffer, mesh->m_vertexBuffer, vertexBufferSize);
+			createBuffer(allocator, device, createInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh->m_vertexBuffers[stream], mesh->m_vertexBufferMemory[stream]);
 
-			vkDestroyBuffer(device, stagingBuffer, nullptr);
-			vkFreeMemory(device, stagingBufferMemory, nullptr);
+			mesh->m_uploadTicket = uploader.uploadBuffer(mesh->m_vertexBuffers[stream], streams[stream], vertexBufferSize);
 		}
 
 		// index buffer
 		{
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingBufferMemory;
-
-			VkBufferCreateInfo createInfo{};
-			createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			VkBufferCreateInfo createInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
 			createInfo.size = indexBufferSize;
-			createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-			createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-			createBuffer(physicalDevice, device, createInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-			void* data;
-			vkMapMemory(device, stagingBufferMemory, 0, indexBufferSize, 0, &data);
-			memcpy(data, indices.data(), (size_t)indexBufferSize);
-			vkUnmapMemory(device, stagingBufferMemory);
-
 			createInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-			createBuffer(physicalDevice, device, createInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh->m_indexBuffer, mesh->m_indexBufferMemory);
+			createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-			copyBuffer(device, cmdPool, queue, stagingBuffer, mesh->m_indexBuffer, indexBufferSize);
+			createBuffer(allocator, device, createInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh->m_indexBuffer, mesh->m_indexBufferMemory);
 
-			vkDestroyBuffer(device, stagingBuffer, nullptr);
-			vkFreeMemory(device, stagingBufferMemory, nullptr);
+			mesh->m_uploadTicket = uploader.uploadBuffer(mesh->m_indexBuffer, indices, indexBufferSize);
 		}
 
 		return mesh;
 	}
 
 	Mesh::~Mesh() {
-		vkDestroyBuffer(m_device, m_vertexBuffer, nullptr);
-		vkDestroyBuffer(m_device, m_indexBuffer, nullptr);
-		vkFreeMemory(m_device, m_vertexBufferMemory, nullptr);
-		vkFreeMemory(m_device, m_indexBufferMemory, nullptr);
+		for (uint32_t stream = 0; stream < m_layout.getStreamCount(); stream++) {
+			m_deletionQueue->retire(m_vertexBuffers[stream], m_vertexBufferMemory[stream]);
+		}
+		m_deletionQueue->retire(m_indexBuffer, m_indexBufferMemory);
 	}
 
 	uint32_t Mesh::getVertexCount() const
@@ -87,9 +102,19 @@ namespace vulkan {
 		return m_indexCount;
 	}
 
-	const VkBuffer& Mesh::getVertexBuffer() const
+	const VkBuffer* Mesh::getVertexBuffers() const
 	{
-		return m_vertexBuffer;
+		return m_vertexBuffers;
+	}
+
+	uint32_t Mesh::getStreamCount() const
+	{
+		return m_layout.getStreamCount();
+	}
+
+	const VertexLayout& Mesh::getLayout() const
+	{
+		return m_layout;
 	}
 
 	const VkBuffer& Mesh::getIndexBuffer() const
@@ -97,5 +122,29 @@ namespace vulkan {
 		return m_indexBuffer;
 	}
 
-}
+	VkIndexType Mesh::getIndexType() const
+	{
+		return m_indexType;
+	}
+
+	UploadTicket Mesh::getUploadTicket() const
+	{
+		return m_uploadTicket;
+	}
+
+	const MeshBounds& Mesh::getBounds() const
+	{
+		return m_bounds;
+	}
 
+	const std::vector<Meshlet>& Mesh::getMeshlets() const
+	{
+		return m_meshlets;
+	}
+
+	const std::vector<MeshLod>& Mesh::getLods() const
+	{
+		return m_lods;
+	}
+
+}
@@ -0,0 +1,257 @@
+#include "MeshFile.h"
+
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <filesystem>
+
+#include "IndexCodec.h"
+
+namespace vulkan {
+    MeshBounds computeBounds(const Vertex* vertices, size_t vertexCount)
+    {
+        MeshBounds bounds{};
+        if (vertexCount == 0) {
+            return bounds;
+        }
+
+        bounds.min = glm::vec3(FLT_MAX);
+        bounds.max = glm::vec3(-FLT_MAX);
+        for (size_t i = 0; i < vertexCount; i++) {
+            bounds.min = glm::min(bounds.min, vertices[i].pos);
+            bounds.max = glm::max(bounds.max, vertices[i].pos);
+        }
+
+        bounds.center = (bounds.min + bounds.max) * 0.5f;
+        for (size_t i = 0; i < vertexCount; i++) {
+            bounds.radius = std::max(bounds.radius, glm::length(vertices[i].pos - bounds.center));
+        }
+
+        return bounds;
+    }
+
+    MeshFile::MeshFile(const char* path)
+        : m_file(std::make_unique<MappedFile>(path)), m_header(nullptr)
+    {
+        if (m_file->getSize() < sizeof(MeshFileHeader)) {
+            throw std::runtime_error(std::string("failed to load ") + path + ", file is truncated!");
+        }
+
+        m_header = reinterpret_cast<const MeshFileHeader*>(m_file->getData());
+        if (m_header->magic != MESH_FILE_MAGIC || m_header->version != MESH_FILE_VERSION) {
+            throw std::runtime_error(std::string("failed to load ") + path + ", not a mesh file of this version!");
+        }
+        if (m_header->vertexAttributeCount > VertexLayout::MAX_ATTRIBUTES || (m_header->indexType != VK_INDEX_TYPE_UINT16 && m_header->indexType != VK_INDEX_TYPE_UINT32)) {
+            throw std::runtime_error(std::string("failed to load ") + path + ", unsupported vertex or index format!");
+        }
+        m_layout = VertexLayout::unpack(m_header->vertexLayout, m_header->vertexAttributeCount);
+
+        for (uint32_t i = 0; i < MESH_SECTION_COUNT; i++) {
+            const MeshFileSection& section = m_header->sections[i];
+            if (section.offset > m_file->getSize() || section.size > m_file->getSize() - section.offset) {
+                throw std::runtime_error(std::string("failed to load ") + path + ", section out of range!");
+            }
+        }
+        for (uint32_t stream = 0; stream < m_layout.getStreamCount(); stream++) {
+            const MeshFileSection& section = m_header->sections[MESH_SECTION_VERTEX_STREAM_0 + stream];
+            if (section.stride != m_layout.getStride(stream) || section.count != m_header->sections[MESH_SECTION_VERTEX_STREAM_0].count) {
+                throw std::runtime_error(std::string("failed to load ") + path + ", vertex stream does not match its layout!");
+            }
+        }
+        const MeshFileSection& indexSection = m_header->sections[MESH_SECTION_INDICES];
+        if (indexSection.stride != getIndexSize(getIndexType()) ||
+            (!(m_header->flags & MESH_FILE_COMPRESSED_INDICES) && indexSection.size != uint64_t(indexSection.count) * indexSection.stride)) {
+            throw std::runtime_error(std::string("failed to load ") + path + ", index section does not match its type!");
+        }
+        const MeshFileSection& meshletSection = m_header->sections[MESH_SECTION_MESHLETS];
+        if (meshletSection.count && meshletSection.stride != sizeof(Meshlet)) {
+            throw std::runtime_error(std::string("failed to load ") + path + ", unsupported meshlet format!");
+        }
+        const Meshlet* meshlets = static_cast<const Meshlet*>(getSectionData(MESH_SECTION_MESHLETS));
+        for (uint32_t i = 0; i < meshletSection.count; i++) {
+            if (meshlets[i].firstIndex > indexSection.count || meshlets[i].indexCount > indexSection.count - meshlets[i].firstIndex) {
+                throw std::runtime_error(std::string("failed to load ") + path + ", meshlet out of range!");
+            }
+        }
+        const MeshFileSection& lodSection = m_header->sections[MESH_SECTION_LODS];
+        if (lodSection.count && (lodSection.stride != sizeof(MeshLod) || lodSection.count > MAX_MESH_LODS)) {
+            throw std::runtime_error(std::string("failed to load ") + path + ", unsupported lod format!");
+        }
+        const MeshLod* lods = static_cast<const MeshLod*>(getSectionData(MESH_SECTION_LODS));
+        for (uint32_t i = 0; i < lodSection.count; i++) {
+            if (lods[i].firstIndex > indexSection.count || lods[i].indexCount > indexSection.count - lods[i].firstIndex ||
+                lods[i].firstMeshlet > meshletSection.count || lods[i].meshletCount > meshletSection.count - lods[i].firstMeshlet) {
+                throw std::runtime_error(std::string("failed to load ") + path + ", lod out of range!");
+            }
+        }
+    }
+
+    void MeshFile::write(const char* path, const MeshData& mesh, uint64_t sourceStamp, const VertexLayout& layout, uint32_t flags)
+    {
+        MeshBounds bounds = computeBounds(mesh.vertices.data(), mesh.vertices.size());
+        std::vector<std::vector<uint8_t>> streams = layout.encode(mesh.vertices.data(), mesh.vertices.size());
+
+        MeshFileHeader header{};
+        header.magic = MESH_FILE_MAGIC;
+        header.version = MESH_FILE_VERSION;
+        header.sourceStamp = sourceStamp;
+        header.vertexAttributeCount = layout.pack(header.vertexLayout);
+        header.indexType = chooseIndexType(mesh.vertices.size());
+        header.flags = flags;
+        memcpy(header.boundsMin, &bounds.min, sizeof(header.boundsMin));
+        memcpy(header.boundsMax, &bounds.max, sizeof(header.boundsMax));
+        memcpy(header.boundsCenter, &bounds.center, sizeof(header.boundsCenter));
+        header.boundsRadius = bounds.radius;
+
+        const void* sectionData[MESH_SECTION_COUNT] = {};
+        for (uint32_t stream = 0; stream < layout.getStreamCount(); stream++) {
+            sectionData[MESH_SECTION_VERTEX_STREAM_0 + stream] = streams[stream].data();
+            header.sections[MESH_SECTION_VERTEX_STREAM_0 + stream].count = static_cast<uint32_t>(mesh.vertices.size());
+            header.sections[MESH_SECTION_VERTEX_STREAM_0 + stream].stride = layout.getStride(stream);
+        }
+        // narrowed or compressed copy of the indices, the raw 32 bit array is written as is
+        std::vector<uint8_t> indexData;
+        uint64_t sectionSizes[MESH_SECTION_COUNT] = {};
+        if (flags & MESH_FILE_COMPRESSED_INDICES) {
+            indexData = IndexCodec::encode(mesh.indices.data(), mesh.indices.size());
+            sectionData[MESH_SECTION_INDICES] = indexData.data();
+            sectionSizes[MESH_SECTION_INDICES] = indexData.size();
+        }
+        else if (header.indexType == VK_INDEX_TYPE_UINT16) {
+            indexData.resize(mesh.indices.size() * sizeof(uint16_t));
+            uint16_t* shortIndices = reinterpret_cast<uint16_t*>(indexData.data());
+            for (size_t i = 0; i < mesh.indices.size(); i++) {
+                shortIndices[i] = static_cast<uint16_t>(mesh.indices[i]);
+            }
+            sectionData[MESH_SECTION_INDICES] = indexData.data();
+        }
+        else {
+            sectionData[MESH_SECTION_INDICES] = mesh.indices.data();
+        }
+        header.sections[MESH_SECTION_INDICES].count = static_cast<uint32_t>(mesh.indices.size());
+        header.sections[MESH_SECTION_INDICES].stride = getIndexSize(static_cast<VkIndexType>(header.indexType));
+
+        sectionData[MESH_SECTION_MESHLETS] = mesh.meshlets.data();
+        header.sections[MESH_SECTION_MESHLETS].count = static_cast<uint32_t>(mesh.meshlets.size());
+        header.sections[MESH_SECTION_MESHLETS].stride = sizeof(Meshlet);
+
+        sectionData[MESH_SECTION_LODS] = mesh.lods.data();
+        header.sections[MESH_SECTION_LODS].count = static_cast<uint32_t>(mesh.lods.size());
+        header.sections[MESH_SECTION_LODS].stride = sizeof(MeshLod);
+
+        uint64_t offset = sizeof(MeshFileHeader);
+        for (uint32_t i = 0; i < MESH_SECTION_COUNT; i++) {
+            MeshFileSection& section = header.sections[i];
+            offset = (offset + MESH_FILE_ALIGNMENT - 1) & ~uint64_t(MESH_FILE_ALIGNMENT - 1);
+            section.offset = offset;
+            section.size = sectionSizes[i] ? sectionSizes[i] : uint64_t(section.count) * section.stride;
+            offset += section.size;
+        }
+
+        writeFileAtomic(path, [&](std::ostream& file) {
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+            const char padding[MESH_FILE_ALIGNMENT] = {};
+            uint64_t written = sizeof(header);
+            for (uint32_t i = 0; i < MESH_SECTION_COUNT; i++) {
+                const MeshFileSection& section = header.sections[i];
+                file.write(padding, section.offset - written);
+                if (section.size) {
+                    file.write(static_cast<const char*>(sectionData[i]), section.size);
+                }
+                written = section.offset + section.size;
+            }
+        });
+    }
+
+    uint64_t MeshFile::getSourceStamp(const char* sourcePath)
+    {
+        return getFileStamp(sourcePath);
+    }
+
+    bool MeshFile::isUpToDate(const char* path, const char* sourcePath, const VertexLayout& layout)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        MeshFileHeader header{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return false;
+        }
+        if (header.magic != MESH_FILE_MAGIC || header.version != MESH_FILE_VERSION) {
+            return false;
+        }
+        if (header.vertexAttributeCount > VertexLayout::MAX_ATTRIBUTES) {
+            return false;
+        }
+        uint32_t words[VertexLayout::MAX_ATTRIBUTES];
+        if (header.vertexAttributeCount != layout.pack(words) ||
+            memcmp(words, header.vertexLayout, header.vertexAttributeCount * sizeof(uint32_t)) != 0) {
+            return false;
+        }
+
+        // a shipped cache without its source is always current
+        if (!std::filesystem::exists(sourcePath)) {
+            return true;
+        }
+        return header.sourceStamp == getSourceStamp(sourcePath);
+    }
+
+    const MeshFileHeader& MeshFile::getHeader() const
+    {
+        return *m_header;
+    }
+
+    const void* MeshFile::getSectionData(MeshSection section) const
+    {
+        return m_file->getData() + m_header->sections[section].offset;
+    }
+
+    uint32_t MeshFile::getSectionCount(MeshSection section) const
+    {
+        return m_header->sections[section].count;
+    }
+
+    MeshBounds MeshFile::getBounds() const
+    {
+        MeshBounds bounds{};
+        memcpy(&bounds.min, m_header->boundsMin, sizeof(m_header->boundsMin));
+        memcpy(&bounds.max, m_header->boundsMax, sizeof(m_header->boundsMax));
+        memcpy(&bounds.center, m_header->boundsCenter, sizeof(m_header->boundsCenter));
+        bounds.radius = m_header->boundsRadius;
+        return bounds;
+    }
+
+    VkIndexType MeshFile::getIndexType() const
+    {
+        return static_cast<VkIndexType>(m_header->indexType);
+    }
+
+    const void* MeshFile::getIndices(std::vector<uint8_t>& scratch) const
+    {
+        const MeshFileSection& section = m_header->sections[MESH_SECTION_INDICES];
+        if (!(m_header->flags & MESH_FILE_COMPRESSED_INDICES)) {
+            return getSectionData(MESH_SECTION_INDICES);
+        }
+
+        scratch.resize(size_t(section.count) * section.stride);
+        IndexCodec::decode(static_cast<const uint8_t*>(getSectionData(MESH_SECTION_INDICES)), section.size, scratch.data(), section.count, getIndexType());
+        return scratch.data();
+    }
+
+    const VertexLayout& MeshFile::getLayout() const
+    {
+        return m_layout;
+    }
+
+    void MeshFile::getVertexStreams(const void** streams) const
+    {
+        for (uint32_t stream = 0; stream < m_layout.getStreamCount(); stream++) {
+            streams[stream] = getSectionData(static_cast<MeshSection>(MESH_SECTION_VERTEX_STREAM_0 + stream));
+        }
+    }
+
+}
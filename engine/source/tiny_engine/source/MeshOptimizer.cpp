@@ -0,0 +1,343 @@
+#include "MeshOptimizer.h"
+
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+namespace vulkan {
+    namespace {
+        // Forsyth's scoring constants
+        const float CACHE_DECAY_POWER = 1.5f;
+        const float LAST_TRIANGLE_SCORE = 0.75f;
+        const float VALENCE_BOOST_SCALE = 2.0f;
+        const float VALENCE_BOOST_POWER = 0.5f;
+        const uint32_t MAX_VALENCE = 64;
+
+        struct ScoreTables {
+            float cache[MeshOptimizer::VERTEX_CACHE_SIZE];
+            float valence[MAX_VALENCE];
+
+            ScoreTables()
+            {
+                const uint32_t cacheSize = MeshOptimizer::VERTEX_CACHE_SIZE;
+                for (uint32_t i = 0; i < cacheSize; i++) {
+                    // the three vertices of the last triangle score the same, whichever order they went in
+                    cache[i] = i < 3 ? LAST_TRIANGLE_SCORE : std::pow(1.0f - float(i - 3) / (cacheSize - 3), CACHE_DECAY_POWER);
+                }
+                valence[0] = 0.0f;
+                for (uint32_t i = 1; i < MAX_VALENCE; i++) {
+                    // vertices with few triangles left are finished off first so they leave the working set
+                    valence[i] = VALENCE_BOOST_SCALE * std::pow(float(i), -VALENCE_BOOST_POWER);
+                }
+            }
+        };
+
+        float vertexScore(const ScoreTables& tables, int32_t cachePosition, uint32_t remaining)
+        {
+            if (remaining == 0) {
+                return -1.0f;
+            }
+            float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+            return score + tables.valence[std::min(remaining, MAX_VALENCE - 1)];
+        }
+
+        struct Cluster {
+            uint32_t firstTriangle;
+            uint32_t triangleCount;
+            float sortKey;
+        };
+    }
+
+    VertexCacheStats MeshOptimizer::analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+    {
+        VertexCacheStats stats{};
+        if (indexCount < 3 || vertexCount == 0) {
+            return stats;
+        }
+
+        // fifo, a vertex is resident while fewer than cacheSize misses happened since it was loaded
+        std::vector<uint32_t> loadTime(vertexCount, 0);
+        uint32_t time = cacheSize + 1;
+        uint32_t misses = 0;
+
+        for (size_t i = 0; i < indexCount; i++) {
+            uint32_t vertex = indices[i];
+            if (time - loadTime[vertex] > cacheSize) {
+                loadTime[vertex] = time++;
+                misses++;
+            }
+        }
+
+        stats.acmr = float(misses) / float(indexCount / 3);
+        stats.atvr = float(misses) / float(vertexCount);
+        return stats;
+    }
+
+    void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+    {
+        static const ScoreTables tables;
+
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0) {
+            return;
+        }
+
+        // vertex -> triangle adjacency, the active triangles of a vertex are the first remaining[v] entries
+        std::vector<uint32_t> remaining(vertexCount, 0);
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            for (uint32_t index : indices) {
+                remaining[index]++;
+            }
+            for (size_t v = 0; v < vertexCount; v++) {
+                adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+            }
+
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++) {
+                adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        std::vector<int32_t> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            vertexScores[v] = vertexScore(tables, -1, remaining[v]);
+        }
+
+        std::vector<float> triangleScores(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        for (size_t t = 0; t < triangleCount; t++) {
+            triangleScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+        }
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+
+        // three extra slots hold the vertices pushed out by the last triangle so their scores drop
+        std::vector<uint32_t> cache, nextCache;
+        cache.reserve(VERTEX_CACHE_SIZE + 3);
+        nextCache.reserve(VERTEX_CACHE_SIZE + 3);
+
+        int64_t bestTriangle = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+        size_t cursor = 0;
+
+        for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+            if (bestTriangle < 0) {
+                // nothing adjacent to the cache is left, continue with the next triangle in input order
+                while (emitted[cursor]) {
+                    cursor++;
+                }
+                bestTriangle = static_cast<int64_t>(cursor);
+            }
+
+            const uint32_t* triangle = &indices[bestTriangle * 3];
+            emitted[bestTriangle] = true;
+
+            nextCache.clear();
+            for (uint32_t k = 0; k < 3; k++) {
+                uint32_t vertex = triangle[k];
+                result.push_back(vertex);
+                nextCache.push_back(vertex);
+
+                // drop the triangle from the vertex's active list
+                uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+                uint32_t* end = begin + remaining[vertex];
+                uint32_t* found = std::find(begin, end, static_cast<uint32_t>(bestTriangle));
+                std::swap(*found, *(end - 1));
+                remaining[vertex]--;
+            }
+            for (uint32_t vertex : cache) {
+                if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+                    nextCache.push_back(vertex);
+                }
+            }
+
+            bestTriangle = -1;
+            float bestScore = -1.0f;
+
+            for (size_t i = 0; i < nextCache.size(); i++) {
+                uint32_t vertex = nextCache[i];
+                int32_t position = i < VERTEX_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+                cachePosition[vertex] = position;
+
+                float score = vertexScore(tables, position, remaining[vertex]);
+                float delta = score - vertexScores[vertex];
+                vertexScores[vertex] = score;
+
+                const uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+                for (uint32_t a = 0; a < remaining[vertex]; a++) {
+                    uint32_t adjacent = begin[a];
+                    triangleScores[adjacent] += delta;
+
+                    if (position >= 0 && triangleScores[adjacent] > bestScore) {
+                        bestScore = triangleScores[adjacent];
+                        bestTriangle = adjacent;
+                    }
+                }
+            }
+
+            if (nextCache.size() > VERTEX_CACHE_SIZE) {
+                nextCache.resize(VERTEX_CACHE_SIZE);
+            }
+            std::swap(cache, nextCache);
+        }
+
+        indices.swap(result);
+    }
+
+    uint32_t MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0) {
+            return 0;
+        }
+
+        const float targetAcmr = analyzeVertexCache(indices.data(), indices.size(), vertices.size()).acmr * threshold;
+
+        // hard boundaries: triangles where all three vertices miss start a new patch of the surface
+        std::vector<uint32_t> hardStarts;
+        {
+            std::vector<uint32_t> loadTime(vertices.size(), 0);
+            uint32_t time = ANALYZE_CACHE_SIZE + 1;
+
+            for (size_t t = 0; t < triangleCount; t++) {
+                uint32_t misses = 0;
+                for (uint32_t k = 0; k < 3; k++) {
+                    uint32_t vertex = indices[t * 3 + k];
+                    if (time - loadTime[vertex] > ANALYZE_CACHE_SIZE) {
+                        loadTime[vertex] = time++;
+                        misses++;
+                    }
+                }
+                if (t == 0 || misses == 3) {
+                    hardStarts.push_back(static_cast<uint32_t>(t));
+                }
+            }
+            hardStarts.push_back(static_cast<uint32_t>(triangleCount));
+        }
+
+        // soft boundaries: merge patches until the merged run is cache efficient enough on a cold cache,
+        // every cluster boundary costs a cache flush once clusters are reordered
+        std::vector<Cluster> clusters;
+        {
+            std::vector<uint32_t> loadTime(vertices.size(), 0);
+            uint32_t time = ANALYZE_CACHE_SIZE + 1;
+            uint32_t clusterStart = 0;
+            uint32_t clusterMisses = 0;
+
+            for (size_t h = 0; h + 1 < hardStarts.size(); h++) {
+                for (uint32_t t = hardStarts[h]; t < hardStarts[h + 1]; t++) {
+                    for (uint32_t k = 0; k < 3; k++) {
+                        uint32_t vertex = indices[t * 3 + k];
+                        if (time - loadTime[vertex] > ANALYZE_CACHE_SIZE) {
+                            loadTime[vertex] = time++;
+                            clusterMisses++;
+                        }
+                    }
+                }
+
+                uint32_t clusterEnd = hardStarts[h + 1];
+                float clusterAcmr = float(clusterMisses) / float(clusterEnd - clusterStart);
+
+                if (clusterAcmr <= targetAcmr || clusterEnd == triangleCount) {
+                    clusters.push_back({ clusterStart, clusterEnd - clusterStart, 0.0f });
+                    clusterStart = clusterEnd;
+                    clusterMisses = 0;
+                    // a new cluster starts cold
+                    time += ANALYZE_CACHE_SIZE + 1;
+                }
+            }
+        }
+
+        // outward facing clusters far from the center are likely occluders, draw them first
+        {
+            glm::vec3 meshCenter(0.0f);
+            float meshArea = 0.0f;
+
+            std::vector<glm::vec3> clusterCenters(clusters.size(), glm::vec3(0.0f));
+            std::vector<glm::vec3> clusterNormals(clusters.size(), glm::vec3(0.0f));
+
+            for (size_t c = 0; c < clusters.size(); c++) {
+                float clusterArea = 0.0f;
+
+                for (uint32_t t = clusters[c].firstTriangle; t < clusters[c].firstTriangle + clusters[c].triangleCount; t++) {
+                    const glm::vec3& p0 = vertices[indices[t * 3 + 0]].pos;
+                    const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+                    const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+
+                    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                    float area = glm::length(normal);
+                    glm::vec3 center = (p0 + p1 + p2) / 3.0f;
+
+                    clusterCenters[c] += center * area;
+                    clusterNormals[c] += normal;
+                    clusterArea += area;
+                }
+
+                meshCenter += clusterCenters[c];
+                meshArea += clusterArea;
+                clusterCenters[c] = clusterArea > 0.0f ? clusterCenters[c] / clusterArea : clusterCenters[c];
+            }
+            meshCenter = meshArea > 0.0f ? meshCenter / meshArea : meshCenter;
+
+            for (size_t c = 0; c < clusters.size(); c++) {
+                float normalLength = glm::length(clusterNormals[c]);
+                glm::vec3 normal = normalLength > 0.0f ? clusterNormals[c] / normalLength : glm::vec3(0.0f);
+                clusters[c].sortKey = glm::dot(clusterCenters[c] - meshCenter, normal);
+            }
+
+            std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& lhs, const Cluster& rhs) {
+                return lhs.sortKey > rhs.sortKey;
+            });
+        }
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for (const Cluster& cluster : clusters) {
+            result.insert(result.end(), indices.begin() + cluster.firstTriangle * 3,
+                indices.begin() + (cluster.firstTriangle + cluster.triangleCount) * 3);
+        }
+        indices.swap(result);
+
+        return static_cast<uint32_t>(clusters.size());
+    }
+
+    void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        std::vector<uint32_t> remap(vertices.size(), ~0u);
+        std::vector<Vertex> result;
+        result.reserve(vertices.size());
+
+        for (uint32_t& index : indices) {
+            if (remap[index] == ~0u) {
+                remap[index] = static_cast<uint32_t>(result.size());
+                result.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+
+        vertices.swap(result);
+    }
+
+    void MeshOptimizer::optimize(MeshData& mesh, MeshOptimizationStats* stats)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        MeshOptimizationStats localStats{};
+
+        localStats.before = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+
+        optimizeVertexCache(mesh.indices, mesh.vertices.size());
+        localStats.clusterCount = optimizeOverdraw(mesh.indices, mesh.vertices);
+        optimizeVertexFetch(mesh.vertices, mesh.indices);
+
+        localStats.after = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+        localStats.optimizeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        if (stats) {
+            *stats = localStats;
+        }
+    }
+
+}
@@ -0,0 +1,329 @@
+#include "MeshSimplifier.h"
+
+#include <cmath>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+#include "Hash.h"
+#include "MeshOptimizer.h"
+
+namespace vulkan {
+    namespace {
+        // symmetric 4x4 of the summed squared plane distances, weighted by triangle area
+        struct Quadric {
+            double a00, a01, a02, a11, a12, a22;
+            double b0, b1, b2;
+            double c;
+            double weight;
+
+            void add(const Quadric& other)
+            {
+                a00 += other.a00; a01 += other.a01; a02 += other.a02;
+                a11 += other.a11; a12 += other.a12; a22 += other.a22;
+                b0 += other.b0; b1 += other.b1; b2 += other.b2;
+                c += other.c;
+                weight += other.weight;
+            }
+
+            // mean squared distance of p to the accumulated planes
+            double evaluate(const glm::vec3& p) const
+            {
+                double x = p.x, y = p.y, z = p.z;
+                double error = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + a11 * y * y + 2.0 * a12 * y * z + a22 * z * z
+                    + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+                return weight > 0.0 ? std::max(error, 0.0) / weight : 0.0;
+            }
+        };
+
+        Quadric planeQuadric(const glm::vec3& normal, float distance, float weight)
+        {
+            Quadric q{};
+            q.a00 = weight * normal.x * normal.x; q.a01 = weight * normal.x * normal.y; q.a02 = weight * normal.x * normal.z;
+            q.a11 = weight * normal.y * normal.y; q.a12 = weight * normal.y * normal.z; q.a22 = weight * normal.z * normal.z;
+            q.b0 = weight * normal.x * distance; q.b1 = weight * normal.y * distance; q.b2 = weight * normal.z * distance;
+            q.c = weight * distance * distance;
+            q.weight = weight;
+            return q;
+        }
+
+        struct PositionKey {
+            uint32_t bits[3];
+
+            bool operator==(const PositionKey& other) const {
+                return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+            }
+        };
+
+        struct PositionHash {
+            size_t operator()(const PositionKey& key) const {
+                return static_cast<size_t>(hashValue(key.bits));
+            }
+        };
+
+        struct Collapse {
+            uint32_t from;
+            uint32_t to;
+            float cost;
+        };
+
+        // triangles around every vertex
+        struct Adjacency {
+            std::vector<uint32_t> offsets;
+            std::vector<uint32_t> triangles;
+
+            void build(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+            {
+                offsets.assign(vertexCount + 1, 0);
+                for (size_t i = 0; i < indexCount; i++) {
+                    offsets[indices[i] + 1]++;
+                }
+                for (size_t v = 0; v < vertexCount; v++) {
+                    offsets[v + 1] += offsets[v];
+                }
+                triangles.resize(indexCount);
+                std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+                for (size_t i = 0; i < indexCount; i++) {
+                    triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+                }
+            }
+        };
+
+        bool containsVertex(const uint32_t* triangle, uint32_t vertex)
+        {
+            return triangle[0] == vertex || triangle[1] == vertex || triangle[2] == vertex;
+        }
+    }
+
+    std::vector<uint32_t> MeshSimplifier::simplify(const std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount,
+        size_t targetIndexCount, float targetError, float* error)
+    {
+        std::vector<uint32_t> result(indices, indices + indexCount);
+        const size_t vertexCount = vertices.size();
+        double maxCost = 0.0;
+
+        // positions shared by several vertices are attribute seams, collapses and quadrics work on the shared position
+        std::vector<uint32_t> positionGroup(vertexCount);
+        std::vector<uint32_t> groupSize(vertexCount, 0);
+        {
+            std::unordered_map<PositionKey, uint32_t, PositionHash> groups;
+            groups.reserve(vertexCount);
+            for (uint32_t v = 0; v < vertexCount; v++) {
+                PositionKey key;
+                std::memcpy(key.bits, &vertices[v].pos, sizeof(key.bits));
+                positionGroup[v] = groups.emplace(key, v).first->second;
+                groupSize[positionGroup[v]]++;
+            }
+        }
+
+        std::vector<Quadric> quadrics(vertexCount, Quadric{});
+        for (size_t i = 0; i + 2 < result.size(); i += 3) {
+            const glm::vec3& p0 = vertices[result[i + 0]].pos;
+            const glm::vec3& p1 = vertices[result[i + 1]].pos;
+            const glm::vec3& p2 = vertices[result[i + 2]].pos;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(normal);
+            if (length <= 0.0f) {
+                continue;
+            }
+            normal /= length;
+            Quadric q = planeQuadric(normal, -glm::dot(normal, p0), length * 0.5f);
+            for (uint32_t k = 0; k < 3; k++) {
+                quadrics[positionGroup[result[i + k]]].add(q);
+            }
+        }
+
+        // an edge not shared by exactly two triangles is a border, its ends stay where they are
+        std::vector<uint8_t> locked(vertexCount, 0);
+        {
+            std::vector<uint32_t> groupIndices(result.size());
+            for (size_t i = 0; i < result.size(); i++) {
+                groupIndices[i] = positionGroup[result[i]];
+            }
+            Adjacency groupAdjacency;
+            groupAdjacency.build(groupIndices.data(), groupIndices.size(), vertexCount);
+
+            for (size_t i = 0; i + 2 < groupIndices.size(); i += 3) {
+                for (uint32_t k = 0; k < 3; k++) {
+                    uint32_t a = groupIndices[i + k];
+                    uint32_t b = groupIndices[i + (k + 1) % 3];
+                    if (a == b) {
+                        continue;
+                    }
+                    uint32_t shared = 0;
+                    for (uint32_t t = groupAdjacency.offsets[a]; t < groupAdjacency.offsets[a + 1]; t++) {
+                        shared += containsVertex(&groupIndices[groupAdjacency.triangles[t] * 3], b) ? 1 : 0;
+                    }
+                    if (shared != 2) {
+                        locked[a] = 1;
+                        locked[b] = 1;
+                    }
+                }
+            }
+
+            for (uint32_t v = 0; v < vertexCount; v++) {
+                locked[v] = locked[positionGroup[v]] || groupSize[positionGroup[v]] > 1;
+            }
+        }
+
+        const double maxCostAllowed = double(targetError) * double(targetError);
+        std::vector<uint32_t> remap(vertexCount);
+        std::vector<uint8_t> touched(vertexCount);
+        std::vector<Collapse> collapses;
+        Adjacency adjacency;
+
+        // every pass collapses a set of independent edges cheapest first, then rebuilds the index buffer
+        while (result.size() > targetIndexCount) {
+            adjacency.build(result.data(), result.size(), vertexCount);
+
+            collapses.clear();
+            for (size_t i = 0; i + 2 < result.size(); i += 3) {
+                for (uint32_t k = 0; k < 3; k++) {
+                    uint32_t from = result[i + k];
+                    uint32_t to = result[i + (k + 1) % 3];
+                    if (locked[from]) {
+                        continue;
+                    }
+                    Quadric q = quadrics[positionGroup[from]];
+                    q.add(quadrics[positionGroup[to]]);
+                    collapses.push_back({ from, to, static_cast<float>(q.evaluate(vertices[to].pos)) });
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+            for (uint32_t v = 0; v < vertexCount; v++) {
+                remap[v] = v;
+            }
+            std::fill(touched.begin(), touched.end(), 0);
+
+            const size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+            size_t removed = 0;
+            uint32_t collapseCount = 0;
+
+            for (const Collapse& collapse : collapses) {
+                if (collapse.cost > maxCostAllowed || removed >= trianglesToRemove) {
+                    break;
+                }
+                if (touched[collapse.from] || touched[collapse.to]) {
+                    continue;
+                }
+
+                // moving the vertex must not turn any surviving triangle around it over
+                const glm::vec3& target = vertices[collapse.to].pos;
+                bool flips = false;
+                uint32_t degenerate = 0;
+                for (uint32_t t = adjacency.offsets[collapse.from]; t < adjacency.offsets[collapse.from + 1] && !flips; t++) {
+                    const uint32_t* triangle = &result[adjacency.triangles[t] * 3];
+                    if (containsVertex(triangle, collapse.to)) {
+                        degenerate++;
+                        continue;
+                    }
+                    glm::vec3 p[3], q[3];
+                    for (uint32_t k = 0; k < 3; k++) {
+                        p[k] = vertices[triangle[k]].pos;
+                        q[k] = triangle[k] == collapse.from ? target : p[k];
+                    }
+                    glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                    glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                    flips = glm::dot(before, after) <= 0.0f;
+                }
+                if (flips) {
+                    continue;
+                }
+
+                remap[collapse.from] = collapse.to;
+                quadrics[positionGroup[collapse.to]].add(quadrics[positionGroup[collapse.from]]);
+                maxCost = std::max(maxCost, double(collapse.cost));
+                removed += degenerate;
+                collapseCount++;
+
+                // the ring around the collapsed vertex changed shape, nothing in it moves again this pass
+                touched[collapse.to] = 1;
+                for (uint32_t t = adjacency.offsets[collapse.from]; t < adjacency.offsets[collapse.from + 1]; t++) {
+                    const uint32_t* triangle = &result[adjacency.triangles[t] * 3];
+                    touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+                }
+            }
+
+            if (collapseCount == 0) {
+                break;
+            }
+
+            size_t write = 0;
+            for (size_t i = 0; i + 2 < result.size(); i += 3) {
+                uint32_t a = remap[result[i + 0]];
+                uint32_t b = remap[result[i + 1]];
+                uint32_t c = remap[result[i + 2]];
+                if (positionGroup[a] == positionGroup[b] || positionGroup[b] == positionGroup[c] || positionGroup[a] == positionGroup[c]) {
+                    continue;
+                }
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+            result.resize(write);
+        }
+
+        if (error) {
+            *error = static_cast<float>(std::sqrt(maxCost));
+        }
+        return result;
+    }
+
+    void MeshSimplifier::generateLods(MeshData& mesh, uint32_t maxLods, float maxError, MeshLodStats* stats)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        MeshLodStats localStats{};
+
+        mesh.lods.clear();
+        if (!mesh.indices.empty()) {
+            glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+            for (const Vertex& vertex : mesh.vertices) {
+                boundsMin = glm::min(boundsMin, vertex.pos);
+                boundsMax = glm::max(boundsMax, vertex.pos);
+            }
+            const float errorLimit = maxError * glm::length(boundsMax - boundsMin) * 0.5f;
+
+            mesh.lods.push_back({ 0, static_cast<uint32_t>(mesh.indices.size()), 0, 0, 0.0f, 0 });
+            std::vector<uint32_t> current = mesh.indices;
+            float error = 0.0f;
+
+            for (uint32_t level = 1; level < std::min(maxLods, MAX_MESH_LODS); level++) {
+                size_t target = current.size() / 6 * 3;
+                if (target / 3 < MIN_LOD_TRIANGLES || error >= errorLimit) {
+                    break;
+                }
+
+                // levels are simplified from the previous one, so their errors add up
+                float levelError = 0.0f;
+                std::vector<uint32_t> next = simplify(mesh.vertices, current.data(), current.size(), target, errorLimit - error, &levelError);
+
+                // a level that barely shrank is not worth its memory
+                if (next.size() > current.size() / 4 * 3) {
+                    break;
+                }
+
+                MeshOptimizer::optimizeVertexCache(next, mesh.vertices.size());
+                error += levelError;
+
+                mesh.lods.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(next.size()), 0, 0, error, 0 });
+                mesh.indices.insert(mesh.indices.end(), next.begin(), next.end());
+                current.swap(next);
+            }
+        }
+
+        localStats.lodCount = static_cast<uint32_t>(mesh.lods.size());
+        for (uint32_t i = 0; i < localStats.lodCount; i++) {
+            localStats.triangleCounts[i] = mesh.lods[i].indexCount / 3;
+            localStats.errors[i] = mesh.lods[i].error;
+        }
+        localStats.simplifyMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        if (stats) {
+            *stats = localStats;
+        }
+    }
+
+}
@@ -0,0 +1,127 @@
+#include "MeshletBuilder.h"
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+namespace vulkan {
+    namespace {
+        void finishMeshlet(Meshlet& meshlet, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+        {
+            const uint32_t* first = indices.data() + meshlet.firstIndex;
+
+            // sphere around the box center, same as the mesh bounds
+            glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+            for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+                boxMin = glm::min(boxMin, vertices[first[i]].pos);
+                boxMax = glm::max(boxMax, vertices[first[i]].pos);
+            }
+            meshlet.center = (boxMin + boxMax) * 0.5f;
+            meshlet.radius = 0.0f;
+            for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+                meshlet.radius = std::max(meshlet.radius, glm::length(vertices[first[i]].pos - meshlet.center));
+            }
+
+            // the cone axis is the average face normal, its spread the widest normal around it
+            std::vector<glm::vec3> normals;
+            normals.reserve(meshlet.indexCount / 3);
+            glm::vec3 axis(0.0f);
+            for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+                const glm::vec3& a = vertices[first[i + 0]].pos;
+                const glm::vec3& b = vertices[first[i + 1]].pos;
+                const glm::vec3& c = vertices[first[i + 2]].pos;
+                glm::vec3 normal = glm::cross(b - a, c - a);
+                float length = glm::length(normal);
+                // degenerate triangles are never rasterized and do not constrain the cone
+                if (length > 0.0f) {
+                    normals.push_back(normal / length);
+                    axis += normal / length;
+                }
+            }
+
+            float axisLength = glm::length(axis);
+            meshlet.coneAxis = axisLength > 0.0f ? axis / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+
+            float minDot = axisLength > 0.0f ? 1.0f : -1.0f;
+            for (const glm::vec3& normal : normals) {
+                minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+            }
+
+            // widening the normal cone by 90 degrees gives the cone of eye directions the cluster is back facing from,
+            // its cosine is -sin of the normal spread. nearly hemispherical clusters are not worth testing
+            meshlet.coneCutoff = minDot <= 0.1f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+        }
+    }
+
+    std::vector<Meshlet> MeshletBuilder::build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+    {
+        return build(vertices, indices, 0, indices.size());
+    }
+
+    std::vector<Meshlet> MeshletBuilder::build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t firstIndex, size_t indexCount)
+    {
+        std::vector<Meshlet> meshlets;
+        // meshlet index + 1 that last referenced a vertex
+        std::vector<uint32_t> stamps(vertices.size(), 0);
+
+        Meshlet current{};
+        current.firstIndex = static_cast<uint32_t>(firstIndex);
+        for (size_t i = firstIndex; i + 2 < firstIndex + indexCount; i += 3) {
+            uint32_t stamp = static_cast<uint32_t>(meshlets.size()) + 1;
+
+            uint32_t newVertices = 0;
+            for (uint32_t k = 0; k < 3; k++) {
+                uint32_t index = indices[i + k];
+                // a repeated index within the triangle counts once
+                bool repeated = (k > 0 && indices[i] == index) || (k > 1 && indices[i + 1] == index);
+                newVertices += (stamps[index] != stamp && !repeated) ? 1 : 0;
+            }
+
+            if (current.vertexCount + newVertices > MAX_VERTICES || current.indexCount / 3 >= MAX_TRIANGLES) {
+                finishMeshlet(current, vertices, indices);
+                meshlets.push_back(current);
+
+                current = Meshlet{};
+                current.firstIndex = static_cast<uint32_t>(i);
+                stamp++;
+                newVertices = 3 - (indices[i] == indices[i + 1]) - (indices[i + 2] == indices[i] || indices[i + 2] == indices[i + 1]);
+            }
+
+            for (uint32_t k = 0; k < 3; k++) {
+                stamps[indices[i + k]] = stamp;
+            }
+            current.vertexCount += newVertices;
+            current.indexCount += 3;
+        }
+
+        if (current.indexCount > 0) {
+            finishMeshlet(current, vertices, indices);
+            meshlets.push_back(current);
+        }
+
+        return meshlets;
+    }
+
+    void MeshletBuilder::build(MeshData& mesh)
+    {
+        if (mesh.lods.empty()) {
+            mesh.meshlets = build(mesh.vertices, mesh.indices);
+            return;
+        }
+
+        mesh.meshlets.clear();
+        for (MeshLod& lod : mesh.lods) {
+            std::vector<Meshlet> meshlets = build(mesh.vertices, mesh.indices, lod.firstIndex, lod.indexCount);
+            lod.firstMeshlet = static_cast<uint32_t>(mesh.meshlets.size());
+            lod.meshletCount = static_cast<uint32_t>(meshlets.size());
+            mesh.meshlets.insert(mesh.meshlets.end(), meshlets.begin(), meshlets.end());
+        }
+    }
+
+    bool isMeshletBackfacing(const Meshlet& meshlet, const glm::vec3& eye)
+    {
+        glm::vec3 toCenter = meshlet.center - eye;
+        return glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+    }
+
+}
@@ -0,0 +1,294 @@
+#include "MipGenerator.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MIP_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace vulkan {
+    namespace {
+        const float KAISER_ALPHA = 4.0f;
+        // in texels of the smaller level
+        const float KAISER_RADIUS = 2.0f;
+        const float PI = 3.14159265358979f;
+
+        // taps of every destination texel along one axis, weights sum to 1
+        struct FilterTable {
+            std::vector<uint32_t> first;
+            std::vector<uint32_t> count;
+            std::vector<uint32_t> index;
+            std::vector<float> weight;
+        };
+
+        // modified bessel function of the first kind, order 0
+        float besselI0(float x)
+        {
+            float sum = 1.0f;
+            float term = 1.0f;
+            for (int k = 1; k < 32; k++) {
+                term *= (x * 0.5f) / k;
+                sum += term * term;
+                if (term * term < sum * 1e-8f) {
+                    break;
+                }
+            }
+            return sum;
+        }
+
+        float sinc(float x)
+        {
+            if (std::abs(x) < 1e-5f) {
+                return 1.0f;
+            }
+            return std::sin(PI * x) / (PI * x);
+        }
+
+        float kaiser(float x)
+        {
+            float t = x / KAISER_RADIUS;
+            if (t * t >= 1.0f) {
+                return 0.0f;
+            }
+            return besselI0(KAISER_ALPHA * std::sqrt(1.0f - t * t)) / besselI0(KAISER_ALPHA);
+        }
+
+        FilterTable buildFilter(uint32_t srcSize, uint32_t dstSize, MipFilter filter)
+        {
+            FilterTable table;
+            table.first.resize(dstSize);
+            table.count.resize(dstSize);
+
+            const float scale = static_cast<float>(srcSize) / dstSize;
+
+            for (uint32_t i = 0; i < dstSize; i++) {
+                const float center = (i + 0.5f) * scale;
+                const uint32_t first = static_cast<uint32_t>(table.index.size());
+
+                if (filter == MipFilter::Box) {
+                    const float lo = center - scale * 0.5f;
+                    const float hi = center + scale * 0.5f;
+                    for (int j = static_cast<int>(std::floor(lo)); j < static_cast<int>(std::ceil(hi)); j++) {
+                        float coverage = std::min(hi, j + 1.0f) - std::max(lo, static_cast<float>(j));
+                        if (coverage > 0.0f) {
+                            table.index.push_back(static_cast<uint32_t>(std::clamp(j, 0, static_cast<int>(srcSize) - 1)));
+                            table.weight.push_back(coverage);
+                        }
+                    }
+                }
+                else {
+                    const float radius = KAISER_RADIUS * scale;
+                    for (int j = static_cast<int>(std::floor(center - radius)); j <= static_cast<int>(std::ceil(center + radius)); j++) {
+                        // distance in texels of the smaller level, the sinc's first zero lands on its neighbours
+                        float x = (j + 0.5f - center) / scale;
+                        float weight = sinc(x) * kaiser(x);
+                        if (weight != 0.0f) {
+                            // clamp to edge
+                            table.index.push_back(static_cast<uint32_t>(std::clamp(j, 0, static_cast<int>(srcSize) - 1)));
+                            table.weight.push_back(weight);
+                        }
+                    }
+                }
+
+                table.first[i] = first;
+                table.count[i] = static_cast<uint32_t>(table.index.size()) - first;
+
+                float sum = 0.0f;
+                for (uint32_t t = first; t < table.index.size(); t++) {
+                    sum += table.weight[t];
+                }
+                for (uint32_t t = first; t < table.index.size(); t++) {
+                    table.weight[t] /= sum;
+                }
+            }
+
+            return table;
+        }
+
+        // src is srcWidth x height, dst is dstWidth x height
+        void filterRows(const float* src, uint32_t srcWidth, float* dst, uint32_t dstWidth, uint32_t height, const FilterTable& table)
+        {
+            for (uint32_t y = 0; y < height; y++) {
+                const float* srcRow = src + static_cast<size_t>(y) * srcWidth * 4;
+                float* dstRow = dst + static_cast<size_t>(y) * dstWidth * 4;
+
+                for (uint32_t x = 0; x < dstWidth; x++) {
+                    const uint32_t first = table.first[x];
+                    const uint32_t last = first + table.count[x];
+#ifdef MIP_X86
+                    __m128 sum = _mm_setzero_ps();
+                    for (uint32_t t = first; t < last; t++) {
+                        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(srcRow + table.index[t] * 4), _mm_set1_ps(table.weight[t])));
+                    }
+                    _mm_storeu_ps(dstRow + x * 4, sum);
+#else
+                    float sum[4] = {};
+                    for (uint32_t t = first; t < last; t++) {
+                        for (uint32_t c = 0; c < 4; c++) {
+                            sum[c] += srcRow[table.index[t] * 4 + c] * table.weight[t];
+                        }
+                    }
+                    std::copy(sum, sum + 4, dstRow + x * 4);
+#endif
+                }
+            }
+        }
+
+        // src is width x srcHeight, dst is width x dstHeight. whole rows are accumulated so both stream through memory
+        void filterColumns(const float* src, uint32_t width, float* dst, uint32_t dstHeight, const FilterTable& table)
+        {
+            const size_t rowFloats = static_cast<size_t>(width) * 4;
+
+            for (uint32_t y = 0; y < dstHeight; y++) {
+                float* dstRow = dst + y * rowFloats;
+                std::fill(dstRow, dstRow + rowFloats, 0.0f);
+
+                const uint32_t first = table.first[y];
+                const uint32_t last = first + table.count[y];
+                for (uint32_t t = first; t < last; t++) {
+                    const float* srcRow = src + table.index[t] * rowFloats;
+                    const float weight = table.weight[t];
+#ifdef MIP_X86
+                    const __m128 w = _mm_set1_ps(weight);
+                    for (size_t i = 0; i < rowFloats; i += 4) {
+                        _mm_storeu_ps(dstRow + i, _mm_add_ps(_mm_loadu_ps(dstRow + i), _mm_mul_ps(_mm_loadu_ps(srcRow + i), w)));
+                    }
+#else
+                    for (size_t i = 0; i < rowFloats; i++) {
+                        dstRow[i] += srcRow[i] * weight;
+                    }
+#endif
+                }
+            }
+        }
+
+        float srgbToLinear(float c)
+        {
+            return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+
+        float linearToSrgb(float c)
+        {
+            return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+        }
+
+        // encoding goes through a 12 bit table, finer than any 8 bit srgb step
+        const uint32_t ENCODE_TABLE_SIZE = 4096;
+
+        struct SrgbTables {
+            float decode[256];
+            uint8_t encode[ENCODE_TABLE_SIZE];
+
+            SrgbTables()
+            {
+                for (uint32_t i = 0; i < 256; i++) {
+                    decode[i] = srgbToLinear(i / 255.0f);
+                }
+                for (uint32_t i = 0; i < ENCODE_TABLE_SIZE; i++) {
+                    encode[i] = static_cast<uint8_t>(linearToSrgb(i / float(ENCODE_TABLE_SIZE - 1)) * 255.0f + 0.5f);
+                }
+            }
+        };
+
+        const SrgbTables& getSrgbTables()
+        {
+            static const SrgbTables tables;
+            return tables;
+        }
+
+        void decodeLevel(const uint8_t* pixels, size_t texelCount, bool srgb, float* dst)
+        {
+            const SrgbTables& tables = getSrgbTables();
+
+            for (size_t i = 0; i < texelCount * 4; i++) {
+                dst[i] = (srgb && i % 4 != 3) ? tables.decode[pixels[i]] : pixels[i] / 255.0f;
+            }
+        }
+
+        void encodeLevel(const float* src, size_t texelCount, bool srgb, uint8_t* pixels)
+        {
+            const SrgbTables& tables = getSrgbTables();
+
+            for (size_t i = 0; i < texelCount * 4; i++) {
+                // the kaiser kernel's negative lobes overshoot at hard edges
+                float value = std::clamp(src[i], 0.0f, 1.0f);
+                if (srgb && i % 4 != 3) {
+                    pixels[i] = tables.encode[static_cast<uint32_t>(value * (ENCODE_TABLE_SIZE - 1) + 0.5f)];
+                }
+                else {
+                    pixels[i] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+                }
+            }
+        }
+    }
+
+    uint32_t MipChain::getLevelCount() const
+    {
+        return static_cast<uint32_t>(offsets.size());
+    }
+
+    uint32_t MipGenerator::getLevelCount(uint32_t width, uint32_t height)
+    {
+        uint32_t levels = 1;
+        for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+            levels++;
+        }
+        return levels;
+    }
+
+    MipChain MipGenerator::generate(const uint8_t* pixels, uint32_t width, uint32_t height, MipFilter filter, bool srgb, uint32_t maxLevels)
+    {
+        uint32_t levelCount = getLevelCount(width, height);
+        if (maxLevels > 0) {
+            levelCount = std::min(levelCount, maxLevels);
+        }
+
+        MipChain chain;
+        chain.width = width;
+        chain.height = height;
+
+        size_t size = 0;
+        for (uint32_t level = 0; level < levelCount; level++) {
+            chain.offsets.push_back(size);
+            size += static_cast<size_t>(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4;
+        }
+        chain.data.resize(size);
+
+        const size_t texelCount = static_cast<size_t>(width) * height;
+        std::copy(pixels, pixels + texelCount * 4, chain.data.begin());
+
+        std::vector<float> current(texelCount * 4);
+        std::vector<float> next;
+        decodeLevel(pixels, texelCount, srgb, current.data());
+
+        for (uint32_t level = 1; level < levelCount; level++) {
+            const uint32_t srcWidth = std::max(width >> (level - 1), 1u);
+            const uint32_t srcHeight = std::max(height >> (level - 1), 1u);
+            const uint32_t dstWidth = std::max(width >> level, 1u);
+            const uint32_t dstHeight = std::max(height >> level, 1u);
+
+            next.resize(static_cast<size_t>(dstWidth) * dstHeight * 4);
+            downsample(current.data(), srcWidth, srcHeight, next.data(), dstWidth, dstHeight, filter);
+            encodeLevel(next.data(), static_cast<size_t>(dstWidth) * dstHeight, srgb, chain.data.data() + chain.offsets[level]);
+
+            // the next level is filtered from the unquantized floats
+            std::swap(current, next);
+        }
+
+        return chain;
+    }
+
+    void MipGenerator::downsample(const float* src, uint32_t srcWidth, uint32_t srcHeight, float* dst, uint32_t dstWidth, uint32_t dstHeight,
+        MipFilter filter)
+    {
+        FilterTable rows = buildFilter(srcWidth, dstWidth, filter);
+        FilterTable columns = buildFilter(srcHeight, dstHeight, filter);
+
+        std::vector<float> horizontal(static_cast<size_t>(dstWidth) * srcHeight * 4);
+        filterRows(src, srcWidth, horizontal.data(), dstWidth, srcHeight, rows);
+        filterColumns(horizontal.data(), dstWidth, dst, dstHeight, columns);
+    }
+
+}
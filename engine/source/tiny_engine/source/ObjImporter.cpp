@@ -0,0 +1,463 @@
+#include "ObjImporter.h"
+
+#include <chrono>
+#include <climits>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "Hash.h"
+#include "JobSystem.h"
+
+namespace vulkan {
+    namespace {
+        const int32_t NO_INDEX = INT32_MIN;
+        const uint8_t RELATIVE_POSITION = 1 << 0;
+        const uint8_t RELATIVE_TEXCOORD = 1 << 1;
+        const uint8_t RELATIVE_NORMAL = 1 << 2;
+
+        // index as written in the file, made absolute once the chunk offsets are known
+        struct Corner {
+            int32_t position;
+            int32_t texCoord;
+            int32_t normal;
+            uint8_t flags;
+        };
+
+        struct Chunk {
+            const char* begin;
+            const char* end;
+            std::vector<glm::vec3> positions;
+            std::vector<glm::vec2> texCoords;
+            std::vector<glm::vec3> normals;
+            std::vector<Corner> corners;
+            uint32_t positionOffset = 0;
+            uint32_t texCoordOffset = 0;
+            uint32_t normalOffset = 0;
+            uint32_t cornerOffset = 0;
+        };
+
+        float elapsedMs(std::chrono::high_resolution_clock::time_point start)
+        {
+            return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+
+        bool isSpace(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        void skipSpaces(const char*& p, const char* end)
+        {
+            while (p < end && isSpace(*p)) {
+                p++;
+            }
+        }
+
+        void skipLine(const char*& p, const char* end)
+        {
+            const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+            p = newline ? newline + 1 : end;
+        }
+
+        // locale independent and a lot faster than strtof, precise enough for mesh data
+        float parseFloat(const char*& p, const char* end)
+        {
+            static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+            skipSpaces(p, end);
+
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                negative = *p == '-';
+                p++;
+            }
+
+            double value = 0.0;
+            while (p < end && *p >= '0' && *p <= '9') {
+                value = value * 10.0 + (*p - '0');
+                p++;
+            }
+
+            if (p < end && *p == '.') {
+                p++;
+                double fraction = 0.0;
+                int digits = 0;
+                while (p < end && *p >= '0' && *p <= '9') {
+                    if (digits < 18) {
+                        fraction = fraction * 10.0 + (*p - '0');
+                        digits++;
+                    }
+                    p++;
+                }
+                value += fraction / powers[digits];
+            }
+
+            if (p < end && (*p == 'e' || *p == 'E')) {
+                p++;
+                bool negativeExponent = false;
+                if (p < end && (*p == '-' || *p == '+')) {
+                    negativeExponent = *p == '-';
+                    p++;
+                }
+                int exponent = 0;
+                while (p < end && *p >= '0' && *p <= '9') {
+                    exponent = std::min(exponent * 10 + (*p - '0'), 400);
+                    p++;
+                }
+                double scale = 1.0;
+                while (exponent > 0) {
+                    int step = std::min(exponent, 18);
+                    scale *= powers[step];
+                    exponent -= step;
+                }
+                value = negativeExponent ? value / scale : value * scale;
+            }
+
+            return static_cast<float>(negative ? -value : value);
+        }
+
+        bool parseIndex(const char*& p, const char* end, int64_t& index)
+        {
+            bool negative = false;
+            if (p < end && *p == '-') {
+                negative = true;
+                p++;
+            }
+
+            if (p >= end || *p < '0' || *p > '9') {
+                return false;
+            }
+
+            index = 0;
+            while (p < end && *p >= '0' && *p <= '9') {
+                index = index * 10 + (*p - '0');
+                p++;
+            }
+            index = negative ? -index : index;
+
+            return index != 0;
+        }
+
+        int32_t toChunkIndex(int64_t index, size_t localCount, uint8_t relativeFlag, uint8_t& flags)
+        {
+            // 1-based absolute, or negative relative to the elements read so far
+            if (index > 0) {
+                return static_cast<int32_t>(index - 1);
+            }
+            flags |= relativeFlag;
+            return static_cast<int32_t>(static_cast<int64_t>(localCount) + index);
+        }
+
+        void parseChunk(Chunk& chunk)
+        {
+            const char* p = chunk.begin;
+            const char* end = chunk.end;
+            std::vector<Corner> polygon;
+
+            while (p < end) {
+                skipSpaces(p, end);
+                if (p + 1 >= end) {
+                    break;
+                }
+
+                if (p[0] == 'v' && isSpace(p[1])) {
+                    p += 1;
+                    glm::vec3 position;
+                    position.x = parseFloat(p, end);
+                    position.y = parseFloat(p, end);
+                    position.z = parseFloat(p, end);
+                    chunk.positions.push_back(position);
+                }
+                else if (p[0] == 'v' && p[1] == 't') {
+                    p += 2;
+                    glm::vec2 texCoord;
+                    texCoord.x = parseFloat(p, end);
+                    texCoord.y = parseFloat(p, end);
+                    chunk.texCoords.push_back(texCoord);
+                }
+                else if (p[0] == 'v' && p[1] == 'n') {
+                    p += 2;
+                    glm::vec3 normal;
+                    normal.x = parseFloat(p, end);
+                    normal.y = parseFloat(p, end);
+                    normal.z = parseFloat(p, end);
+                    chunk.normals.push_back(normal);
+                }
+                else if (p[0] == 'f' && isSpace(p[1])) {
+                    p += 1;
+                    polygon.clear();
+
+                    while (true) {
+                        skipSpaces(p, end);
+                        if (p >= end || *p == '\n' || *p == '#') {
+                            break;
+                        }
+
+                        Corner corner{};
+                        int64_t index;
+                        if (!parseIndex(p, end, index)) {
+                            throw std::runtime_error("failed to parse obj face!");
+                        }
+                        corner.position = toChunkIndex(index, chunk.positions.size(), RELATIVE_POSITION, corner.flags);
+                        corner.texCoord = NO_INDEX;
+                        corner.normal = NO_INDEX;
+
+                        if (p < end && *p == '/') {
+                            p++;
+                            if (p < end && *p != '/') {
+                                if (!parseIndex(p, end, index)) {
+                                    throw std::runtime_error("failed to parse obj face!");
+                                }
+                                corner.texCoord = toChunkIndex(index, chunk.texCoords.size(), RELATIVE_TEXCOORD, corner.flags);
+                            }
+                            if (p < end && *p == '/') {
+                                p++;
+                                if (!parseIndex(p, end, index)) {
+                                    throw std::runtime_error("failed to parse obj face!");
+                                }
+                                corner.normal = toChunkIndex(index, chunk.normals.size(), RELATIVE_NORMAL, corner.flags);
+                            }
+                        }
+
+                        polygon.push_back(corner);
+                    }
+
+                    for (size_t i = 2; i < polygon.size(); i++) {
+                        chunk.corners.push_back(polygon[0]);
+                        chunk.corners.push_back(polygon[i - 1]);
+                        chunk.corners.push_back(polygon[i]);
+                    }
+                }
+
+                skipLine(p, end);
+            }
+        }
+
+        uint32_t floatBits(float value)
+        {
+            // +0.0f folds -0.0f into 0.0f, they compare equal
+            value += 0.0f;
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        uint64_t hashVertex(const Vertex& vertex)
+        {
+            const uint32_t words[] = {
+                floatBits(vertex.pos.x), floatBits(vertex.pos.y), floatBits(vertex.pos.z),
+                floatBits(vertex.texCoord.x), floatBits(vertex.texCoord.y),
+                floatBits(vertex.normal.x), floatBits(vertex.normal.y), floatBits(vertex.normal.z)
+            };
+
+            // the table slot comes from the low bits
+            return hashMix(hashBytes(words, sizeof(words)));
+        }
+
+        uint32_t nextPowerOfTwo(uint32_t value)
+        {
+            uint32_t result = 16;
+            while (result < value) {
+                result <<= 1;
+            }
+            return result;
+        }
+    }
+
+    MeshData ObjImporter::load(const char* path, JobSystem& jobs, ObjImportStats* stats)
+    {
+        ObjImportStats localStats{};
+        auto start = std::chrono::high_resolution_clock::now();
+
+        // read
+        std::vector<char> text;
+        {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file.is_open()) {
+                throw std::runtime_error(std::string("failed to open obj file ") + path + "!");
+            }
+
+            size_t fileSize = static_cast<size_t>(file.tellg());
+            text.resize(fileSize);
+            file.seekg(0);
+            file.read(text.data(), fileSize);
+        }
+        localStats.readMs = elapsedMs(start);
+
+        // parse chunks
+        start = std::chrono::high_resolution_clock::now();
+        std::vector<Chunk> chunks;
+        {
+            const char* begin = text.data();
+            const char* end = text.data() + text.size();
+
+            size_t chunkCount = std::max<size_t>(1, std::min<size_t>(jobs.getThreadCount() * 4, text.size() / MIN_CHUNK_SIZE));
+            size_t chunkSize = text.size() / chunkCount + 1;
+
+            const char* chunkBegin = begin;
+            while (chunkBegin < end) {
+                const char* chunkEnd = chunkBegin + std::min<size_t>(chunkSize, end - chunkBegin);
+                // cut after a newline so no line is split
+                skipLine(chunkEnd, end);
+
+                Chunk chunk{};
+                chunk.begin = chunkBegin;
+                chunk.end = chunkEnd;
+                chunks.push_back(std::move(chunk));
+
+                chunkBegin = chunkEnd;
+            }
+
+            jobs.parallelFor(static_cast<uint32_t>(chunks.size()), 1, [&](uint32_t first, uint32_t last) {
+                for (uint32_t i = first; i < last; i++) {
+                    parseChunk(chunks[i]);
+                }
+            });
+        }
+
+        // resolve indices against the global element order
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texCoords;
+        std::vector<glm::vec3> normals;
+        std::vector<Corner> corners;
+        {
+            uint32_t positionCount = 0, texCoordCount = 0, normalCount = 0, cornerCount = 0;
+            for (Chunk& chunk : chunks) {
+                chunk.positionOffset = positionCount;
+                chunk.texCoordOffset = texCoordCount;
+                chunk.normalOffset = normalCount;
+                chunk.cornerOffset = cornerCount;
+                positionCount += static_cast<uint32_t>(chunk.positions.size());
+                texCoordCount += static_cast<uint32_t>(chunk.texCoords.size());
+                normalCount += static_cast<uint32_t>(chunk.normals.size());
+                cornerCount += static_cast<uint32_t>(chunk.corners.size());
+            }
+
+            positions.resize(positionCount);
+            texCoords.resize(texCoordCount);
+            normals.resize(normalCount);
+            corners.resize(cornerCount);
+
+            jobs.parallelFor(static_cast<uint32_t>(chunks.size()), 1, [&](uint32_t first, uint32_t last) {
+                for (uint32_t i = first; i < last; i++) {
+                    Chunk& chunk = chunks[i];
+                    std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionOffset);
+                    std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + chunk.texCoordOffset);
+                    std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalOffset);
+
+                    for (size_t c = 0; c < chunk.corners.size(); c++) {
+                        Corner corner = chunk.corners[c];
+                        int64_t position = corner.position + ((corner.flags & RELATIVE_POSITION) ? (int64_t)chunk.positionOffset : 0);
+                        int64_t texCoord = corner.texCoord;
+                        if (texCoord != NO_INDEX && (corner.flags & RELATIVE_TEXCOORD)) {
+                            texCoord += chunk.texCoordOffset;
+                        }
+                        int64_t normal = corner.normal;
+                        if (normal != NO_INDEX && (corner.flags & RELATIVE_NORMAL)) {
+                            normal += chunk.normalOffset;
+                        }
+
+                        if (position < 0 || position >= positionCount ||
+                            (texCoord != NO_INDEX && (texCoord < 0 || texCoord >= texCoordCount)) ||
+                            (normal != NO_INDEX && (normal < 0 || normal >= normalCount))) {
+                            throw std::runtime_error("failed to parse obj file, face index out of range!");
+                        }
+
+                        corner.position = static_cast<int32_t>(position);
+                        corner.texCoord = static_cast<int32_t>(texCoord);
+                        corner.normal = static_cast<int32_t>(normal);
+                        corners[chunk.cornerOffset + c] = corner;
+                    }
+
+                    std::vector<glm::vec3>().swap(chunk.positions);
+                    std::vector<glm::vec2>().swap(chunk.texCoords);
+                    std::vector<glm::vec3>().swap(chunk.normals);
+                    std::vector<Corner>().swap(chunk.corners);
+                }
+            });
+        }
+        localStats.parseMs = elapsedMs(start);
+        localStats.chunkCount = static_cast<uint32_t>(chunks.size());
+        localStats.cornerCount = static_cast<uint32_t>(corners.size());
+
+        // weld
+        start = std::chrono::high_resolution_clock::now();
+        MeshData mesh;
+        {
+            auto makeVertex = [&](const Corner& corner) {
+                Vertex vertex{};
+                vertex.pos = positions[corner.position];
+                if (corner.texCoord != NO_INDEX) {
+                    vertex.texCoord = { texCoords[corner.texCoord].x, 1.0f - texCoords[corner.texCoord].y };
+                }
+                if (corner.normal != NO_INDEX) {
+                    vertex.normal = normals[corner.normal];
+                }
+                vertex.color = { 1.0f, 1.0f, 1.0f };
+                return vertex;
+            };
+
+            // hashing is the expensive part and independent per corner
+            std::vector<uint64_t> hashes(corners.size());
+            jobs.parallelFor(static_cast<uint32_t>(corners.size()), 64 * 1024, [&](uint32_t first, uint32_t last) {
+                for (uint32_t i = first; i < last; i++) {
+                    hashes[i] = hashVertex(makeVertex(corners[i]));
+                }
+            });
+
+            // linear probing over vertex indices, kept below 70% load
+            uint32_t capacity = nextPowerOfTwo(static_cast<uint32_t>(positions.size()) * 2);
+            std::vector<uint32_t> slots(capacity, ~0u);
+            std::vector<uint64_t> vertexHashes;
+
+            mesh.indices.resize(corners.size());
+            mesh.vertices.reserve(positions.size());
+            vertexHashes.reserve(positions.size());
+
+            for (size_t i = 0; i < corners.size(); i++) {
+                if ((mesh.vertices.size() + 1) * 10 > static_cast<size_t>(capacity) * 7) {
+                    capacity *= 2;
+                    slots.assign(capacity, ~0u);
+                    for (uint32_t v = 0; v < mesh.vertices.size(); v++) {
+                        uint32_t slot = static_cast<uint32_t>(vertexHashes[v]) & (capacity - 1);
+                        while (slots[slot] != ~0u) {
+                            slot = (slot + 1) & (capacity - 1);
+                        }
+                        slots[slot] = v;
+                    }
+                }
+
+                Vertex vertex = makeVertex(corners[i]);
+                uint64_t hash = hashes[i];
+                uint32_t slot = static_cast<uint32_t>(hash) & (capacity - 1);
+
+                while (true) {
+                    uint32_t candidate = slots[slot];
+                    if (candidate == ~0u) {
+                        candidate = static_cast<uint32_t>(mesh.vertices.size());
+                        slots[slot] = candidate;
+                        mesh.vertices.push_back(vertex);
+                        vertexHashes.push_back(hash);
+                        mesh.indices[i] = candidate;
+                        break;
+                    }
+                    if (vertexHashes[candidate] == hash && mesh.vertices[candidate] == vertex) {
+                        mesh.indices[i] = candidate;
+                        break;
+                    }
+                    slot = (slot + 1) & (capacity - 1);
+                }
+            }
+        }
+        localStats.dedupMs = elapsedMs(start);
+
+        if (stats) {
+            *stats = localStats;
+        }
+
+        return mesh;
+    }
+
+}
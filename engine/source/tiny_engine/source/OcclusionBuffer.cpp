@@ -0,0 +1,124 @@
+#include "OcclusionBuffer.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace vulkan {
+    void OcclusionBuffer::update(const DepthReadback& readback)
+    {
+        m_valid = readback.valid && readback.depth && readback.width > 0 && readback.height > 0;
+        m_levels.clear();
+        if (!m_valid) {
+            return;
+        }
+
+        m_viewProjection = readback.viewProjection;
+
+        // the readback level is a power of two on both axes, so every level halves exactly
+        size_t total = 0;
+        for (uint32_t width = readback.width, height = readback.height;; width = std::max(width / 2, 1u), height = std::max(height / 2, 1u)) {
+            m_levels.push_back({ width, height, total });
+            total += size_t(width) * height;
+            if (width == 1 && height == 1) {
+                break;
+            }
+        }
+
+        m_depth.resize(total);
+        std::copy(readback.depth, readback.depth + size_t(readback.width) * readback.height, m_depth.begin());
+
+        for (size_t i = 1; i < m_levels.size(); i++) {
+            const Level& src = m_levels[i - 1];
+            const Level& dst = m_levels[i];
+            const float* srcDepth = m_depth.data() + src.offset;
+            float* dstDepth = m_depth.data() + dst.offset;
+            const uint32_t stepX = src.width / dst.width;
+            const uint32_t stepY = src.height / dst.height;
+
+            for (uint32_t y = 0; y < dst.height; y++) {
+                const float* row0 = srcDepth + size_t(y * stepY) * src.width;
+                const float* row1 = srcDepth + size_t(y * stepY + stepY - 1) * src.width;
+                for (uint32_t x = 0; x < dst.width; x++) {
+                    uint32_t x0 = x * stepX;
+                    uint32_t x1 = x0 + stepX - 1;
+                    dstDepth[size_t(y) * dst.width + x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+                }
+            }
+        }
+    }
+
+    bool OcclusionBuffer::isValid() const
+    {
+        return m_valid;
+    }
+
+    bool OcclusionBuffer::isOccluded(const glm::vec3& min, const glm::vec3& max, const glm::mat4& modelToClip) const
+    {
+        if (!m_valid) {
+            return false;
+        }
+
+        // screen rect and nearest depth of the 8 corners
+        glm::vec2 rectMin = glm::vec2(1.0f);
+        glm::vec2 rectMax = glm::vec2(-1.0f);
+        float nearest = 1.0f;
+
+        for (uint32_t corner = 0; corner < 8; corner++) {
+            glm::vec4 position = glm::vec4(
+                (corner & 1) ? max.x : min.x,
+                (corner & 2) ? max.y : min.y,
+                (corner & 4) ? max.z : min.z,
+                1.0f);
+            glm::vec4 clip = modelToClip * position;
+
+            if (clip.w <= 1e-5f) {
+                return false;
+            }
+
+            float invW = 1.0f / clip.w;
+            glm::vec2 ndc = glm::vec2(clip.x * invW, clip.y * invW);
+            rectMin = glm::min(rectMin, ndc);
+            rectMax = glm::max(rectMax, ndc);
+            nearest = std::min(nearest, clip.z * invW);
+        }
+
+        if (nearest <= 0.0f) {
+            return false;
+        }
+
+        // ndc to [0, 1] texture space, y is already flipped by the projection
+        rectMin = glm::clamp(rectMin * 0.5f + 0.5f, 0.0f, 1.0f);
+        rectMax = glm::clamp(rectMax * 0.5f + 0.5f, 0.0f, 1.0f);
+        if (rectMin.x >= rectMax.x || rectMin.y >= rectMax.y) {
+            return false;
+        }
+
+        // the level where the rect is at most one texel wide, so it touches at most 2x2 texels
+        const Level& base = m_levels[0];
+        float extent = std::max((rectMax.x - rectMin.x) * base.width, (rectMax.y - rectMin.y) * base.height);
+        uint32_t levelIndex = extent > 1.0f ? static_cast<uint32_t>(std::ceil(std::log2(extent))) : 0;
+        levelIndex = std::min<uint32_t>(levelIndex, static_cast<uint32_t>(m_levels.size()) - 1);
+
+        const Level& level = m_levels[levelIndex];
+        const float* depth = m_depth.data() + level.offset;
+        uint32_t x0 = std::min(static_cast<uint32_t>(rectMin.x * level.width), level.width - 1);
+        uint32_t x1 = std::min(static_cast<uint32_t>(rectMax.x * level.width), level.width - 1);
+        uint32_t y0 = std::min(static_cast<uint32_t>(rectMin.y * level.height), level.height - 1);
+        uint32_t y1 = std::min(static_cast<uint32_t>(rectMax.y * level.height), level.height - 1);
+
+        float farthest = 0.0f;
+        for (uint32_t y = y0; y <= y1; y++) {
+            for (uint32_t x = x0; x <= x1; x++) {
+                farthest = std::max(farthest, depth[size_t(y) * level.width + x]);
+            }
+        }
+
+        return nearest > farthest;
+    }
+
+    const glm::mat4& OcclusionBuffer::getViewProjection() const
+    {
+        return m_viewProjection;
+    }
+
+}
@@ -2,79 +2,126 @@
 
 #include <iostream>
 
+#include "Hash.h"
 #include "VkUtil.h"
+#include "VertexLayout.h"
+#include "PipelineCache.h"
 #include "common_utils.h"
 
 namespace vulkan {
 
-    Pipeline::Pipeline(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t width, uint32_t height, VkExtent2D extent, VkDescriptorSetLayout descriptorSetLayout, VkRenderPass renderPass)
-        : m_physicalDevice(physicalDevice), m_device(device)
+    uint64_t PipelineDesc::hash() const
     {
-        auto source_path = Utils::getCurrentProcessDirectory().parent_path().parent_path();
-        auto vert_shader_path = source_path / "engine/shaders/vert.spv";
-        auto frag_shader_path = source_path / "engine/shaders/frag.spv";
+        uint64_t hash = HASH_SEED;
+        // lengths separate the names, "ab" + "c" and "a" + "bc" differ
+        hash = hashValue(vertexShader.size(), hashBytes(vertexShader.data(), vertexShader.size(), hash));
+        hash = hashValue(fragmentShader.size(), hashBytes(fragmentShader.data(), fragmentShader.size(), hash));
+
+        uint32_t layoutWords[VertexLayout::MAX_ATTRIBUTES];
+        uint32_t layoutWordCount = vertexLayout.pack(layoutWords);
+        hash = hashValue(layoutWordCount, hashBytes(layoutWords, layoutWordCount * sizeof(uint32_t), hash));
+        hash = hashValue(instanced, hash);
+
+        hash = hashValue(topology, hash);
+        hash = hashValue(polygonMode, hash);
+        hash = hashValue(cullMode, hash);
+        hash = hashValue(frontFace, hash);
+
+        hash = hashValue(depthTest, hash);
+        hash = hashValue(depthWrite, hash);
+        hash = hashValue(depthCompare, hash);
+
+        hash = hashValue(blendEnable, hash);
+        hash = hashValue(srcColorBlend, hash);
+        hash = hashValue(dstColorBlend, hash);
+        hash = hashValue(colorBlendOp, hash);
+        hash = hashValue(srcAlphaBlend, hash);
+        hash = hashValue(dstAlphaBlend, hash);
+        hash = hashValue(alphaBlendOp, hash);
+        hash = hashValue(colorWriteMask, hash);
+
+        hash = hashValue(renderPass, hash);
+        hash = hashValue(subpass, hash);
+        hash = hashValue(descriptorSetLayout, hash);
+        return hash;
+    }
 
-        auto vertShaderCode = readFile(vert_shader_path.string().data());
-        auto fragShaderCode = readFile(frag_shader_path.string().data());
+    bool PipelineDesc::operator==(const PipelineDesc& other) const
+    {
+        return vertexShader == other.vertexShader && fragmentShader == other.fragmentShader &&
+            vertexLayout == other.vertexLayout && instanced == other.instanced &&
+            topology == other.topology && polygonMode == other.polygonMode && cullMode == other.cullMode && frontFace == other.frontFace &&
+            depthTest == other.depthTest && depthWrite == other.depthWrite && depthCompare == other.depthCompare &&
+            blendEnable == other.blendEnable &&
+            srcColorBlend == other.srcColorBlend && dstColorBlend == other.dstColorBlend && colorBlendOp == other.colorBlendOp &&
+            srcAlphaBlend == other.srcAlphaBlend && dstAlphaBlend == other.dstAlphaBlend && alphaBlendOp == other.alphaBlendOp &&
+            colorWriteMask == other.colorWriteMask &&
+            renderPass == other.renderPass && subpass == other.subpass && descriptorSetLayout == other.descriptorSetLayout;
+    }
 
-        VkShaderModule vertShaderModule = createShaderModule(m_device, vertShaderCode);
-        VkShaderModule fragShaderModule = createShaderModule(m_device, fragShaderCode);
+    bool PipelineDesc::operator!=(const PipelineDesc& other) const
+    {
+        return !(*this == other);
+    }
 
+    Pipeline::Pipeline(VkDevice device, PipelineCache& pipelineCache, const PipelineDesc& desc, VkPipelineLayout pipelineLayout,
+        VkShaderModule vertexShader, VkShaderModule fragmentShader)
+        : m_device(device), m_pipelineLayout(pipelineLayout)
+    {
         VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
         vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        vertShaderStageInfo.module = vertShaderModule;
+        vertShaderStageInfo.module = vertexShader;
         vertShaderStageInfo.pName = "main";
 
         VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
         fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module = fragShaderModule;
+        fragShaderStageInfo.module = fragmentShader;
         fragShaderStageInfo.pName = "main";
 
         VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        auto bindingDescription = Vertex::getBindingDescription();
-        auto attributeDescriptions = Vertex::getAttributeDescriptions();
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions = desc.vertexLayout.getBindingDescriptions();
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions = desc.vertexLayout.getAttributeDescriptions();
+        if (desc.instanced) {
+            bindingDescriptions.push_back(InstanceData::getBindingDescription());
+            for (const auto& attribute : InstanceData::getAttributeDescriptions()) {
+                attributeDescriptions.push_back(attribute);
+            }
+        }
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
         vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
         vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
         VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
         inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        inputAssembly.topology = desc.topology;
         inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = width;
-        viewport.height = height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        VkRect2D scissor{};
-        scissor.offset = { 0, 0 };
-        scissor.extent = extent;
-
+        // set with vkCmdSetViewport / vkCmdSetScissor when recording
         VkPipelineViewportStateCreateInfo viewportState{};
         viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewportState.viewportCount = 1;
-        viewportState.pViewports = &viewport;
         viewportState.scissorCount = 1;
-        viewportState.pScissors = &scissor;
+
+        VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+        VkPipelineDynamicStateCreateInfo dynamicState{};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = 2;
+        dynamicState.pDynamicStates = dynamicStates;
 
         VkPipelineRasterizationStateCreateInfo rasterizer{};
         rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
         rasterizer.depthClampEnable = VK_FALSE;
         rasterizer.rasterizerDiscardEnable = VK_FALSE;
-        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterizer.polygonMode = desc.polygonMode;
         rasterizer.lineWidth = 1.0f;
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        rasterizer.cullMode = desc.cullMode;
+        rasterizer.frontFace = desc.frontFace;
         rasterizer.depthBiasEnable = VK_FALSE;
 
         VkPipelineMultisampleStateCreateInfo multisampling{};
@@ -83,8 +130,14 @@ namespace vulkan {
         multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
         VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        colorBlendAttachment.blendEnable = VK_FALSE;
+        colorBlendAttachment.colorWriteMask = desc.colorWriteMask;
+        colorBlendAttachment.blendEnable = desc.blendEnable ? VK_TRUE : VK_FALSE;
+        colorBlendAttachment.srcColorBlendFactor = desc.srcColorBlend;
+        colorBlendAttachment.dstColorBlendFactor = desc.dstColorBlend;
+        colorBlendAttachment.colorBlendOp = desc.colorBlendOp;
+        colorBlendAttachment.srcAlphaBlendFactor = desc.srcAlphaBlend;
+        colorBlendAttachment.dstAlphaBlendFactor = desc.dstAlphaBlend;
+        colorBlendAttachment.alphaBlendOp = desc.alphaBlendOp;
 
         VkPipelineColorBlendStateCreateInfo colorBlending{};
         colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -97,15 +150,6 @@ namespace vulkan {
         colorBlending.blendConstants[2] = 0.0f;
         colorBlending.blendConstants[3] = 0.0f;
 
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 1;
-        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-
-        if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create pipeline layout!");
-        }
-
         VkGraphicsPipelineCreateInfo pipelineInfo{};
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
         pipelineInfo.stageCount = 2;
@@ -116,33 +160,27 @@ namespace vulkan {
         pipelineInfo.pRasterizationState = &rasterizer;
         pipelineInfo.pMultisampleState = &multisampling;
         pipelineInfo.pColorBlendState = &colorBlending;
+        pipelineInfo.pDynamicState = &dynamicState;
         pipelineInfo.layout = m_pipelineLayout;
-        pipelineInfo.renderPass = renderPass;
-        pipelineInfo.subpass = 0;
+        pipelineInfo.renderPass = desc.renderPass;
+        pipelineInfo.subpass = desc.subpass;
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
         VkPipelineDepthStencilStateCreateInfo depthStencil{};
         depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-        depthStencil.depthTestEnable = VK_TRUE;
-        depthStencil.depthWriteEnable = VK_TRUE;
-        depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+        depthStencil.depthTestEnable = desc.depthTest ? VK_TRUE : VK_FALSE;
+        depthStencil.depthWriteEnable = desc.depthWrite ? VK_TRUE : VK_FALSE;
+        depthStencil.depthCompareOp = desc.depthCompare;
         depthStencil.depthBoundsTestEnable = VK_FALSE;
 
         pipelineInfo.pDepthStencilState = &depthStencil;
 
-        if (vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create graphics pipeline!");
-        }
-
-        vkDestroyShaderModule(m_device, fragShaderModule, nullptr);
-        vkDestroyShaderModule(m_device, vertShaderModule, nullptr);
+        m_graphicsPipeline = pipelineCache.createGraphicsPipeline(pipelineInfo);
     }
 
     Pipeline::~Pipeline()
     {
-        vkDeviceWaitIdle(m_device);
         vkDestroyPipeline(m_device, m_graphicsPipeline, nullptr);
-        vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
     }
 
     VkPipeline Pipeline::getPipeline() const
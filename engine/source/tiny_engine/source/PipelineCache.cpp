@@ -0,0 +1,275 @@
+#include "PipelineCache.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+
+#include "Hash.h"
+#include "MappedFile.h"
+
+namespace vulkan {
+    namespace {
+        float elapsedMs(std::chrono::high_resolution_clock::time_point start) {
+            return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+    }
+
+    PipelineCache::PipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path, const std::string& shaderDirectory, bool creationFeedback)
+        : m_physicalDevice(physicalDevice), m_device(device), m_path(path), m_creationFeedback(creationFeedback)
+    {
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &m_properties);
+        m_shaderHash = hashShaders(shaderDirectory);
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        std::vector<char> data;
+        load(data);
+
+        VkPipelineCacheCreateInfo createInfo{ VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+        createInfo.initialDataSize = data.size();
+        createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+        // the driver may still reject a blob it does not like, it is dropped rather than failing startup
+        if (vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_cache) != VK_SUCCESS) {
+            createInfo.initialDataSize = 0;
+            createInfo.pInitialData = nullptr;
+            m_stats.loaded = false;
+            m_stats.loadedBytes = 0;
+            m_dataHash = 0;
+
+            if (vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_cache) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create pipeline cache!");
+            }
+        }
+
+        m_stats.loadMs = elapsedMs(start);
+    }
+
+    PipelineCache::~PipelineCache()
+    {
+        try {
+            save();
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+
+        vkDestroyPipelineCache(m_device, m_cache, nullptr);
+    }
+
+    void PipelineCache::load(std::vector<char>& data)
+    {
+        std::ifstream file(m_path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            return;
+        }
+
+        size_t fileSize = static_cast<size_t>(file.tellg());
+        file.seekg(0);
+
+        PipelineCacheHeader header{};
+        file.read(reinterpret_cast<char*>(&header), std::min(fileSize, sizeof(header)));
+
+        const char* reason = nullptr;
+        if (fileSize < sizeof(header)) {
+            reason = "truncated";
+        }
+        else if (header.magic != PIPELINE_CACHE_MAGIC || header.version != PIPELINE_CACHE_VERSION) {
+            reason = "unknown format";
+        }
+        else if (header.vendorID != m_properties.vendorID || header.deviceID != m_properties.deviceID) {
+            reason = "different device";
+        }
+        else if (header.driverVersion != m_properties.driverVersion ||
+            std::memcmp(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+            reason = "different driver";
+        }
+        else if (header.shaderHash != m_shaderHash) {
+            reason = "shaders changed";
+        }
+        else if (header.dataSize != fileSize - sizeof(header)) {
+            reason = "truncated";
+        }
+
+        if (!reason) {
+            data.resize(static_cast<size_t>(header.dataSize));
+            file.read(data.data(), data.size());
+            if (!file || hashBytes(data.data(), data.size()) != header.dataHash) {
+                reason = "corrupted";
+            }
+        }
+
+        if (reason) {
+            std::cout << "pipeline cache " << m_path << " discarded, " << reason << std::endl;
+            data.clear();
+            return;
+        }
+
+        m_stats.loaded = true;
+        m_stats.loadedBytes = header.dataSize;
+        m_dataHash = header.dataHash;
+    }
+
+    void PipelineCache::save()
+    {
+        size_t size = 0;
+        if (vkGetPipelineCacheData(m_device, m_cache, &size, nullptr) != VK_SUCCESS || size == 0) {
+            return;
+        }
+
+        std::vector<char> data(size);
+        if (vkGetPipelineCacheData(m_device, m_cache, &size, data.data()) != VK_SUCCESS) {
+            return;
+        }
+        data.resize(size);
+
+        uint64_t dataHash = hashBytes(data.data(), data.size());
+        if (dataHash == m_dataHash) {
+            return;
+        }
+
+        PipelineCacheHeader header{};
+        header.magic = PIPELINE_CACHE_MAGIC;
+        header.version = PIPELINE_CACHE_VERSION;
+        header.vendorID = m_properties.vendorID;
+        header.deviceID = m_properties.deviceID;
+        header.driverVersion = m_properties.driverVersion;
+        std::memcpy(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE);
+        header.shaderHash = m_shaderHash;
+        header.dataSize = data.size();
+        header.dataHash = dataHash;
+
+        writeFileAtomic(m_path.data(), [&](std::ostream& file) {
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(data.data(), data.size());
+        });
+        m_dataHash = dataHash;
+    }
+
+    VkPipeline PipelineCache::createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo)
+    {
+        std::vector<VkPipelineCreationFeedbackEXT> stageFeedbacks(createInfo.stageCount);
+        VkPipelineCreationFeedbackEXT feedback{};
+
+        VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo{ VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT };
+        feedbackInfo.pNext = createInfo.pNext;
+        feedbackInfo.pPipelineCreationFeedback = &feedback;
+        feedbackInfo.pipelineStageCreationFeedbackCount = createInfo.stageCount;
+        feedbackInfo.pPipelineStageCreationFeedbacks = stageFeedbacks.data();
+
+        VkGraphicsPipelineCreateInfo info = createInfo;
+        if (m_creationFeedback) {
+            info.pNext = &feedbackInfo;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        VkPipeline pipeline;
+        if (vkCreateGraphicsPipelines(m_device, m_cache, 1, &info, nullptr, &pipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create graphics pipeline!");
+        }
+
+        recordCreation(elapsedMs(start), feedback);
+        return pipeline;
+    }
+
+    VkPipeline PipelineCache::createComputePipeline(const VkComputePipelineCreateInfo& createInfo)
+    {
+        VkPipelineCreationFeedbackEXT stageFeedback{};
+        VkPipelineCreationFeedbackEXT feedback{};
+
+        VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo{ VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT };
+        feedbackInfo.pNext = createInfo.pNext;
+        feedbackInfo.pPipelineCreationFeedback = &feedback;
+        feedbackInfo.pipelineStageCreationFeedbackCount = 1;
+        feedbackInfo.pPipelineStageCreationFeedbacks = &stageFeedback;
+
+        VkComputePipelineCreateInfo info = createInfo;
+        if (m_creationFeedback) {
+            info.pNext = &feedbackInfo;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        VkPipeline pipeline;
+        if (vkCreateComputePipelines(m_device, m_cache, 1, &info, nullptr, &pipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create compute pipeline!");
+        }
+
+        recordCreation(elapsedMs(start), feedback);
+        return pipeline;
+    }
+
+    void PipelineCache::recordCreation(float ms, const VkPipelineCreationFeedbackEXT& feedback)
+    {
+        bool hit = m_stats.loaded;
+        if (m_creationFeedback && (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT)) {
+            hit = (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) != 0;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (hit) {
+            m_stats.hitCount++;
+            m_stats.hitMs += ms;
+        }
+        else {
+            m_stats.missCount++;
+            m_stats.missMs += ms;
+        }
+    }
+
+    VkPipelineCache PipelineCache::getCache() const
+    {
+        return m_cache;
+    }
+
+    PipelineCacheStats PipelineCache::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+    void PipelineCache::printStats() const
+    {
+        PipelineCacheStats stats = getStats();
+
+        std::cout << "pipeline cache: ";
+        if (stats.loaded) {
+            std::cout << stats.loadedBytes << " bytes loaded in " << stats.loadMs << " ms, ";
+        }
+        else {
+            std::cout << "cold start, ";
+        }
+        std::cout << stats.hitCount << " hits in " << stats.hitMs << " ms, "
+            << stats.missCount << " misses in " << stats.missMs << " ms" << std::endl;
+    }
+
+    uint64_t PipelineCache::hashShaders(const std::string& shaderDirectory)
+    {
+        std::vector<std::filesystem::path> paths;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(shaderDirectory, error)) {
+            if (entry.path().extension() == ".spv") {
+                paths.push_back(entry.path());
+            }
+        }
+        std::sort(paths.begin(), paths.end());
+
+        uint64_t hash = HASH_SEED;
+        for (const auto& path : paths) {
+            std::string name = path.filename().string();
+            hash = hashBytes(name.data(), name.size(), hash);
+
+            std::ifstream file(path, std::ios::binary);
+            std::vector<char> code((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            hash = hashBytes(code.data(), code.size(), hash);
+        }
+
+        return hash;
+    }
+
+}
@@ -0,0 +1,199 @@
+#include "PipelineRegistry.h"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <filesystem>
+
+#include "VkUtil.h"
+#include "PipelineCache.h"
+
+namespace vulkan {
+
+    PipelineRegistry::PipelineRegistry(VkDevice device, PipelineCache& pipelineCache, JobSystem& jobs, const std::string& shaderDirectory)
+        : m_device(device), m_pipelineCache(pipelineCache), m_jobs(jobs), m_shaderDirectory(shaderDirectory),
+        m_entries(new Entry[MAX_PIPELINES])
+    {
+    }
+
+    PipelineRegistry::~PipelineRegistry()
+    {
+        uint32_t entryCount = m_entryCount.load();
+        for (uint32_t i = 0; i < entryCount; i++) {
+            m_jobs.wait(m_entries[i].compiled);
+        }
+
+        // variants may still be bound by frames in flight
+        vkDeviceWaitIdle(m_device);
+
+        for (uint32_t i = 0; i < entryCount; i++) {
+            m_entries[i].pipeline.reset();
+        }
+        for (const auto& layout : m_layouts) {
+            vkDestroyPipelineLayout(m_device, layout.second, nullptr);
+        }
+        for (const auto& module : m_shaderModules) {
+            vkDestroyShaderModule(m_device, module.second, nullptr);
+        }
+    }
+
+    PipelineHandle PipelineRegistry::request(const PipelineDesc& desc)
+    {
+        uint64_t hash = desc.hash();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.requestCount++;
+
+        auto& candidates = m_lookup[hash];
+        for (PipelineHandle candidate : candidates) {
+            if (m_entries[candidate].desc == desc) {
+                m_stats.dedupedCount++;
+                return candidate;
+            }
+        }
+
+        PipelineHandle handle = m_entryCount.load();
+        if (handle >= MAX_PIPELINES) {
+            throw std::runtime_error("failed to register pipeline, registry is full!");
+        }
+
+        Entry& entry = m_entries[handle];
+        entry.desc = desc;
+        entry.layout = getLayout(desc.descriptorSetLayout);
+        candidates.push_back(handle);
+        m_entryCount.store(handle + 1);
+
+        m_jobs.run([this, handle] { compile(handle); }, &entry.compiled);
+
+        return handle;
+    }
+
+    void PipelineRegistry::compile(PipelineHandle handle)
+    {
+        Entry& entry = m_entries[handle];
+        auto start = std::chrono::high_resolution_clock::now();
+
+        try {
+            VkShaderModule vertexShader = getShaderModule(entry.desc.vertexShader);
+            VkShaderModule fragmentShader = getShaderModule(entry.desc.fragmentShader);
+
+            entry.pipeline = std::make_unique<Pipeline>(m_device, m_pipelineCache, entry.desc, entry.layout, vertexShader, fragmentShader);
+            entry.handle.store(entry.pipeline->getPipeline());
+        }
+        catch (const std::exception& e) {
+            std::cerr << "pipeline " << entry.desc.vertexShader << " / " << entry.desc.fragmentShader << " failed: " << e.what() << std::endl;
+            entry.failed.store(true);
+        }
+
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.compileMs += ms;
+        if (entry.failed.load()) {
+            m_stats.failedCount++;
+        }
+        else {
+            m_stats.pipelineCount++;
+        }
+    }
+
+    VkShaderModule PipelineRegistry::getShaderModule(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(m_shaderMutex);
+
+        auto it = m_shaderModules.find(name);
+        if (it != m_shaderModules.end()) {
+            return it->second;
+        }
+
+        auto shader_path = std::filesystem::path(m_shaderDirectory) / name;
+        VkShaderModule module = createShaderModule(m_device, readFile(shader_path.string()));
+        m_shaderModules[name] = module;
+
+        return module;
+    }
+
+    // called with m_mutex held
+    VkPipelineLayout PipelineRegistry::getLayout(VkDescriptorSetLayout descriptorSetLayout)
+    {
+        auto it = m_layouts.find(descriptorSetLayout);
+        if (it != m_layouts.end()) {
+            return it->second;
+        }
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = descriptorSetLayout != VK_NULL_HANDLE ? 1 : 0;
+        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+        VkPipelineLayout layout;
+        if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+
+        m_layouts[descriptorSetLayout] = layout;
+        return layout;
+    }
+
+    VkPipeline PipelineRegistry::getPipeline(PipelineHandle handle) const
+    {
+        if (handle >= m_entryCount.load()) {
+            return VK_NULL_HANDLE;
+        }
+        return m_entries[handle].handle.load();
+    }
+
+    VkPipelineLayout PipelineRegistry::getPipelineLayout(PipelineHandle handle) const
+    {
+        if (handle >= m_entryCount.load()) {
+            return VK_NULL_HANDLE;
+        }
+        return m_entries[handle].layout;
+    }
+
+    bool PipelineRegistry::isReady(PipelineHandle handle) const
+    {
+        return getPipeline(handle) != VK_NULL_HANDLE;
+    }
+
+    void PipelineRegistry::wait(PipelineHandle handle)
+    {
+        if (handle >= m_entryCount.load()) {
+            throw std::runtime_error("failed to wait for pipeline, invalid handle!");
+        }
+
+        Entry& entry = m_entries[handle];
+        m_jobs.wait(entry.compiled);
+
+        if (entry.failed.load()) {
+            throw std::runtime_error("failed to compile pipeline " + entry.desc.vertexShader + " / " + entry.desc.fragmentShader + "!");
+        }
+    }
+
+    void PipelineRegistry::waitAll()
+    {
+        uint32_t entryCount = m_entryCount.load();
+        for (uint32_t i = 0; i < entryCount; i++) {
+            wait(i);
+        }
+    }
+
+    PipelineRegistryStats PipelineRegistry::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+    void PipelineRegistry::printStats() const
+    {
+        PipelineRegistryStats stats = getStats();
+
+        std::cout << "pipeline registry: " << stats.requestCount << " requests, " << stats.dedupedCount << " deduplicated, "
+            << stats.pipelineCount << " pipelines compiled in " << stats.compileMs << " ms";
+        if (stats.failedCount > 0) {
+            std::cout << ", " << stats.failedCount << " failed";
+        }
+        std::cout << std::endl;
+    }
+
+}
@@ -0,0 +1,575 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace vulkan {
+    namespace {
+        struct UsageInfo {
+            VkPipelineStageFlags stages;
+            VkAccessFlags readAccess;
+            VkAccessFlags writeAccess;
+            VkImageLayout layout;
+            VkImageUsageFlags imageUsage;
+        };
+
+        const UsageInfo USAGE_INFOS[static_cast<size_t>(ResourceUsage::Count)] = {
+            // ColorAttachment
+            { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+              VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+              VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT },
+            // DepthAttachment
+            { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+              VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT },
+            // SampledFragment
+            { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+              VK_ACCESS_SHADER_READ_BIT, 0,
+              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT },
+            // SampledCompute
+            { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+              VK_ACCESS_SHADER_READ_BIT, 0,
+              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT },
+            // StorageCompute
+            { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+              VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+              VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT },
+            // TransferSrc
+            { VK_PIPELINE_STAGE_TRANSFER_BIT,
+              VK_ACCESS_TRANSFER_READ_BIT, 0,
+              VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT },
+            // TransferDst
+            { VK_PIPELINE_STAGE_TRANSFER_BIT,
+              0, VK_ACCESS_TRANSFER_WRITE_BIT,
+              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT },
+            // IndirectBuffer
+            { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+              VK_ACCESS_INDIRECT_COMMAND_READ_BIT, 0,
+              VK_IMAGE_LAYOUT_UNDEFINED, 0 },
+            // VertexBuffer
+            { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+              VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, 0,
+              VK_IMAGE_LAYOUT_UNDEFINED, 0 },
+        };
+
+        const UsageInfo& getUsageInfo(ResourceUsage usage) {
+            return USAGE_INFOS[static_cast<size_t>(usage)];
+        }
+    }
+
+    RenderGraph::Pass& RenderGraph::Pass::read(RenderGraphResource resource, ResourceUsage usage)
+    {
+        return addAccess(resource, usage, false, VK_IMAGE_LAYOUT_UNDEFINED);
+    }
+
+    RenderGraph::Pass& RenderGraph::Pass::write(RenderGraphResource resource, ResourceUsage usage, VkImageLayout leftInLayout)
+    {
+        if (getUsageInfo(usage).writeAccess == 0) {
+            throw std::runtime_error("failed to declare render graph write, the usage is read only!");
+        }
+        return addAccess(resource, usage, true, leftInLayout);
+    }
+
+    RenderGraph::Pass& RenderGraph::Pass::setSideEffects()
+    {
+        m_sideEffects = true;
+        return *this;
+    }
+
+    RenderGraph::Pass& RenderGraph::Pass::addAccess(RenderGraphResource resource, ResourceUsage usage, bool write, VkImageLayout leftInLayout)
+    {
+        // one layout per image per pass, a second access would need a barrier inside the pass
+        for (const Access& access : m_accesses) {
+            if (access.resource == resource) {
+                throw std::runtime_error("failed to declare render graph access, resource is already used by the pass!");
+            }
+        }
+
+        m_accesses.push_back({ resource, usage, write, leftInLayout });
+        return *this;
+    }
+
+    RenderGraph::RenderGraph(MemoryAllocator& allocator, VkDevice device)
+        : m_allocator(allocator), m_device(device)
+    {
+    }
+
+    RenderGraph::~RenderGraph()
+    {
+        destroyTransients();
+    }
+
+    RenderGraphResource RenderGraph::createImage(const char* name, const RenderGraphImageDesc& desc)
+    {
+        Resource resource{};
+        resource.name = name;
+        resource.desc = desc;
+
+        m_resources.push_back(resource);
+        m_compiled = false;
+        return static_cast<RenderGraphResource>(m_resources.size() - 1);
+    }
+
+    RenderGraphResource RenderGraph::importImage(const char* name, const RenderGraphImageDesc& desc)
+    {
+        RenderGraphResource handle = createImage(name, desc);
+        m_resources[handle].imported = true;
+        return handle;
+    }
+
+    RenderGraphResource RenderGraph::importBuffer(const char* name)
+    {
+        Resource resource{};
+        resource.name = name;
+        resource.isImage = false;
+        resource.imported = true;
+
+        m_resources.push_back(resource);
+        m_compiled = false;
+        return static_cast<RenderGraphResource>(m_resources.size() - 1);
+    }
+
+    RenderGraph::Pass& RenderGraph::addPass(const char* name, ExecuteFunc execute)
+    {
+        m_passes.push_back(std::make_unique<Pass>());
+        m_passes.back()->m_name = name;
+        m_passes.back()->m_execute = std::move(execute);
+
+        m_compiled = false;
+        return *m_passes.back();
+    }
+
+    void RenderGraph::exportImage(RenderGraphResource resource, VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+    {
+        Resource& image = m_resources[resource];
+        image.exported = true;
+        image.finalLayout = finalLayout;
+        image.finalStage = dstStage;
+        image.finalAccess = dstAccess;
+        m_compiled = false;
+    }
+
+    void RenderGraph::exportBuffer(RenderGraphResource resource, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+    {
+        Resource& buffer = m_resources[resource];
+        buffer.exported = true;
+        buffer.finalStage = dstStage;
+        buffer.finalAccess = dstAccess;
+        m_compiled = false;
+    }
+
+    void RenderGraph::clear()
+    {
+        if (!m_heaps.empty()) {
+            vkDeviceWaitIdle(m_device);
+        }
+        destroyTransients();
+        m_resources.clear();
+        m_passes.clear();
+        m_compiled = false;
+    }
+
+    void RenderGraph::compile()
+    {
+        // recompiling in place is rare, previous frames may still use the images
+        if (!m_heaps.empty()) {
+            vkDeviceWaitIdle(m_device);
+        }
+        destroyTransients();
+        cullPasses();
+
+        for (Resource& resource : m_resources) {
+            resource.firstPass = ~0u;
+            resource.lastPass = 0;
+            if (!resource.imported) {
+                resource.usage = 0;
+            }
+        }
+
+        m_stats = {};
+        for (uint32_t passIndex = 0; passIndex < m_passes.size(); passIndex++) {
+            const Pass& pass = *m_passes[passIndex];
+            if (pass.m_culled) {
+                m_stats.culledPassCount++;
+                continue;
+            }
+            m_stats.passCount++;
+
+            for (const Pass::Access& access : pass.m_accesses) {
+                Resource& resource = m_resources[access.resource];
+                if (!resource.imported && resource.firstPass == ~0u && !access.write) {
+                    throw std::runtime_error("failed to compile render graph, " + resource.name + " is read before it is written!");
+                }
+
+                resource.firstPass = std::min(resource.firstPass, passIndex);
+                resource.lastPass = std::max(resource.lastPass, passIndex);
+                resource.usage |= getUsageInfo(access.usage).imageUsage;
+            }
+        }
+
+        createTransients();
+        m_compiled = true;
+    }
+
+    void RenderGraph::cullPasses()
+    {
+        // walking backwards, a pass survives when it writes something a surviving pass or the caller reads
+        std::vector<bool> needed(m_resources.size());
+        for (size_t i = 0; i < m_resources.size(); i++) {
+            needed[i] = m_resources[i].exported;
+        }
+
+        for (size_t i = m_passes.size(); i-- > 0;) {
+            Pass& pass = *m_passes[i];
+
+            bool alive = pass.m_sideEffects;
+            for (const Pass::Access& access : pass.m_accesses) {
+                alive |= access.write && needed[access.resource];
+            }
+
+            pass.m_culled = !alive;
+            if (!alive) {
+                continue;
+            }
+
+            // writes never clear the flag, earlier writers may still contribute (blending, partial copies)
+            for (const Pass::Access& access : pass.m_accesses) {
+                if (!access.write) {
+                    needed[access.resource] = true;
+                }
+            }
+        }
+    }
+
+    void RenderGraph::createTransients()
+    {
+        std::vector<RenderGraphResource> transients;
+        for (RenderGraphResource i = 0; i < m_resources.size(); i++) {
+            const Resource& resource = m_resources[i];
+            if (resource.isImage && !resource.imported && resource.firstPass != ~0u) {
+                transients.push_back(i);
+            }
+        }
+
+        std::stable_sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+            return m_resources[a].firstPass < m_resources[b].firstPass;
+        });
+
+        // a range is a piece of a heap, images whose pass ranges do not overlap take turns in it
+        struct Range {
+            uint32_t heap;
+            VkDeviceSize offset;
+            VkDeviceSize size;
+            uint32_t lastPass;
+            uint32_t syncState;
+        };
+        std::vector<Range> ranges;
+        std::vector<uint32_t> resourceRanges(m_resources.size(), ~0u);
+
+        for (RenderGraphResource handle : transients) {
+            Resource& resource = m_resources[handle];
+
+            VkImageCreateInfo imageInfo{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+            imageInfo.mipLevels = resource.desc.mipLevels;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = resource.desc.format;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = resource.usage;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            if (vkCreateImage(m_device, &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create render graph image " + resource.name + "!");
+            }
+
+            VkMemoryRequirements requirements;
+            vkGetImageMemoryRequirements(m_device, resource.image, &requirements);
+            m_stats.transientImageCount++;
+            m_stats.transientBytes += requirements.size;
+
+            // best fit among the ranges whose previous owner is done before this image's first pass
+            uint32_t best = ~0u;
+            for (uint32_t i = 0; i < ranges.size(); i++) {
+                const Range& range = ranges[i];
+                if (m_heaps[range.heap].memoryTypeBits != requirements.memoryTypeBits || range.lastPass >= resource.firstPass ||
+                    range.size < requirements.size || range.offset % requirements.alignment != 0) {
+                    continue;
+                }
+                if (best == ~0u || range.size < ranges[best].size) {
+                    best = i;
+                }
+            }
+
+            if (best == ~0u) {
+                uint32_t heapIndex = ~0u;
+                for (uint32_t i = 0; i < m_heaps.size(); i++) {
+                    if (m_heaps[i].memoryTypeBits == requirements.memoryTypeBits) {
+                        heapIndex = i;
+                    }
+                }
+                if (heapIndex == ~0u) {
+                    m_heaps.push_back({});
+                    m_heaps.back().memoryTypeBits = requirements.memoryTypeBits;
+                    heapIndex = static_cast<uint32_t>(m_heaps.size() - 1);
+                }
+
+                Heap& heap = m_heaps[heapIndex];
+                VkDeviceSize offset = (heap.size + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+                heap.size = offset + requirements.size;
+                heap.alignment = std::max(heap.alignment, requirements.alignment);
+
+                ranges.push_back({ heapIndex, offset, requirements.size, resource.lastPass, static_cast<uint32_t>(m_syncStates.size()) });
+                m_syncStates.push_back({});
+                best = static_cast<uint32_t>(ranges.size() - 1);
+            }
+            else {
+                ranges[best].lastPass = resource.lastPass;
+            }
+
+            resource.syncState = ranges[best].syncState;
+            resourceRanges[handle] = best;
+        }
+
+        for (Heap& heap : m_heaps) {
+            VkMemoryRequirements requirements{};
+            requirements.size = heap.size;
+            requirements.alignment = heap.alignment;
+            requirements.memoryTypeBits = heap.memoryTypeBits;
+
+            heap.memory = m_allocator.allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            m_stats.allocatedBytes += heap.size;
+        }
+
+        for (RenderGraphResource handle : transients) {
+            Resource& resource = m_resources[handle];
+            const Range& range = ranges[resourceRanges[handle]];
+            const Heap& heap = m_heaps[range.heap];
+
+            if (vkBindImageMemory(m_device, resource.image, heap.memory.memory, heap.memory.offset + range.offset) != VK_SUCCESS) {
+                throw std::runtime_error("failed to bind render graph image memory!");
+            }
+
+            VkImageViewCreateInfo viewInfo{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+            viewInfo.image = resource.image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = resource.desc.format;
+            viewInfo.subresourceRange = { resource.desc.aspect, 0, resource.desc.mipLevels, 0, 1 };
+
+            if (vkCreateImageView(m_device, &viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create render graph image view!");
+            }
+        }
+    }
+
+    void RenderGraph::destroyTransients()
+    {
+        if (m_heaps.empty()) {
+            return;
+        }
+
+        for (Resource& resource : m_resources) {
+            if (resource.imported) {
+                continue;
+            }
+            vkDestroyImageView(m_device, resource.view, nullptr);
+            vkDestroyImage(m_device, resource.image, nullptr);
+            resource.view = VK_NULL_HANDLE;
+            resource.image = VK_NULL_HANDLE;
+        }
+
+        for (Heap& heap : m_heaps) {
+            m_allocator.free(heap.memory);
+        }
+        m_heaps.clear();
+        m_syncStates.clear();
+        m_compiled = false;
+    }
+
+    void RenderGraph::setImportedImage(RenderGraphResource resource, VkImage image, VkImageView view, VkImageLayout currentLayout, VkPipelineStageFlags readyStage)
+    {
+        Resource& imported = m_resources[resource];
+        imported.image = image;
+        imported.view = view;
+        imported.layout = currentLayout;
+
+        imported.state = {};
+        imported.state.writeStages = readyStage;
+    }
+
+    void RenderGraph::setImportedBuffer(RenderGraphResource resource, VkBuffer buffer)
+    {
+        m_resources[resource].buffer = buffer;
+    }
+
+    void RenderGraph::execute(VkCommandBuffer commandBuffer)
+    {
+        if (!m_compiled) {
+            compile();
+        }
+
+        m_stats.barrierCount = 0;
+        for (Resource& resource : m_resources) {
+            resource.touched = false;
+        }
+
+        for (const auto& pass : m_passes) {
+            if (pass->m_culled) {
+                continue;
+            }
+
+            for (const Pass::Access& access : pass->m_accesses) {
+                Resource& resource = m_resources[access.resource];
+                const UsageInfo& info = getUsageInfo(access.usage);
+                addBarrier(m_batch, resource, info.layout, info.stages, info.readAccess, access.write ? info.writeAccess : 0);
+                resource.touched = true;
+            }
+            flushBarriers(commandBuffer, m_batch);
+
+            pass->m_execute(commandBuffer);
+
+            for (const Pass::Access& access : pass->m_accesses) {
+                if (access.leftInLayout != VK_IMAGE_LAYOUT_UNDEFINED) {
+                    m_resources[access.resource].layout = access.leftInLayout;
+                }
+            }
+        }
+
+        for (Resource& resource : m_resources) {
+            if (!resource.exported || !resource.touched) {
+                continue;
+            }
+
+            VkImageLayout finalLayout = resource.isImage ? resource.finalLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+            if (resource.finalAccess == 0 && finalLayout == resource.layout) {
+                continue;
+            }
+
+            // the consumer outside the graph synchronizes through a semaphore or fence, its reads are not tracked
+            SyncState& state = getSyncState(resource);
+            VkPipelineStageFlags readStages = state.readStages;
+            addBarrier(m_batch, resource, finalLayout, resource.finalStage, resource.finalAccess, 0);
+            state.readStages = readStages;
+        }
+        flushBarriers(commandBuffer, m_batch);
+    }
+
+    RenderGraph::SyncState& RenderGraph::getSyncState(Resource& resource)
+    {
+        return resource.imported ? resource.state : m_syncStates[resource.syncState];
+    }
+
+    void RenderGraph::addBarrier(BarrierBatch& batch, Resource& resource, VkImageLayout newLayout, VkPipelineStageFlags stages,
+        VkAccessFlags readAccess, VkAccessFlags writeAccess)
+    {
+        SyncState& state = getSyncState(resource);
+
+        // transients start every frame undefined, their contents never carry over, neither from the last frame nor an alias
+        VkImageLayout oldLayout = (resource.imported || resource.touched) ? resource.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+        bool transition = resource.isImage && oldLayout != newLayout;
+
+        VkPipelineStageFlags srcStages = 0;
+        VkAccessFlags srcAccess = 0;
+        bool needed = transition;
+
+        if (writeAccess != 0 || transition) {
+            // write after write and write after read, a layout transition writes the image as well
+            srcStages = state.writeStages | state.readStages;
+            srcAccess = state.writeAccess;
+            needed |= srcStages != 0;
+
+            state.writeStages = stages;
+            state.writeAccess = writeAccess;
+            state.readStages = writeAccess != 0 ? 0 : stages;
+            state.visibleStages = stages;
+            state.visibleAccess = readAccess | writeAccess;
+        }
+        else {
+            // read after write, only when the write has not been made visible to this stage and access yet
+            if (state.writeStages != 0 && ((stages & ~state.visibleStages) != 0 || (readAccess & ~state.visibleAccess) != 0)) {
+                srcStages = state.writeStages;
+                srcAccess = state.writeAccess;
+                needed = true;
+
+                state.visibleStages |= stages;
+                state.visibleAccess |= readAccess;
+            }
+            state.readStages |= stages;
+        }
+
+        if (resource.isImage) {
+            resource.layout = newLayout;
+        }
+
+        if (!needed) {
+            return;
+        }
+
+        batch.srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        batch.dstStages |= stages;
+        m_stats.barrierCount++;
+
+        if (resource.isImage) {
+            VkImageMemoryBarrier barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstAccessMask = readAccess | writeAccess;
+            barrier.oldLayout = oldLayout;
+            barrier.newLayout = newLayout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = resource.image;
+            barrier.subresourceRange = { resource.desc.aspect, 0, resource.desc.mipLevels, 0, 1 };
+            batch.imageBarriers.push_back(barrier);
+        }
+        else {
+            VkBufferMemoryBarrier barrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstAccessMask = readAccess | writeAccess;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = resource.buffer;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            batch.bufferBarriers.push_back(barrier);
+        }
+    }
+
+    void RenderGraph::flushBarriers(VkCommandBuffer commandBuffer, BarrierBatch& batch)
+    {
+        if (batch.imageBarriers.empty() && batch.bufferBarriers.empty()) {
+            return;
+        }
+
+        vkCmdPipelineBarrier(commandBuffer, batch.srcStages, batch.dstStages, 0, 0, nullptr,
+            static_cast<uint32_t>(batch.bufferBarriers.size()), batch.bufferBarriers.data(),
+            static_cast<uint32_t>(batch.imageBarriers.size()), batch.imageBarriers.data());
+
+        batch.srcStages = 0;
+        batch.dstStages = 0;
+        batch.imageBarriers.clear();
+        batch.bufferBarriers.clear();
+    }
+
+    VkImage RenderGraph::getImage(RenderGraphResource resource) const
+    {
+        return m_resources[resource].image;
+    }
+
+    VkImageView RenderGraph::getImageView(RenderGraphResource resource) const
+    {
+        return m_resources[resource].view;
+    }
+
+    VkBuffer RenderGraph::getBuffer(RenderGraphResource resource) const
+    {
+        return m_resources[resource].buffer;
+    }
+
+    const RenderGraphStats& RenderGraph::getStats() const
+    {
+        return m_stats;
+    }
+
+}
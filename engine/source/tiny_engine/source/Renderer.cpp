@@ -2,14 +2,11 @@
 
 #include <chrono>
 #include <iostream>
-#include <unordered_map>
 #include <filesystem>
 
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtx/hash.hpp>
-#include <tinyobjloader/tiny_obj_loader.h>
 
 #include <imgui/imgui.h>
 #include <imgui/imgui_internal.h>
@@ -20,29 +17,33 @@
 #include "Descriptor.h"
 #include "Mesh.h"
 #include "Texture.h"
+#include "TextureFile.h"
 #include "Pipeline.h"
+#include "PipelineCache.h"
+#include "UploadManager.h"
+#include "JobSystem.h"
+#include "ObjImporter.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
 #include "ArcBallCamera.h"
 #include "UserInput.h"
 #include "common_utils.h"
 
-namespace std {
-    template<> struct hash<vulkan::Vertex> {
-        size_t operator()(vulkan::Vertex const& vertex) const {
-            return ((hash<glm::vec3>()(vertex.pos) ^
-                (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-                (hash<glm::vec2>()(vertex.texCoord) << 1);
-        }
-    };
-}
-
 namespace vulkan {
-    Renderer::Renderer(void* windowHandle, uint32_t width, uint32_t height) :
+    Renderer::Renderer(void* windowHandle, uint32_t width, uint32_t height, JobSystem& jobs) :
         m_width(width), m_height(height),
+        m_jobs(jobs),
         m_context((GLFWwindow*)windowHandle),
-        m_sampler(m_context.getPhysicalDevice(), m_context.getDevice()),
-        m_uniform(m_context.getPhysicalDevice(), m_context.getDevice()),
-        m_swapChain(m_context.getPhysicalDevice(), m_context.getDevice(), m_context.getSurface(), m_width, m_height),
-        m_syncResrc(m_context.getDevice())
+        m_sampler(m_context.getPhysicalDevice(), m_context.getDevice(), m_context.getEnabledDeviceFeatures()),
+        m_uniform(m_context.getAllocator(), m_context.getDevice()),
+        m_swapChain(m_context.getPhysicalDevice(), m_context.getDevice(), m_context.getAllocator(), m_context.getDeletionQueue(), m_context.getSurface(), width, height),
+        m_pacer(m_context.getDevice(), m_context.getDeletionQueue()),
+        m_scene(m_context.getAllocator(), m_context.getDevice()),
+        m_recorder(m_context.getDevice(), m_context.getGraphicsQueueFamilyIndex(), jobs),
+        m_pipelineRegistry(m_context.getDevice(), m_context.getPipelineCache(), jobs,
+            (Utils::getCurrentProcessDirectory().parent_path().parent_path() / "engine/shaders").string())
     {
         // Setup a default look-at camera
         m_camera.type = Camera::CameraType::lookat;
@@ -54,22 +55,75 @@ namespace vulkan {
         auto source_path = exe_path.parent_path().parent_path();
         auto tex_path = source_path / "engine/assets/Boat/texture/bench 1_Base_color.png";
         auto obj_model_path = source_path / "engine/assets/Boat/Boat.obj";
-        createTexture(tex_path.string().data(), ALBEDO);
-        loadObjModel(obj_model_path.string().data());
+        // image decode and obj parsing overlap, both feed the same upload batch
+        auto loadStart = std::chrono::high_resolution_clock::now();
+        MeshHandle boat = INVALID_HANDLE;
+        JobCounter loading;
+        m_jobs.run([&] { createTexture(tex_path.string().data(), ALBEDO); }, &loading);
+        m_jobs.run([&] { boat = loadObjModel(obj_model_path.string().data()); }, &loading);
+        m_jobs.wait(loading);
+
+        auto loadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+        if (enableVerboseOutput) {
+            std::cout << "assets loaded in " << loadTime << " ms on " << m_jobs.getThreadCount() << " threads" << std::endl;
+        }
+
+        MaterialHandle boatMaterial = createMaterial(ALBEDO);
+
+        m_scene.addNode(boat, boatMaterial, glm::mat4(1.0f));
+
+        VkPhysicalDeviceFeatures features = m_context.getEnabledDeviceFeatures();
+        m_scene.setClusterCulling(features.multiDrawIndirect && features.drawIndirectFirstInstance);
+        m_maxDrawIndirectCount = features.multiDrawIndirect ? m_context.getDeviceProperties().limits.maxDrawIndirectCount : 1;
 
-        createDescriptor(ALBEDO);
-        createPipleline();
+        // materials only queue their variants, the first frame needs them compiled
+        m_pipelineRegistry.waitAll();
+
+        m_depthPyramid = std::make_unique<DepthPyramid>(m_context.getAllocator(), m_context.getDevice(), m_context.getPipelineCache(),
+            m_swapChain.getDepthImageView(), m_swapChain.getExtent());
+        createRenderGraph();
 
         createCommandBuffers();
+
+        // texture and mesh uploads go out as a single batch, the first frame is queued behind it
+        m_context.getUploadManager().flush();
+
+        if (enableVerboseOutput) {
+            m_context.getAllocator().printStats();
+            m_context.getPipelineCache().printStats();
+            m_pipelineRegistry.printStats();
+        }
     }
 
     void Renderer::createTexture(const char* path, TextureType texType) {
-        m_textures[texType] = Texture::load(m_context.getPhysicalDevice(), m_context.getDevice(), m_context.getGraphicsQueue(), m_context.getGraphicsCommandPool(), path);
+        // textures cooked by the texture cooker sit beside their source and are uploaded with their mips as stored
+        std::string cookedPath = std::filesystem::path(path).replace_extension(".tex").string();
+
+        std::shared_ptr<Texture> texture;
+        if (TextureFile::isUpToDate(cookedPath.data(), path)) {
+            TextureFile file(cookedPath.data());
+            if (!isBlockCompressed(file.getFormat()) || m_context.getEnabledDeviceFeatures().textureCompressionBC) {
+                texture = Texture::load(m_context.getAllocator(), m_context.getDevice(), m_context.getUploadManager(), m_context.getDeletionQueue(),
+                    file);
+            }
+        }
+
+        if (!texture) {
+            // source textures are srgb rgba8, which every device should blit, the cpu filter covers the ones that do not
+            TextureMips mips = supportsLinearBlit(m_context.getPhysicalDevice(), VK_FORMAT_R8G8B8A8_SRGB) ? TextureMips::Gpu : TextureMips::Cpu;
+            texture = Texture::load(m_context.getAllocator(), m_context.getDevice(), m_context.getUploadManager(), m_context.getDeletionQueue(),
+                path, false, mips);
+        }
+
+        std::lock_guard<std::mutex> lock(m_assetMutex);
+        m_textures[texType] = texture;
     }
 
     Renderer::~Renderer()
     {
-
+        m_context.getUploadManager().waitIdle();
+        // render targets and retired swap chains are destroyed without waiting
+        vkDeviceWaitIdle(m_context.getDevice());
     }
 
     void Renderer::createCommandBuffers() {
@@ -92,49 +146,69 @@ namespace vulkan {
 
     }
 
-    void Renderer::loadObjModel(const char* path) {
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn, err;
+    MeshHandle Renderer::loadObjModel(const char* path) {
+        // the obj is only parsed when its cooked cache is missing or stale
+        std::string cookedPath = std::filesystem::path(path).replace_extension(".mesh").string();
 
-        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path)) {
-            throw std::runtime_error(warn + err);
-        }
+        if (!MeshFile::isUpToDate(cookedPath.data(), path)) {
+            ObjImportStats stats{};
+            MeshData data = ObjImporter::load(path, m_jobs, &stats);
 
-        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-        
-        vertices.clear();
-        indices.clear();
+            if (enableVerboseOutput) {
+                std::cout << "obj import: " << stats.cornerCount / 3 << " triangles, " << data.vertices.size() << " vertices, "
+                    << stats.chunkCount << " chunks, read " << stats.readMs << " ms, parse " << stats.parseMs << " ms, weld " << stats.dedupMs << " ms" << std::endl;
+            }
 
-        for (const auto& shape : shapes) {
-            for (const auto& index : shape.mesh.indices) {
-                Vertex vertex{};
-        
-                vertex.pos = {
-                    attrib.vertices[3 * index.vertex_index + 0],
-                    attrib.vertices[3 * index.vertex_index + 1],
-                    attrib.vertices[3 * index.vertex_index + 2]
-                };
-        
-                vertex.texCoord = {
-                    attrib.texcoords[2 * index.texcoord_index + 0],
-                    1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-                };
-        
-                vertex.color = { 1.0f, 1.0f, 1.0f };
-        
-                if (uniqueVertices.count(vertex) == 0) {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex);
+            MeshOptimizationStats optimizeStats{};
+            MeshOptimizer::optimize(data, &optimizeStats);
+
+            if (enableVerboseOutput) {
+                std::cout << "mesh optimize: acmr " << optimizeStats.before.acmr << " -> " << optimizeStats.after.acmr
+                    << ", atvr " << optimizeStats.before.atvr << " -> " << optimizeStats.after.atvr
+                    << ", " << optimizeStats.clusterCount << " overdraw clusters, " << optimizeStats.optimizeMs << " ms" << std::endl;
+            }
+
+            MeshLodStats lodStats{};
+            MeshSimplifier::generateLods(data, MAX_MESH_LODS, 0.1f, &lodStats);
+            if (enableVerboseOutput) {
+                std::cout << "lods: " << lodStats.lodCount << " in " << lodStats.simplifyMs << " ms,";
+                for (uint32_t i = 0; i < lodStats.lodCount; i++) {
+                    std::cout << " " << lodStats.triangleCounts[i];
                 }
-        
-                indices.push_back(uniqueVertices[vertex]);
+                std::cout << " triangles" << std::endl;
             }
+
+            MeshletBuilder::build(data);
+            if (enableVerboseOutput) {
+                std::cout << "meshlets: " << data.meshlets.size() << ", " << float(data.indices.size() / 3) / std::max<size_t>(data.meshlets.size(), 1)
+                    << " triangles each" << std::endl;
+            }
+
+            MeshFile::write(cookedPath.data(), data, MeshFile::getSourceStamp(path));
         }
 
-        // TODO: why non-member variable will cause a link error
-        m_mesh = Mesh::load(m_context.getPhysicalDevice(), m_context.getDevice(), m_context.getGraphicsQueue(), m_context.getGraphicsCommandPool(), vertices, indices);
+        auto loadStart = std::chrono::high_resolution_clock::now();
+
+        MeshFile file(cookedPath.data());
+        const void* streams[MAX_VERTEX_STREAMS] = {};
+        file.getVertexStreams(streams);
+        std::vector<uint8_t> indexScratch;
+
+        auto mesh = Mesh::load(m_context.getAllocator(), m_context.getDevice(), m_context.getUploadManager(), m_context.getDeletionQueue(),
+            file.getLayout(), streams, file.getSectionCount(MESH_SECTION_VERTEX_STREAM_0),
+            file.getIndices(indexScratch), file.getSectionCount(MESH_SECTION_INDICES), file.getIndexType(),
+            file.getBounds(), static_cast<const Meshlet*>(file.getSectionData(MESH_SECTION_MESHLETS)), file.getSectionCount(MESH_SECTION_MESHLETS),
+            static_cast<const MeshLod*>(file.getSectionData(MESH_SECTION_LODS)), file.getSectionCount(MESH_SECTION_LODS));
+
+        auto loadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+        if (enableVerboseOutput) {
+            std::cout << "mesh " << cookedPath << " streamed in " << loadTime << " ms, "
+                << file.getLayout().getVertexSize() << " bytes per vertex in " << file.getLayout().getStreamCount() << " streams, "
+                << (file.getIndexType() == VK_INDEX_TYPE_UINT16 ? 16 : 32) << " bit indices" << std::endl;
+        }
+
+        std::lock_guard<std::mutex> lock(m_assetMutex);
+        return m_scene.addMesh(mesh);
     }
 
     void Renderer::Render(uint32_t width, uint32_t height, sss::UserInput& userInput) {
@@ -155,22 +229,33 @@ namespace vulkan {
         
         userInput.input();
 
+        // minimized, a swap chain cannot have an empty extent
+        if (m_width == 0 || m_height == 0) {
+            return;
+        }
+
         VkDevice device = m_context.getDevice();
+        UploadManager& uploader = m_context.getUploadManager();
+
+        uploader.update();
 
-        vkWaitForFences(device, 1, &m_syncResrc.getInFlightFence(currentFrame), VK_TRUE, UINT64_MAX);
+        // only blocks while the gpu is MAX_FRAMES_IN_FLIGHT frames behind
+        currentFrame = m_pacer.beginFrame();
 
-        uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR(device, m_swapChain.getSwapchain(), UINT64_MAX, m_syncResrc.getImageAvailSemaphore(currentFrame), VK_NULL_HANDLE, &imageIndex);
+        // the previous frame's depth when it has already finished, otherwise the one this slot just waited for
+        uint32_t previousFrame = (currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+        uint32_t occlusionFrame = m_pacer.isComplete(m_pacer.getSubmittedValue()) ? previousFrame : currentFrame;
+        m_occlusion.update(m_depthPyramid->getReadback(occlusionFrame));
+
+        VkResult result = vkAcquireNextImageKHR(device, m_swapChain.getSwapchain(), UINT64_MAX, m_pacer.getImageAvailSemaphore(), VK_NULL_HANDLE, &m_imageIndex);
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-            // m_swapChain.recreate(m_width, m_height);
+            recreateSwapChain();
             return;
         }
         else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
             throw std::runtime_error("failed to acquire swap chain image!");
         }
-
-        vkResetFences(device, 1, &m_syncResrc.getInFlightFence(currentFrame));
         
         const glm::vec2 mouseDelta = userInput.getMousePosDelta();
         const float scrollDelta = userInput.getScrollOffset().y;
@@ -211,28 +296,22 @@ namespace vulkan {
         
         updateUniformBuffer(currentFrame);
 
-        vkResetCommandBuffer(m_commandBuffers[currentFrame], /*VkCommandBufferResetFlagBits*/ 0);
-        recordCommandBuffer();
-
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-        VkSemaphore waitSemaphores[] = { m_syncResrc.getImageAvailSemaphore(currentFrame) };
-        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
+        SceneView view{};
+        view.viewProjection = m_camera.matrices.perspective * m_camera.matrices.view;
+        view.eye = glm::vec3(glm::inverse(m_camera.matrices.view)[3]);
+        view.occlusion = &m_occlusion;
+        view.lodScale = m_swapChain.getExtent().height / (2.0f * std::tan(glm::radians(m_camera.getFov()) * 0.5f));
+        m_scene.update(currentFrame, view);
 
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &m_commandBuffers[currentFrame];
+        // anything recorded since the last frame has to reach the queue ahead of the draw that uses it
+        uploader.flush();
 
-        VkSemaphore signalSemaphores[] = { m_syncResrc.getRenderFinishedSemaphore(currentFrame) };
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
+        vkResetCommandBuffer(m_commandBuffers[currentFrame], /*VkCommandBufferResetFlagBits*/ 0);
+        recordCommandBuffer();
 
-        if (vkQueueSubmit(m_context.getGraphicsQueue(), 1, &submitInfo, m_syncResrc.getInFlightFence(currentFrame)) != VK_SUCCESS) {
-            throw std::runtime_error("failed to submit draw command buffer!");
-        }
+        VkSemaphore signalSemaphores[] = {
+            m_pacer.submit(m_context.getGraphicsQueue(), m_context.getQueueMutex(m_context.getGraphicsQueue()), m_commandBuffers[currentFrame],
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT) };
 
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -243,19 +322,94 @@ namespace vulkan {
         VkSwapchainKHR swapChains[] = { m_swapChain.getSwapchain() };
         presentInfo.swapchainCount = 1;
         presentInfo.pSwapchains = swapChains;
-        presentInfo.pImageIndices = &imageIndex;
+        presentInfo.pImageIndices = &m_imageIndex;
 
-        result = vkQueuePresentKHR(m_context.getPresentQueue(), &presentInfo);
+        {
+            std::lock_guard<std::mutex> queueLock(m_context.getQueueMutex(m_context.getPresentQueue()));
+            result = vkQueuePresentKHR(m_context.getPresentQueue(), &presentInfo);
+        }
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
             framebufferResized = false;
-            // m_swapChain.recreate(m_width, m_height);
+            recreateSwapChain();
         }
         else if (result != VK_SUCCESS) {
             throw std::runtime_error("failed to present swap chain image!");
         }
+    }
+
+    void Renderer::recreateSwapChain() {
+        // frames up to the last submitted one may still render to the old images and read the old targets
+        m_swapChain.recreate(m_width, m_height);
+
+        std::shared_ptr<RenderGraph> renderGraph(std::move(m_renderGraph));
+        std::shared_ptr<DepthPyramid> depthPyramid(std::move(m_depthPyramid));
+        // the last references go with the deferred function, once the frames that executed them completed
+        m_pacer.defer([renderGraph, depthPyramid] {});
+
+        // pipelines use dynamic viewport and scissor and the render pass is kept, none of them is rebuilt
+        m_depthPyramid = std::make_unique<DepthPyramid>(m_context.getAllocator(), m_context.getDevice(), m_context.getPipelineCache(),
+            m_swapChain.getDepthImageView(), m_swapChain.getExtent());
+        createRenderGraph();
 
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        VkExtent2D extent = m_swapChain.getExtent();
+        m_camera.updateAspectRatio(extent.width / (float)extent.height);
+    }
+
+    void Renderer::createRenderGraph() {
+        m_renderGraph = std::make_unique<RenderGraph>(m_context.getAllocator(), m_context.getDevice());
+
+        VkExtent2D extent = m_swapChain.getExtent();
+
+        RenderGraphImageDesc colorDesc{};
+        colorDesc.format = m_swapChain.getImageFormat();
+        colorDesc.extent = extent;
+        m_colorTarget = m_renderGraph->importImage("swap chain", colorDesc);
+
+        RenderGraphImageDesc depthDesc{};
+        depthDesc.format = m_swapChain.getDepthFormat();
+        depthDesc.extent = extent;
+        // layout transitions of combined depth stencil formats have to name both aspects
+        depthDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+        if (depthDesc.format == VK_FORMAT_D32_SFLOAT_S8_UINT || depthDesc.format == VK_FORMAT_D24_UNORM_S8_UINT) {
+            depthDesc.aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+        }
+        m_depthTarget = m_renderGraph->importImage("depth", depthDesc);
+        m_renderGraph->setImportedImage(m_depthTarget, m_swapChain.getDepthImage(), m_swapChain.getDepthImageView(), VK_IMAGE_LAYOUT_UNDEFINED);
+
+        m_pyramidTarget = m_renderGraph->createImage("depth pyramid", m_depthPyramid->getImageDesc());
+        m_readbackTarget = m_renderGraph->importBuffer("depth readback");
+
+        // the render pass leaves the swap chain image ready to present
+        m_renderGraph->addPass("scene", [this](VkCommandBuffer commandBuffer) { recordScenePass(commandBuffer); })
+            .write(m_colorTarget, ResourceUsage::ColorAttachment, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
+            .write(m_depthTarget, ResourceUsage::DepthAttachment);
+
+        m_renderGraph->addPass("depth pyramid", [this](VkCommandBuffer commandBuffer) { m_depthPyramid->recordReduce(commandBuffer); })
+            .read(m_depthTarget, ResourceUsage::SampledCompute)
+            .write(m_pyramidTarget, ResourceUsage::StorageCompute);
+
+        m_renderGraph->addPass("depth readback", [this](VkCommandBuffer commandBuffer) {
+                // same clip space as the uniform, so pyramid texels line up with framebuffer rows
+                glm::mat4 projection = m_camera.matrices.perspective;
+                projection[1][1] *= -1;
+                m_depthPyramid->recordReadback(commandBuffer, currentFrame, projection * m_camera.matrices.view);
+            })
+            .read(m_pyramidTarget, ResourceUsage::TransferSrc)
+            .write(m_readbackTarget, ResourceUsage::TransferDst);
+
+        m_renderGraph->exportImage(m_colorTarget, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        m_renderGraph->exportBuffer(m_readbackTarget, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+
+        m_renderGraph->compile();
+        m_depthPyramid->setImage(m_renderGraph->getImage(m_pyramidTarget));
+
+        if (enableVerboseOutput) {
+            const RenderGraphStats& stats = m_renderGraph->getStats();
+            std::cout << "render graph: " << stats.passCount << " passes, " << stats.culledPassCount << " culled, "
+                << stats.transientImageCount << " transient images in " << stats.allocatedBytes / 1024 << " KB ("
+                << stats.transientBytes / 1024 << " KB unaliased)" << std::endl;
+        }
     }
 
     void Renderer::recordCommandBuffer() {
@@ -267,10 +421,30 @@ namespace vulkan {
             throw std::runtime_error("failed to begin recording command buffer!");
         }
 
+        // uploads from a dedicated transfer queue change owner and get their mip chains before anything reads them
+        UploadManager& uploader = m_context.getUploadManager();
+        UploadTicket acquiredTicket = uploader.recordAcquire(commandBuffer);
+        if (acquiredTicket != 0) {
+            m_pacer.waitFor(uploader.getSemaphore(), acquiredTicket, UploadManager::ACQUIRE_STAGES);
+        }
+        m_acquiredTicket = uploader.getAcquiredTicket();
+
+        // the acquire semaphore is waited on at color attachment output, the first barrier on the image chains to it
+        m_renderGraph->setImportedImage(m_colorTarget, m_swapChain.getImage(m_imageIndex), m_swapChain.getImageView(m_imageIndex),
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        m_renderGraph->setImportedBuffer(m_readbackTarget, m_depthPyramid->getReadbackBuffer(currentFrame));
+        m_renderGraph->execute(commandBuffer);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+    }
+
+    void Renderer::recordScenePass(VkCommandBuffer commandBuffer) {
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassInfo.renderPass = m_swapChain.getRenderPass();
-        renderPassInfo.framebuffer = m_swapChain.getFramebuffer(currentFrame);
+        renderPassInfo.framebuffer = m_swapChain.getFramebuffer(m_imageIndex);
 
         renderPassInfo.renderArea.offset = { 0, 0 };
         renderPassInfo.renderArea.extent = m_swapChain.getExtent();
@@ -282,21 +456,106 @@ namespace vulkan {
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
 
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->getPipeline());
+        const uint32_t batchCount = static_cast<uint32_t>(m_scene.getBatches().size());
 
-            VkBuffer vertexBuffers[] = { m_mesh->getVertexBuffer() };
-            VkDeviceSize offsets[] = { 0 };
+        // small scenes are cheaper to record inline than to fan out
+        if (batchCount < 2 * CommandRecorder::MIN_ITEMS_PER_SLICE) {
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+                recordBatches(commandBuffer, 0, batchCount);
+            vkCmdEndRenderPass(commandBuffer);
+        }
+        else {
+            VkCommandBufferInheritanceInfo inheritanceInfo{};
+            inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            inheritanceInfo.renderPass = renderPassInfo.renderPass;
+            inheritanceInfo.subpass = 0;
+            inheritanceInfo.framebuffer = renderPassInfo.framebuffer;
+
+            m_recorder.beginFrame(currentFrame);
+            const auto& secondaries = m_recorder.record(currentFrame, batchCount, inheritanceInfo,
+                [this](VkCommandBuffer secondary, uint32_t first, uint32_t last) { recordBatches(secondary, first, last); });
+
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+            vkCmdEndRenderPass(commandBuffer);
+        }
+    }
 
-            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-            vkCmdBindIndexBuffer(commandBuffer, m_mesh->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
-            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->getPipelineLayout(), 0, 1, &m_descriptor->getDescriptorSet(currentFrame), 0, nullptr);
+    // called concurrently from the recorder's threads, must only read renderer state
+    void Renderer::recordBatches(VkCommandBuffer commandBuffer, uint32_t first, uint32_t last) {
+        // dynamic state is not inherited by secondary command buffers, every slice sets it
+        VkExtent2D extent = m_swapChain.getExtent();
+        VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f };
+        VkRect2D scissor{ { 0, 0 }, extent };
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        // one multi-draw per clustered (material, mesh) batch, one draw per lod otherwise, state is only rebound when it changes
+        VkPipeline boundPipeline = VK_NULL_HANDLE;
+        MaterialHandle boundMaterial = INVALID_HANDLE;
+        MeshHandle boundMesh = INVALID_HANDLE;
+        const auto& batches = m_scene.getBatches();
+
+        for (uint32_t i = first; i < last; i++) {
+            const DrawBatch& batch = batches[i];
+            if (batch.commandCount == 0) {
+                continue;
+            }
 
-            vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
-         vkCmdEndRenderPass(commandBuffer);
+            // assets loaded after this frame's flush are still in the recording batch, or not acquired on this queue yet
+            if (m_scene.getMesh(batch.mesh).getUploadTicket() > m_acquiredTicket ||
+                m_scene.getMaterial(batch.material).albedo->getUploadTicket() > m_acquiredTicket) {
+                continue;
+            }
 
-        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-            throw std::runtime_error("failed to record command buffer!");
+            // a variant still compiling skips its draws for this frame
+            PipelineHandle pipelineHandle = m_materialPipelines[batch.material];
+            VkPipeline pipeline = m_pipelineRegistry.getPipeline(pipelineHandle);
+            if (pipeline == VK_NULL_HANDLE) {
+                continue;
+            }
+
+            if (pipeline != boundPipeline) {
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                boundPipeline = pipeline;
+            }
+
+            if (batch.material != boundMaterial) {
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineRegistry.getPipelineLayout(pipelineHandle), 0, 1,
+                    &m_materialDescriptors[batch.material]->getDescriptorSet(), 1, &m_uboOffset);
+                boundMaterial = batch.material;
+            }
+
+            if (batch.mesh != boundMesh) {
+                const Mesh& mesh = m_scene.getMesh(batch.mesh);
+                VkDeviceSize offsets[MAX_VERTEX_STREAMS] = {};
+
+                vkCmdBindVertexBuffers(commandBuffer, 0, mesh.getStreamCount(), mesh.getVertexBuffers(), offsets);
+                vkCmdBindIndexBuffer(commandBuffer, mesh.getIndexBuffer(), 0, mesh.getIndexType());
+                boundMesh = batch.mesh;
+            }
+
+            VkBuffer instanceBuffers[] = { m_scene.getInstanceBuffer(currentFrame) };
+
+            // one draw per lod, each with the lod's instances bound so the commands keep firstInstance 0
+            if (!batch.clustered) {
+                for (uint32_t command = 0; command < batch.commandCount; command++) {
+                    VkDeviceSize instanceOffsets[] = { (batch.firstInstance + batch.lodFirstInstance[command]) * sizeof(InstanceData) };
+                    vkCmdBindVertexBuffers(commandBuffer, MAX_VERTEX_STREAMS, 1, instanceBuffers, instanceOffsets);
+                    vkCmdDrawIndexedIndirect(commandBuffer, m_scene.getIndirectBuffer(currentFrame),
+                        (batch.firstCommand + command) * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+                }
+                continue;
+            }
+
+            VkDeviceSize instanceOffsets[] = { batch.firstInstance * sizeof(InstanceData) };
+            vkCmdBindVertexBuffers(commandBuffer, MAX_VERTEX_STREAMS, 1, instanceBuffers, instanceOffsets);
+
+            for (uint32_t command = 0; command < batch.commandCount; command += m_maxDrawIndirectCount) {
+                uint32_t drawCount = std::min(batch.commandCount - command, m_maxDrawIndirectCount);
+                vkCmdDrawIndexedIndirect(commandBuffer, m_scene.getIndirectBuffer(currentFrame),
+                    (batch.firstCommand + command) * sizeof(VkDrawIndexedIndirectCommand), drawCount, sizeof(VkDrawIndexedIndirectCommand));
+            }
         }
     }
 
@@ -307,18 +566,26 @@ namespace vulkan {
         ubo.proj = m_camera.matrices.perspective;
         ubo.proj[1][1] *= -1;
 
-        void* data;
-        vkMapMemory(m_context.getDevice(), m_uniform.getUniformMemory(currentImage), 0, sizeof(ubo), 0, &data);
-            memcpy(data, &ubo, sizeof(ubo));
-        vkUnmapMemory(m_context.getDevice(), m_uniform.getUniformMemory(currentImage));
+        m_uniform.beginFrame(currentImage);
+        m_uboOffset = m_uniform.push(ubo);
     }
 
-    void Renderer::createDescriptor(TextureType texType) {
-        m_descriptor = std::make_shared<Descriptor>(m_context.getDevice(), m_context.getDescriptorPool(), m_textures[texType]->getView(), m_uniform, m_sampler);
-    }
+    MaterialHandle Renderer::createMaterial(TextureType texType) {
+        if (m_materialDescriptors.size() >= MAX_MATERIALS) {
+            throw std::runtime_error("failed to create material, descriptor pool exhausted!");
+        }
+
+        MaterialHandle material = m_scene.addMaterial(m_textures[texType]);
+        m_materialDescriptors.push_back(std::make_shared<Descriptor>(m_context.getDevice(), m_context.getDescriptorPool(), m_textures[texType]->getView(), m_uniform, m_sampler));
+
+        // every material's set layout is defined identically and so compatible,
+        // the first one keys the variant so materials with the same state share a pipeline
+        PipelineDesc desc;
+        desc.renderPass = m_swapChain.getRenderPass();
+        desc.descriptorSetLayout = m_materialDescriptors.front()->getDescriptorLayout();
+        m_materialPipelines.push_back(m_pipelineRegistry.request(desc));
 
-    void Renderer::createPipleline() {
-        m_pipeline = std::make_shared<Pipeline>(m_context.getPhysicalDevice(), m_context.getDevice(), m_width, m_height, m_swapChain.getExtent(), m_descriptor->getDescriptorLayout(), m_swapChain.getRenderPass());
+        return material;
     }
 
 }
\ No newline at end of file
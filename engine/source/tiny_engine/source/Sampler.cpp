@@ -1,13 +1,14 @@
 #include "Sampler.h"
 
 #include <iostream>
+#include <algorithm>
 
 #include "VkUtil.h"
 
 namespace vulkan {
 
-	Sampler::Sampler(VkPhysicalDevice physicalDevice, VkDevice device) 
-        : m_physicalDevice(physicalDevice), m_device(device)
+	Sampler::Sampler(VkPhysicalDevice physicalDevice, VkDevice device, const VkPhysicalDeviceFeatures& enabledFeatures, const SamplerDesc& desc)
+        : m_physicalDevice(physicalDevice), m_device(device), m_desc(desc), m_anisotropySupported(enabledFeatures.samplerAnisotropy == VK_TRUE)
     {
 		createTextureSampler();
 	}
@@ -21,20 +22,29 @@ namespace vulkan {
         VkPhysicalDeviceProperties properties{};
         vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
 
+        m_anisotropy = m_anisotropySupported ? std::min(m_desc.maxAnisotropy, properties.limits.maxSamplerAnisotropy) : 1.0f;
+        m_anisotropy = std::max(m_anisotropy, 1.0f);
+
+        // larger biases than the device allows are invalid
+        float lodBiasLimit = properties.limits.maxSamplerLodBias;
+
         VkSamplerCreateInfo samplerInfo{};
         samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-        samplerInfo.magFilter = VK_FILTER_LINEAR;
-        samplerInfo.minFilter = VK_FILTER_LINEAR;
-        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        samplerInfo.anisotropyEnable = VK_FALSE;
-        samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
+        samplerInfo.magFilter = m_desc.filter;
+        samplerInfo.minFilter = m_desc.filter;
+        samplerInfo.addressModeU = m_desc.addressMode;
+        samplerInfo.addressModeV = m_desc.addressMode;
+        samplerInfo.addressModeW = m_desc.addressMode;
+        samplerInfo.anisotropyEnable = m_anisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+        samplerInfo.maxAnisotropy = m_anisotropy;
         samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
         samplerInfo.unnormalizedCoordinates = VK_FALSE;
         samplerInfo.compareEnable = VK_FALSE;
         samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.mipmapMode = m_desc.mipmapMode;
+        samplerInfo.mipLodBias = std::clamp(m_desc.mipLodBias, -lodBiasLimit, lodBiasLimit);
+        samplerInfo.minLod = m_desc.minLod;
+        samplerInfo.maxLod = m_desc.maxLod;
 
         if (vkCreateSampler(m_device, &samplerInfo, nullptr, &m_textureSampler) != VK_SUCCESS) {
             throw std::runtime_error("failed to create texture sampler!");
@@ -47,4 +57,14 @@ namespace vulkan {
         return m_textureSampler;
     }
 
+    const SamplerDesc& Sampler::getDesc() const
+    {
+        return m_desc;
+    }
+
+    float Sampler::getAnisotropy() const
+    {
+        return m_anisotropy;
+    }
+
 }
\ No newline at end of file
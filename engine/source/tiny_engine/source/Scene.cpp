@@ -0,0 +1,403 @@
+#include "Scene.h"
+
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+#include "VkUtil.h"
+#include "Buffer.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include "MeshletBuilder.h"
+#include "OcclusionBuffer.h"
+
+namespace vulkan {
+    Scene::Scene(MemoryAllocator& allocator, VkDevice device)
+        : m_allocator(allocator), m_device(device)
+    {
+    }
+
+    Scene::~Scene()
+    {
+    }
+
+    MeshHandle Scene::addMesh(std::shared_ptr<Mesh> mesh)
+    {
+        const std::vector<Meshlet>& meshlets = mesh->getMeshlets();
+        std::vector<std::unique_ptr<FrustumCuller>> lodBounds;
+        for (const MeshLod& lod : mesh->getLods()) {
+            auto meshletBounds = std::make_unique<FrustumCuller>();
+            meshletBounds->resize(lod.meshletCount);
+            for (uint32_t i = 0; i < lod.meshletCount; i++) {
+                const Meshlet& meshlet = meshlets[lod.firstMeshlet + i];
+                meshletBounds->setSphere(i, meshlet.center, meshlet.radius);
+            }
+            lodBounds.push_back(std::move(meshletBounds));
+        }
+
+        m_meshletBounds.push_back(std::move(lodBounds));
+        m_meshes.push_back(mesh);
+        return static_cast<MeshHandle>(m_meshes.size() - 1);
+    }
+
+    MaterialHandle Scene::addMaterial(std::shared_ptr<Texture> albedo)
+    {
+        Material material{};
+        material.albedo = albedo;
+
+        m_materials.push_back(material);
+        return static_cast<MaterialHandle>(m_materials.size() - 1);
+    }
+
+    NodeHandle Scene::addNode(MeshHandle mesh, MaterialHandle material, const glm::mat4& transform, NodeHandle parent)
+    {
+        if (parent != INVALID_HANDLE && parent >= m_nodes.size()) {
+            throw std::runtime_error("failed to add scene node, parent does not exist!");
+        }
+        if (mesh != INVALID_HANDLE && (mesh >= m_meshes.size() || material >= m_materials.size())) {
+            throw std::runtime_error("failed to add scene node, invalid mesh or material!");
+        }
+
+        SceneNode node{};
+        node.localTransform = transform;
+        node.parent = parent;
+        node.mesh = mesh;
+        node.material = material;
+
+        m_nodes.push_back(node);
+        m_batchesDirty = true;
+
+        return static_cast<NodeHandle>(m_nodes.size() - 1);
+    }
+
+    void Scene::setTransform(NodeHandle node, const glm::mat4& transform)
+    {
+        m_nodes[node].localTransform = transform;
+    }
+
+    void Scene::buildBatches()
+    {
+        m_drawOrder.clear();
+        m_batches.clear();
+
+        for (uint32_t i = 0; i < m_nodes.size(); i++) {
+            if (m_nodes[i].mesh != INVALID_HANDLE) {
+                m_drawOrder.push_back(i);
+            }
+        }
+
+        // material first so consecutive batches share a descriptor set
+        std::sort(m_drawOrder.begin(), m_drawOrder.end(), [this](uint32_t a, uint32_t b) {
+            const SceneNode& lhs = m_nodes[a];
+            const SceneNode& rhs = m_nodes[b];
+            if (lhs.material != rhs.material) {
+                return lhs.material < rhs.material;
+            }
+            return lhs.mesh < rhs.mesh;
+        });
+
+        for (uint32_t i = 0; i < m_drawOrder.size(); i++) {
+            const SceneNode& node = m_nodes[m_drawOrder[i]];
+
+            if (m_batches.empty() || m_batches.back().mesh != node.mesh || m_batches.back().material != node.material) {
+                DrawBatch batch{};
+                batch.mesh = node.mesh;
+                batch.material = node.material;
+                batch.firstNode = i;
+                batch.nodeCount = 0;
+                m_batches.push_back(batch);
+            }
+            m_batches.back().nodeCount++;
+        }
+
+        m_maxCommandCount = 0;
+        m_maxBatchCommandCount = 0;
+        for (const DrawBatch& batch : m_batches) {
+            const std::vector<MeshLod>& lods = m_meshes[batch.mesh]->getLods();
+            uint32_t meshletCount = 0;
+            for (const MeshLod& lod : lods) {
+                meshletCount = std::max(meshletCount, lod.meshletCount);
+            }
+            m_maxCommandCount += batch.nodeCount * std::max<uint32_t>(meshletCount, 1);
+            m_maxBatchCommandCount += std::min(batch.nodeCount, static_cast<uint32_t>(lods.size()));
+        }
+
+        m_nodeBounds.resize(static_cast<uint32_t>(m_drawOrder.size()));
+        m_visibleNodes.resize(m_drawOrder.size());
+        m_visibleLods.resize(m_drawOrder.size());
+        m_instanceNodes.resize(m_drawOrder.size());
+        m_instanceLods.resize(m_drawOrder.size());
+        m_lodInstanceCounts.resize(m_batches.size() * MAX_MESH_LODS);
+
+        m_batchesDirty = false;
+    }
+
+    uint32_t Scene::selectLod(const Mesh& mesh, const glm::mat4& transform, const SceneView& view) const
+    {
+        const std::vector<MeshLod>& lods = mesh.getLods();
+        if (lods.size() == 1 || view.lodScale <= 0.0f) {
+            return 0;
+        }
+
+        // errors grow with the largest axis scale, distance is measured to the near side of the bounding sphere
+        const MeshBounds& bounds = mesh.getBounds();
+        float scale = std::sqrt(std::max(std::max(glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+            glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1]))), glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2]))));
+        glm::vec3 center = glm::vec3(transform * glm::vec4(bounds.center, 1.0f));
+        float distance = glm::length(center - view.eye) - bounds.radius * scale;
+        if (distance <= 0.0f || scale <= 0.0f) {
+            return 0;
+        }
+
+        // projected error in pixels is error * scale * lodScale / distance
+        float maxError = view.lodErrorThreshold * distance / (scale * view.lodScale);
+        uint32_t lod = 0;
+        while (lod + 1 < lods.size() && lods[lod + 1].error <= maxError) {
+            lod++;
+        }
+        return lod;
+    }
+
+    void Scene::reserveFrameBuffers(uint32_t frameIndex)
+    {
+        VkDeviceSize instanceSize = std::max<size_t>(m_drawOrder.size(), 1) * sizeof(InstanceData);
+        VkDeviceSize indirectSize = std::max<size_t>(m_clusterCulling ? m_maxCommandCount : m_maxBatchCommandCount, 1) * sizeof(VkDrawIndexedIndirectCommand);
+
+        // grow by doubling, the old buffer is no longer read since the frame has completed
+        if (!m_instanceBuffers[frameIndex] || m_instanceBuffers[frameIndex]->getSize() < instanceSize) {
+            VkBufferCreateInfo createInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+            createInfo.size = m_instanceBuffers[frameIndex] ? std::max<VkDeviceSize>(instanceSize, m_instanceBuffers[frameIndex]->getSize() * 2) : instanceSize;
+            createInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+            createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            m_instanceBuffers[frameIndex].reset();
+            m_instanceBuffers[frameIndex] = std::make_unique<Buffer>(m_allocator, m_device, createInfo,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        }
+
+        if (!m_indirectBuffers[frameIndex] || m_indirectBuffers[frameIndex]->getSize() < indirectSize) {
+            VkBufferCreateInfo createInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+            createInfo.size = m_indirectBuffers[frameIndex] ? std::max<VkDeviceSize>(indirectSize, m_indirectBuffers[frameIndex]->getSize() * 2) : indirectSize;
+            createInfo.usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+            createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            m_indirectBuffers[frameIndex].reset();
+            m_indirectBuffers[frameIndex] = std::make_unique<Buffer>(m_allocator, m_device, createInfo,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        }
+    }
+
+    void Scene::update(uint32_t frameIndex, const SceneView& view)
+    {
+        if (m_batchesDirty) {
+            buildBatches();
+        }
+
+        reserveFrameBuffers(frameIndex);
+
+        // parents precede children, so one forward pass resolves the hierarchy
+        for (SceneNode& node : m_nodes) {
+            node.worldTransform = node.parent == INVALID_HANDLE
+                ? node.localTransform
+                : m_nodes[node.parent].worldTransform * node.localTransform;
+        }
+
+        auto cullStart = std::chrono::high_resolution_clock::now();
+        Frustum frustum = Frustum::fromMatrix(view.viewProjection);
+        m_cullStats = SceneCullStats{};
+
+        // node culling, the visible list is ascending so every batch's survivors stay together
+        uint32_t visibleCount = 0;
+        {
+            for (uint32_t i = 0; i < m_drawOrder.size(); i++) {
+                const SceneNode& node = m_nodes[m_drawOrder[i]];
+                const MeshBounds& bounds = m_meshes[node.mesh]->getBounds();
+                m_nodeBounds.setBox(i, bounds.min, bounds.max, node.worldTransform);
+            }
+            visibleCount = m_nodeBounds.cullBoxes(frustum, m_visibleNodes.data());
+
+            // compacting in place keeps the list ascending
+            if (view.occlusion && view.occlusion->isValid()) {
+                uint32_t unoccludedCount = 0;
+                for (uint32_t i = 0; i < visibleCount; i++) {
+                    const SceneNode& node = m_nodes[m_drawOrder[m_visibleNodes[i]]];
+                    const MeshBounds& bounds = m_meshes[node.mesh]->getBounds();
+                    if (!view.occlusion->isOccluded(bounds.min, bounds.max, view.occlusion->getViewProjection() * node.worldTransform)) {
+                        m_visibleNodes[unoccludedCount++] = m_visibleNodes[i];
+                    }
+                }
+                m_cullStats.occludedObjectCount = visibleCount - unoccludedCount;
+                visibleCount = unoccludedCount;
+            }
+
+            m_cullStats.objectCount = static_cast<uint32_t>(m_drawOrder.size());
+            m_cullStats.visibleObjectCount = visibleCount;
+        }
+
+        for (uint32_t i = 0; i < visibleCount; i++) {
+            const SceneNode& node = m_nodes[m_drawOrder[m_visibleNodes[i]]];
+            m_visibleLods[i] = static_cast<uint8_t>(selectLod(*m_meshes[node.mesh], node.worldTransform, view));
+        }
+
+        // instance data, every batch's instances are sorted by lod so each lod in use is one instance range
+        {
+            InstanceData* instances = reinterpret_cast<InstanceData*>(m_instanceBuffers[frameIndex]->map());
+            uint32_t visible = 0;
+            for (uint32_t b = 0; b < m_batches.size(); b++) {
+                DrawBatch& batch = m_batches[b];
+                uint32_t* lodCounts = &m_lodInstanceCounts[b * MAX_MESH_LODS];
+                std::fill(lodCounts, lodCounts + MAX_MESH_LODS, 0);
+
+                batch.firstInstance = visible;
+                while (visible < visibleCount && m_visibleNodes[visible] < batch.firstNode + batch.nodeCount) {
+                    lodCounts[m_visibleLods[visible]]++;
+                    visible++;
+                }
+                batch.instanceCount = visible - batch.firstInstance;
+
+                uint32_t lodSlots[MAX_MESH_LODS];
+                for (uint32_t lod = 0, slot = batch.firstInstance; lod < MAX_MESH_LODS; lod++) {
+                    lodSlots[lod] = slot;
+                    slot += lodCounts[lod];
+                }
+                for (uint32_t i = batch.firstInstance; i < visible; i++) {
+                    uint32_t slot = lodSlots[m_visibleLods[i]]++;
+                    m_instanceNodes[slot] = m_visibleNodes[i];
+                    m_instanceLods[slot] = m_visibleLods[i];
+                    instances[slot].model = m_nodes[m_drawOrder[m_visibleNodes[i]]].worldTransform;
+                }
+            }
+        }
+
+        // draw commands
+        {
+            VkDrawIndexedIndirectCommand* commands = reinterpret_cast<VkDrawIndexedIndirectCommand*>(m_indirectBuffers[frameIndex]->map());
+            uint32_t commandCount = 0;
+
+            for (uint32_t b = 0; b < m_batches.size(); b++) {
+                DrawBatch& batch = m_batches[b];
+                const Mesh& mesh = *m_meshes[batch.mesh];
+                const std::vector<Meshlet>& meshlets = mesh.getMeshlets();
+                const std::vector<MeshLod>& lods = mesh.getLods();
+                batch.firstCommand = commandCount;
+                batch.commandCount = 0;
+                batch.clustered = m_clusterCulling && !meshlets.empty();
+
+                if (batch.instanceCount == 0) {
+                    continue;
+                }
+
+                if (!batch.clustered) {
+                    const uint32_t* lodCounts = &m_lodInstanceCounts[b * MAX_MESH_LODS];
+                    uint32_t firstInstance = 0;
+                    for (uint32_t lod = 0; lod < lods.size(); lod++) {
+                        if (lodCounts[lod] == 0) {
+                            continue;
+                        }
+                        // the instance stream is bound at each lod's offset, a non-zero firstInstance needs drawIndirectFirstInstance
+                        batch.lodFirstInstance[commandCount - batch.firstCommand] = firstInstance;
+                        firstInstance += lodCounts[lod];
+
+                        VkDrawIndexedIndirectCommand& command = commands[commandCount++];
+                        command.indexCount = lods[lod].indexCount;
+                        command.instanceCount = lodCounts[lod];
+                        command.firstIndex = lods[lod].firstIndex;
+                        command.vertexOffset = 0;
+                        command.firstInstance = 0;
+                        m_cullStats.triangleCount += command.indexCount / 3 * command.instanceCount;
+                    }
+                    batch.commandCount = commandCount - batch.firstCommand;
+                    continue;
+                }
+
+                m_visibleMeshlets.resize(std::max<size_t>(m_visibleMeshlets.size(), meshlets.size()));
+
+                for (uint32_t instance = 0; instance < batch.instanceCount; instance++) {
+                    const uint32_t slot = batch.firstInstance + instance;
+                    const glm::mat4& model = m_nodes[m_drawOrder[m_instanceNodes[slot]]].worldTransform;
+                    const MeshLod& lod = lods[m_instanceLods[slot]];
+                    const FrustumCuller& meshletBounds = *m_meshletBounds[batch.mesh][m_instanceLods[slot]];
+                    // both tests run in object space, the frustum planes and the eye are moved there once per instance
+                    Frustum objectFrustum = Frustum::fromMatrix(view.viewProjection * model);
+                    glm::vec3 eye = glm::vec3(glm::inverse(model) * glm::vec4(view.eye, 1.0f));
+                    const bool occlusion = view.occlusion && view.occlusion->isValid();
+                    glm::mat4 occlusionClip = occlusion ? view.occlusion->getViewProjection() * model : glm::mat4(1.0f);
+
+                    uint32_t meshletCount = meshletBounds.cullSpheres(objectFrustum, m_visibleMeshlets.data());
+                    for (uint32_t i = 0; i < meshletCount; i++) {
+                        const Meshlet& meshlet = meshlets[lod.firstMeshlet + m_visibleMeshlets[i]];
+                        if (isMeshletBackfacing(meshlet, eye)) {
+                            continue;
+                        }
+
+                        if (occlusion && view.occlusion->isOccluded(meshlet.center - glm::vec3(meshlet.radius), meshlet.center + glm::vec3(meshlet.radius), occlusionClip)) {
+                            m_cullStats.occludedClusterCount++;
+                            continue;
+                        }
+
+                        VkDrawIndexedIndirectCommand& command = commands[commandCount++];
+                        command.indexCount = meshlet.indexCount;
+                        command.instanceCount = 1;
+                        command.firstIndex = meshlet.firstIndex;
+                        command.vertexOffset = 0;
+                        command.firstInstance = instance;
+                        m_cullStats.triangleCount += meshlet.indexCount / 3;
+                    }
+                    m_cullStats.clusterCount += lod.meshletCount;
+                }
+
+                batch.commandCount = commandCount - batch.firstCommand;
+                m_cullStats.visibleClusterCount += batch.commandCount;
+            }
+        }
+
+        m_cullStats.cullMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cullStart).count();
+    }
+
+    void Scene::setClusterCulling(bool enabled)
+    {
+        m_clusterCulling = enabled;
+    }
+
+    const SceneCullStats& Scene::getCullStats() const
+    {
+        return m_cullStats;
+    }
+
+    const std::vector<DrawBatch>& Scene::getBatches() const
+    {
+        return m_batches;
+    }
+
+    const Mesh& Scene::getMesh(MeshHandle mesh) const
+    {
+        return *m_meshes[mesh];
+    }
+
+    const Material& Scene::getMaterial(MaterialHandle material) const
+    {
+        return m_materials[material];
+    }
+
+    uint32_t Scene::getMaterialCount() const
+    {
+        return static_cast<uint32_t>(m_materials.size());
+    }
+
+    uint32_t Scene::getNodeCount() const
+    {
+        return static_cast<uint32_t>(m_nodes.size());
+    }
+
+    VkBuffer Scene::getInstanceBuffer(uint32_t frameIndex) const
+    {
+        return m_instanceBuffers[frameIndex]->getBuffer();
+    }
+
+    VkBuffer Scene::getIndirectBuffer(uint32_t frameIndex) const
+    {
+        return m_indirectBuffers[frameIndex]->getBuffer();
+    }
+
+}
@@ -4,13 +4,15 @@
 #include <iostream>
 
 #include "VkUtil.h"
+#include "DeletionQueue.h"
 
 namespace vulkan {
 
-	SwapChain::SwapChain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, uint32_t width, uint32_t height)
-		:m_physicalDevice(physicalDevice), m_device(device), m_surface(surface)
+	SwapChain::SwapChain(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator, DeletionQueue& deletionQueue,
+		VkSurfaceKHR surface, uint32_t width, uint32_t height)
+		:m_physicalDevice(physicalDevice), m_device(device), m_allocator(allocator), m_deletionQueue(deletionQueue), m_surface(surface)
 	{
-        createSwapChain(width, height);
+        createSwapChain(width, height, VK_NULL_HANDLE);
         createRenderPass();
         createDepthBuffer();
         createFramebuffers();
@@ -21,7 +23,7 @@ namespace vulkan {
         destroy();
     }
 
-    void SwapChain::createSwapChain(uint32_t width, uint32_t height) {
+    void SwapChain::createSwapChain(uint32_t width, uint32_t height, VkSwapchainKHR oldSwapChain) {
         // create SwapChain
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(m_physicalDevice, m_surface);
 
@@ -62,26 +64,31 @@ namespace vulkan {
         createInfo.presentMode = presentMode;
         createInfo.clipped = VK_TRUE;
 
-        createInfo.oldSwapchain = VK_NULL_HANDLE;
+        // lets the driver hand resources over from the old chain, images already acquired from it can still be presented
+        createInfo.oldSwapchain = oldSwapChain;
 
-        auto res = vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &m_swapChain);
+        auto res = vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &m_current.swapChain);
         if (res != VK_SUCCESS) {
             throw std::runtime_error("failed to create swap chain!");
         }
 
-        vkGetSwapchainImagesKHR(m_device, m_swapChain, &imageCount, nullptr);
-        m_swapChainImages.resize(imageCount);
-        vkGetSwapchainImagesKHR(m_device, m_swapChain, &imageCount, m_swapChainImages.data());
+        vkGetSwapchainImagesKHR(m_device, m_current.swapChain, &imageCount, nullptr);
+        m_current.images.resize(imageCount);
+        vkGetSwapchainImagesKHR(m_device, m_current.swapChain, &imageCount, m_current.images.data());
 
+        // the surface's formats do not change, the render pass built for the first chain is kept
+        if (oldSwapChain != VK_NULL_HANDLE && surfaceFormat.format != m_swapChainImageFormat) {
+            throw std::runtime_error("failed to recreate swap chain, surface format changed!");
+        }
         m_swapChainImageFormat = surfaceFormat.format;
         m_swapChainExtent = extent;
 
         // create image view
-        m_swapChainImageViews.resize(m_swapChainImages.size());
-        for (size_t i = 0; i < m_swapChainImages.size(); i++) {
+        m_current.imageViews.resize(m_current.images.size());
+        for (size_t i = 0; i < m_current.images.size(); i++) {
             VkImageViewCreateInfo createInfo{};
             createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-            createInfo.image = m_swapChainImages[i];
+            createInfo.image = m_current.images[i];
             createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
             createInfo.format = m_swapChainImageFormat;
 
@@ -96,7 +103,7 @@ namespace vulkan {
             createInfo.subresourceRange.baseArrayLayer = 0;
             createInfo.subresourceRange.layerCount = 1;
 
-            if (vkCreateImageView(m_device, &createInfo, nullptr, &m_swapChainImageViews[i]) != VK_SUCCESS) {
+            if (vkCreateImageView(m_device, &createInfo, nullptr, &m_current.imageViews[i]) != VK_SUCCESS) {
                 throw std::runtime_error("failed to create image views!");
             }
         }
@@ -128,7 +135,8 @@ namespace vulkan {
         depthAttachment.format = findDepthFormat();
         depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
         depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        // kept for the depth pyramid built after the pass
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -166,6 +174,7 @@ namespace vulkan {
 
     void SwapChain::createDepthBuffer() {
         VkFormat depthFormat = findDepthFormat();
+        m_depthFormat = depthFormat;
 
         VkImageCreateInfo imageInfo{};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -178,20 +187,20 @@ namespace vulkan {
         imageInfo.format = depthFormat;
         imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        createImage(m_physicalDevice, m_device, imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_depthImage, m_depthImageMemory);
+        createImage(m_allocator, m_device, imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_current.depthImage, m_current.depthImageMemory);
 
-        m_depthImageView = createImageView(m_device, m_depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+        m_current.depthImageView = createImageView(m_device, m_current.depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
     }
 
     void SwapChain::createFramebuffers() {
-        m_swapChainFramebuffers.resize(m_swapChainImageViews.size());
-        for (size_t i = 0; i < m_swapChainImageViews.size(); i++) {
+        m_current.framebuffers.resize(m_current.imageViews.size());
+        for (size_t i = 0; i < m_current.imageViews.size(); i++) {
 
-            std::array<VkImageView, 2> attachments = { m_swapChainImageViews[i], m_depthImageView };
+            std::array<VkImageView, 2> attachments = { m_current.imageViews[i], m_current.depthImageView };
 
             VkFramebufferCreateInfo framebufferInfo{};
             framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -202,7 +211,7 @@ namespace vulkan {
             framebufferInfo.height = m_swapChainExtent.height;
             framebufferInfo.layers = 1;
 
-            if (vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &m_swapChainFramebuffers[i]) != VK_SUCCESS) {
+            if (vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &m_current.framebuffers[i]) != VK_SUCCESS) {
                 throw std::runtime_error("failed to create framebuffer!");
             }
         }
@@ -210,31 +219,34 @@ namespace vulkan {
 
     void SwapChain::recreate(uint32_t width, uint32_t height)
     {
-        vkDeviceWaitIdle(m_device);
-        destroy();
+        Generation old = m_current;
+        m_current = Generation{};
+
+        createSwapChain(width, height, old.swapChain);
+        retireGeneration(old);
 
-        createSwapChain(width, height);
-        createRenderPass();
         createDepthBuffer();
         createFramebuffers();
     }
 
-    void SwapChain::destroy() {
-        vkDestroyImageView(m_device, m_depthImageView, nullptr);
-        vkDestroyImage(m_device, m_depthImage, nullptr);
-        vkFreeMemory(m_device, m_depthImageMemory, nullptr);
-
-        for (size_t i = 0; i < m_swapChainFramebuffers.size(); i++) {
-            vkDestroyFramebuffer(m_device, m_swapChainFramebuffers[i], nullptr);
+    void SwapChain::retireGeneration(Generation& generation) {
+        for (size_t i = 0; i < generation.framebuffers.size(); i++) {
+            m_deletionQueue.retire(generation.framebuffers[i]);
         }
 
-        vkDestroyRenderPass(m_device, m_renderPass, nullptr);
+        m_deletionQueue.retire(generation.depthImageView);
+        m_deletionQueue.retire(generation.depthImage, generation.depthImageMemory);
 
-        for (size_t i = 0; i < m_swapChainImageViews.size(); i++) {
-            vkDestroyImageView(m_device, m_swapChainImageViews[i], nullptr);
+        for (size_t i = 0; i < generation.imageViews.size(); i++) {
+            m_deletionQueue.retire(generation.imageViews[i]);
         }
 
-        vkDestroySwapchainKHR(m_device, m_swapChain, nullptr);
+        m_deletionQueue.retire(generation.swapChain);
+    }
+
+    void SwapChain::destroy() {
+        retireGeneration(m_current);
+        m_deletionQueue.retire(m_renderPass);
     }
 
     VkFormat SwapChain::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
@@ -257,7 +269,7 @@ namespace vulkan {
         return findSupportedFormat(
             { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
             VK_IMAGE_TILING_OPTIMAL,
-            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
         );
     }
 
@@ -273,22 +285,22 @@ namespace vulkan {
 
     SwapChain::operator VkSwapchainKHR() const
     {
-        return m_swapChain;
+        return m_current.swapChain;
     }
 
     VkImage SwapChain::getImage(size_t index) const
     {
-        return m_swapChainImages[index];
+        return m_current.images[index];
     }
 
     VkImageView SwapChain::getImageView(size_t index) const
     {
-        return m_swapChainImageViews[index];
+        return m_current.imageViews[index];
     }
 
     size_t SwapChain::getImageCount() const
     {
-        return m_swapChainImageViews.size();
+        return m_current.imageViews.size();
     }
 
     VkRenderPass SwapChain::getRenderPass() const
@@ -298,12 +310,27 @@ namespace vulkan {
 
     VkFramebuffer SwapChain::getFramebuffer(uint32_t index) const 
     {
-        return m_swapChainFramebuffers[index];
+        return m_current.framebuffers[index];
     }
 
     VkSwapchainKHR SwapChain::getSwapchain() const
     {
-        return m_swapChain;
+        return m_current.swapChain;
+    }
+
+    VkImage SwapChain::getDepthImage() const
+    {
+        return m_current.depthImage;
+    }
+
+    VkImageView SwapChain::getDepthImageView() const
+    {
+        return m_current.depthImageView;
+    }
+
+    VkFormat SwapChain::getDepthFormat() const
+    {
+        return m_depthFormat;
     }
 
 }
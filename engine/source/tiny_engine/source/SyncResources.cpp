@@ -1,54 +0,0 @@
-#include "SyncResources.h"
-
-#include <iostream>
-
-#include "RenderCfg.h"
-
-namespace vulkan {
-	SyncResources::SyncResources(VkDevice device)
-        : m_device(device)
-	{
-        m_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        m_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-
-        VkSemaphoreCreateInfo semaphoreInfo{};
-        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-        VkFenceCreateInfo fenceInfo{};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) != VK_SUCCESS ||
-                vkCreateFence(m_device, &fenceInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create semaphores!");
-            }
-        }
-	}
-
-    SyncResources::~SyncResources()
-    {
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            vkDestroySemaphore(m_device, m_renderFinishedSemaphores[i], nullptr);
-            vkDestroySemaphore(m_device, m_imageAvailableSemaphores[i], nullptr);
-            vkDestroyFence(m_device, m_inFlightFences[i], nullptr);
-        }
-    }
-
-    const VkSemaphore& SyncResources::getImageAvailSemaphore(uint32_t index) const
-    {
-        return m_imageAvailableSemaphores[index];
-    }
-
-    const VkSemaphore& SyncResources::getRenderFinishedSemaphore(uint32_t index) const
-    {
-        return m_renderFinishedSemaphores[index];
-    }
-
-    const VkFence& SyncResources::getInFlightFence(uint32_t index) const
-    {
-        return m_inFlightFences[index];
-    }
-}
\ No newline at end of file
@@ -6,13 +6,15 @@
 #include <stb/stb_image.h>
 
 #include "VkUtil.h"
+#include "DeletionQueue.h"
+#include "MipGenerator.h"
+#include "TextureFile.h"
 
 namespace vulkan {
 
-	std::shared_ptr<Texture> Texture::load(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool cmdPool, const char* path, bool cube)
+	std::shared_ptr<Texture> Texture::load(MemoryAllocator& allocator, VkDevice device, UploadManager& uploader, DeletionQueue& deletionQueue,
+		const char* path, bool cube, TextureMips mips)
 	{
-		std::shared_ptr<Texture> texture = std::make_shared<Texture>();
-
 		// read image file
 		int texWidth, texHeight, texChannels;
 		stbi_uc* pixels = stbi_load(path, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
@@ -22,33 +24,57 @@ namespace vulkan {
 			throw std::runtime_error("failed to load texture image!");
 		}
 
-		// fill out info values
-		texture->m_device = device;
-		texture->m_imageType = VK_IMAGE_TYPE_2D;
-		texture->m_format = VK_FORMAT_R8G8B8A8_SRGB;
-		texture->m_width = texWidth;
-		texture->m_height = texHeight;
-		texture->m_depth = 1;
-		texture->m_mipLevels = 1;
-		texture->m_arrayLayers = 1;
+		uint32_t mipLevels = mips == TextureMips::None ? 1 : MipGenerator::getLevelCount(texWidth, texHeight);
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		if (mips == TextureMips::Gpu) {
+			usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		}
+
+		std::shared_ptr<Texture> texture = create(allocator, device, deletionQueue, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels, usage, cube);
 
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
+		// pixels are copied into the staging ring synchronously, so they can be freed right away
+		if (mips == TextureMips::Cpu) {
+			MipChain chain = MipGenerator::generate(pixels, texWidth, texHeight, MipFilter::Kaiser, true);
+			texture->m_uploadTicket = uploader.uploadImage(texture->m_image, texture->m_format, chain.data.data(), chain.data.size(),
+				texture->m_width, texture->m_height, texture->m_mipLevels);
+		}
+		else {
+			texture->m_uploadTicket = uploader.uploadImage(texture->m_image, texture->m_format, pixels, imageSize,
+				texture->m_width, texture->m_height, texture->m_mipLevels, mips == TextureMips::Gpu);
+		}
 
-		VkBufferCreateInfo bufferInfo{};
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = imageSize;
-		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		stbi_image_free(pixels);
 
-		createBuffer(physicalDevice, device, bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+		return texture;
+	}
 
-		void* data;
-		vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-		memcpy(data, pixels, static_cast<size_t>(imageSize));
-		vkUnmapMemory(device, stagingBufferMemory);
+	std::shared_ptr<Texture> Texture::load(MemoryAllocator& allocator, VkDevice device, UploadManager& uploader, DeletionQueue& deletionQueue,
+		const TextureFile& file)
+	{
+		std::shared_ptr<Texture> texture = create(allocator, device, deletionQueue, file.getFormat(), file.getWidth(), file.getHeight(),
+			file.getLevelCount(), VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, false);
 
-		stbi_image_free(pixels);
+		// the levels are contiguous in the mapped file and go to staging with a single copy
+		texture->m_uploadTicket = uploader.uploadImage(texture->m_image, texture->m_format, file.getData(), file.getDataSize(),
+			texture->m_width, texture->m_height, texture->m_mipLevels);
+
+		return texture;
+	}
+
+	std::shared_ptr<Texture> Texture::create(MemoryAllocator& allocator, VkDevice device, DeletionQueue& deletionQueue, VkFormat format,
+		uint32_t width, uint32_t height, uint32_t mipLevels, VkImageUsageFlags usage, bool cube)
+	{
+		std::shared_ptr<Texture> texture = std::make_shared<Texture>();
+		texture->m_deletionQueue = &deletionQueue;
+
+		// fill out info values
+		texture->m_imageType = VK_IMAGE_TYPE_2D;
+		texture->m_format = format;
+		texture->m_width = width;
+		texture->m_height = height;
+		texture->m_depth = 1;
+		texture->m_mipLevels = mipLevels;
+		texture->m_arrayLayers = 1;
 
 		VkImageCreateInfo imageCreateInfo{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
 		imageCreateInfo.flags = cube ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
@@ -61,12 +87,12 @@ namespace vulkan {
 		imageCreateInfo.arrayLayers = texture->m_arrayLayers;
 		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageCreateInfo.usage = usage;
 		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
 		createImage(
-			physicalDevice, device,
+			allocator, device,
 			imageCreateInfo,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			texture->m_image, texture->m_deviceMemory
@@ -79,7 +105,7 @@ namespace vulkan {
 		viewInfo.format = texture->m_format;
 		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		viewInfo.subresourceRange.baseMipLevel = 0;
-		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.levelCount = texture->m_mipLevels;
 		viewInfo.subresourceRange.baseArrayLayer = 0;
 		viewInfo.subresourceRange.layerCount = 1;
 
@@ -87,21 +113,13 @@ namespace vulkan {
 			throw std::runtime_error("failed to create texture image view!");
 		}
 
-		transitionImageLayout(device, queue, cmdPool, texture->m_image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-		copyBufferToImage(device, queue, cmdPool, stagingBuffer, texture->m_image, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-		transitionImageLayout(device, queue, cmdPool, texture->m_image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
-
 		return texture;
 	}
 
 	Texture::~Texture()
 	{
-		vkDestroyImageView(m_device, m_view, nullptr);
-		vkDestroyImage(m_device, m_image, nullptr);
-		vkFreeMemory(m_device, m_deviceMemory, nullptr);
+		m_deletionQueue->retire(m_view);
+		m_deletionQueue->retire(m_image, m_deviceMemory);
 	}
 
 	VkImageView Texture::getView() const
@@ -149,4 +167,9 @@ namespace vulkan {
 		return m_arrayLayers;
 	}
 
+	UploadTicket Texture::getUploadTicket() const
+	{
+		return m_uploadTicket;
+	}
+
 }
\ No newline at end of file
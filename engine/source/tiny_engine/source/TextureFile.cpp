@@ -0,0 +1,154 @@
+#include "TextureFile.h"
+
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+
+namespace vulkan {
+    VkFormat getBlockFormat(BlockFormat format, bool srgb)
+    {
+        switch (format) {
+        case BlockFormat::BC1:
+            return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case BlockFormat::BC3:
+            return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+        case BlockFormat::BC5:
+            return VK_FORMAT_BC5_UNORM_BLOCK;
+        case BlockFormat::BC7:
+            return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+        }
+        throw std::invalid_argument("unsupported block format!");
+    }
+
+    bool isBlockCompressed(VkFormat format)
+    {
+        return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+    }
+
+    TextureFile::TextureFile(const char* path)
+        : m_file(std::make_unique<MappedFile>(path)), m_header(nullptr)
+    {
+        if (m_file->getSize() < sizeof(TextureFileHeader)) {
+            throw std::runtime_error(std::string("failed to load ") + path + ", file is truncated!");
+        }
+
+        m_header = reinterpret_cast<const TextureFileHeader*>(m_file->getData());
+        if (m_header->magic != TEXTURE_FILE_MAGIC || m_header->version != TEXTURE_FILE_VERSION) {
+            throw std::runtime_error(std::string("failed to load ") + path + ", not a texture file of this version!");
+        }
+        if (m_header->width == 0 || m_header->height == 0 || m_header->levelCount == 0 || m_header->levelCount > MAX_TEXTURE_LEVELS ||
+            (std::max(m_header->width, m_header->height) >> (m_header->levelCount - 1)) == 0) {
+            throw std::runtime_error(std::string("failed to load ") + path + ", invalid size or level count!");
+        }
+
+        // the level sizes themselves are checked against the format when they are uploaded
+        uint64_t end = m_header->levels[0].offset;
+        for (uint32_t level = 0; level < m_header->levelCount; level++) {
+            const TextureFileLevel& entry = m_header->levels[level];
+            if (entry.offset != end || entry.offset > m_file->getSize() || entry.size > m_file->getSize() - entry.offset) {
+                throw std::runtime_error(std::string("failed to load ") + path + ", level out of range!");
+            }
+            end = entry.offset + entry.size;
+        }
+    }
+
+    void TextureFile::write(const char* path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels,
+        uint64_t sourceStamp)
+    {
+        if (levels.empty() || levels.size() > MAX_TEXTURE_LEVELS) {
+            throw std::invalid_argument("failed to write texture, unsupported level count!");
+        }
+
+        TextureFileHeader header{};
+        header.magic = TEXTURE_FILE_MAGIC;
+        header.version = TEXTURE_FILE_VERSION;
+        header.sourceStamp = sourceStamp;
+        header.format = format;
+        header.width = width;
+        header.height = height;
+        header.levelCount = static_cast<uint32_t>(levels.size());
+
+        uint64_t offset = (sizeof(TextureFileHeader) + TEXTURE_FILE_ALIGNMENT - 1) & ~uint64_t(TEXTURE_FILE_ALIGNMENT - 1);
+        for (uint32_t level = 0; level < header.levelCount; level++) {
+            header.levels[level].offset = offset;
+            header.levels[level].size = levels[level].size();
+            offset += levels[level].size();
+        }
+
+        writeFileAtomic(path, [&](std::ostream& file) {
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+            const char padding[TEXTURE_FILE_ALIGNMENT] = {};
+            file.write(padding, header.levels[0].offset - sizeof(header));
+            for (const std::vector<uint8_t>& level : levels) {
+                file.write(reinterpret_cast<const char*>(level.data()), level.size());
+            }
+        });
+    }
+
+    bool TextureFile::isUpToDate(const char* path, const char* sourcePath)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        TextureFileHeader header{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return false;
+        }
+        if (header.magic != TEXTURE_FILE_MAGIC || header.version != TEXTURE_FILE_VERSION) {
+            return false;
+        }
+
+        // a shipped cache without its source is always current
+        if (!std::filesystem::exists(sourcePath)) {
+            return true;
+        }
+        return header.sourceStamp == getFileStamp(sourcePath);
+    }
+
+    const TextureFileHeader& TextureFile::getHeader() const
+    {
+        return *m_header;
+    }
+
+    VkFormat TextureFile::getFormat() const
+    {
+        return static_cast<VkFormat>(m_header->format);
+    }
+
+    uint32_t TextureFile::getWidth() const
+    {
+        return m_header->width;
+    }
+
+    uint32_t TextureFile::getHeight() const
+    {
+        return m_header->height;
+    }
+
+    uint32_t TextureFile::getLevelCount() const
+    {
+        return m_header->levelCount;
+    }
+
+    const uint8_t* TextureFile::getLevelData(uint32_t level) const
+    {
+        return m_file->getData() + m_header->levels[level].offset;
+    }
+
+    const uint8_t* TextureFile::getData() const
+    {
+        return getLevelData(0);
+    }
+
+    uint64_t TextureFile::getDataSize() const
+    {
+        const TextureFileLevel& last = m_header->levels[m_header->levelCount - 1];
+        return last.offset + last.size - m_header->levels[0].offset;
+    }
+
+}
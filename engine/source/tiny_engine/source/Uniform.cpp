@@ -1,49 +1,74 @@
 #include "Uniform.h"
 
+#include <iostream>
+
 #include "RenderCfg.h"
 #include "VkUtil.h"
 
 namespace vulkan {
-	Uniform::Uniform(VkPhysicalDevice physicalDevice, VkDevice device)
-        : m_physicalDevice(physicalDevice), m_device(device)
+	Uniform::Uniform(MemoryAllocator& allocator, VkDevice device, VkDeviceSize frameCapacity)
+        : m_allocator(allocator), m_device(device), m_frameCapacity(frameCapacity)
     {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(m_allocator.getPhysicalDevice(), &properties);
+        m_alignment = properties.limits.minUniformBufferOffsetAlignment;
+
+        // every frame region starts on an aligned offset
+        m_frameCapacity = (m_frameCapacity + m_alignment - 1) / m_alignment * m_alignment;
+
         createUniformBuffers();
 	}
 
     Uniform::~Uniform()
     {
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            vkDestroyBuffer(m_device, m_uniformBuffers[i], nullptr);
-            vkFreeMemory(m_device, m_uniformBuffersMemory[i], nullptr);
-        }
+        vkDestroyBuffer(m_device, m_uniformBuffer, nullptr);
+        m_allocator.free(m_uniformBufferMemory);
     }
 
 	void Uniform::createUniformBuffers()
 	{
-        VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-
-        m_uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-        m_uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-
         VkBufferCreateInfo createInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-        createInfo.size = bufferSize;
+        createInfo.size = m_frameCapacity * MAX_FRAMES_IN_FLIGHT;
         createInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
         createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            createBuffer(m_physicalDevice, m_device, createInfo,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_uniformBuffers[i], m_uniformBuffersMemory[i]);
-        }
+        createBuffer(m_allocator, m_device, createInfo,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_uniformBuffer, m_uniformBufferMemory, AllocationStrategy::Linear);
 	}
 
-    VkBuffer Uniform::getUniformBuffer(uint32_t index) const
+    void Uniform::beginFrame(uint32_t frameIndex)
+    {
+        m_frameBegin = m_frameCapacity * frameIndex;
+        m_head = m_frameBegin;
+    }
+
+    uint32_t Uniform::push(const void* data, VkDeviceSize size)
+    {
+        if (m_head + size > m_frameBegin + m_frameCapacity) {
+            throw std::runtime_error("uniform ring overflow, raise the per-frame capacity!");
+        }
+
+        VkDeviceSize offset = m_head;
+        memcpy(m_uniformBufferMemory.mapped + offset, data, static_cast<size_t>(size));
+
+        m_head = (offset + size + m_alignment - 1) / m_alignment * m_alignment;
+
+        return static_cast<uint32_t>(offset);
+    }
+
+    VkBuffer Uniform::getUniformBuffer() const
+    {
+        return m_uniformBuffer;
+    }
+
+    const MemoryAllocation& Uniform::getUniformMemory() const
     {
-        return m_uniformBuffers[index];
+        return m_uniformBufferMemory;
     }
 
-    VkDeviceMemory Uniform::getUniformMemory(uint32_t index) const
+    VkDeviceSize Uniform::getFrameCapacity() const
     {
-        return m_uniformBuffersMemory[index];
+        return m_frameCapacity;
     }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,467 @@
+#include "UploadManager.h"
+
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include "VkUtil.h"
+
+namespace vulkan {
+
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    UploadManager::UploadManager(MemoryAllocator& allocator, VkDevice device, VkQueue queue, std::mutex& queueMutex, uint32_t queueFamilyIndex,
+        uint32_t dstQueueFamilyIndex, VkDeviceSize stagingSize)
+        : m_allocator(allocator), m_device(device), m_queue(queue), m_queueMutex(queueMutex), m_ringSize(stagingSize)
+    {
+        // make every transfer write visible to the stages drawing with it, on the destination family when the families differ
+        m_transfer.srcFamily = queueFamilyIndex;
+        m_transfer.dstFamily = dstQueueFamilyIndex;
+        m_transfer.srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        m_transfer.srcAccess = VK_ACCESS_TRANSFER_WRITE_BIT;
+        m_transfer.dstStage = CONSUMER_STAGES;
+        m_transfer.dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        m_pendingAcquire = m_transfer;
+
+        // mip chains are blitted by transfer commands on the destination family
+        m_mipTransfer = m_transfer;
+        m_mipTransfer.dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        m_mipTransfer.dstAccess = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        m_pendingMipAcquire = m_mipTransfer;
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+        if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload command pool!");
+        }
+
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+
+        if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_timeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload semaphore!");
+        }
+
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = m_ringSize;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        createBuffer(m_allocator, m_device, bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_ringBuffer, m_ringMemory, AllocationStrategy::Linear);
+    }
+
+    UploadManager::~UploadManager()
+    {
+        waitIdle();
+
+        for (auto& batch : m_freeBatches) {
+            vkDestroyFence(m_device, batch.fence, nullptr);
+        }
+
+        vkDestroyBuffer(m_device, m_ringBuffer, nullptr);
+        m_allocator.free(m_ringMemory);
+
+        vkDestroySemaphore(m_device, m_timeline, nullptr);
+        vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    }
+
+    UploadTicket UploadManager::uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        StagingRegion staging = acquireStaging(size, 16);
+        memcpy(staging.mapped, data, static_cast<size_t>(size));
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = staging.offset;
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size = size;
+        vkCmdCopyBuffer(beginRecording(), staging.buffer, dstBuffer, 1, &copyRegion);
+        m_recording->release.addBuffer(dstBuffer);
+
+        return m_recording->ticket;
+    }
+
+    UploadTicket UploadManager::uploadImage(VkImage image, VkFormat format, const void* data, VkDeviceSize size, uint32_t width, uint32_t height,
+        uint32_t mipLevels, bool generateMips)
+    {
+        const uint32_t copiedLevels = generateMips ? 1 : mipLevels;
+
+        VkDeviceSize levelsSize = 0;
+        for (uint32_t level = 0; level < copiedLevels; level++) {
+            levelsSize += getImageLevelSize(format, std::max(width >> level, 1u), std::max(height >> level, 1u));
+        }
+        if (levelsSize > size) {
+            throw std::runtime_error("failed to upload image, data is smaller than its levels!");
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        StagingRegion staging = acquireStaging(levelsSize, 16);
+        memcpy(staging.mapped, data, static_cast<size_t>(levelsSize));
+
+        VkCommandBuffer commandBuffer = beginRecording();
+        recordImageLayoutTransition(commandBuffer, image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+
+        VkDeviceSize offset = staging.offset;
+        for (uint32_t level = 0; level < copiedLevels; level++) {
+            uint32_t levelWidth = std::max(width >> level, 1u);
+            uint32_t levelHeight = std::max(height >> level, 1u);
+
+            recordCopyBufferToImage(commandBuffer, staging.buffer, image, levelWidth, levelHeight, offset, level);
+            offset += getImageLevelSize(format, levelWidth, levelHeight);
+        }
+
+        if (!generateMips || mipLevels == 1) {
+            m_recording->release.addImage(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
+        }
+        else if (!m_mipTransfer.isOwnershipTransfer()) {
+            // the upload queue is the graphics queue
+            recordGenerateMipmaps(commandBuffer, image, width, height, mipLevels);
+        }
+        else {
+            // a transfer-only queue cannot blit, the chain moves to the graphics family as is
+            m_recording->mipRelease.addImage(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+            m_recording->mipmaps.push_back({ image, width, height, mipLevels });
+        }
+
+        return m_recording->ticket;
+    }
+
+    UploadTicket UploadManager::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = srcOffset;
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size = size;
+        vkCmdCopyBuffer(beginRecording(), srcBuffer, dstBuffer, 1, &copyRegion);
+        m_recording->release.addBuffer(dstBuffer);
+
+        return m_recording->ticket;
+    }
+
+    UploadTicket UploadManager::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDeviceSize bufferOffset)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        recordCopyBufferToImage(beginRecording(), buffer, image, width, height, bufferOffset);
+        m_recording->release.addImage(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        return m_recording->ticket;
+    }
+
+    UploadTicket UploadManager::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        VkCommandBuffer commandBuffer = beginRecording();
+        // the last transition before shaders read the image travels with the release
+        if (newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+            m_recording->release.addImage(image, oldLayout, newLayout);
+        }
+        else {
+            recordImageLayoutTransition(commandBuffer, image, format, oldLayout, newLayout);
+        }
+
+        return m_recording->ticket;
+    }
+
+    UploadTicket UploadManager::releaseStaging(VkBuffer buffer, MemoryAllocation& allocation)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        beginRecording();
+        m_recording->staging.emplace_back(buffer, allocation);
+        allocation = MemoryAllocation{};
+
+        return m_recording->ticket;
+    }
+
+    UploadTicket UploadManager::flush()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        return submitRecording();
+    }
+
+    void UploadManager::update()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        retireCompleted(false, 0);
+    }
+
+    UploadTicket UploadManager::recordAcquire(VkCommandBuffer commandBuffer)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // batches on a shared queue need no acquire, being submitted ahead of the frame is enough
+        m_acquiredTicket = m_nextTicket - 1;
+
+        if (m_pendingAcquire.empty() && m_pendingMipAcquire.empty()) {
+            return 0;
+        }
+
+        m_pendingAcquire.recordAcquire(commandBuffer);
+        m_pendingAcquire.clear();
+
+        m_pendingMipAcquire.recordAcquire(commandBuffer);
+        m_pendingMipAcquire.clear();
+
+        for (const auto& mipmap : m_pendingMipmaps) {
+            recordGenerateMipmaps(commandBuffer, mipmap.image, mipmap.width, mipmap.height, mipmap.mipLevels);
+        }
+        m_pendingMipmaps.clear();
+
+        return m_pendingAcquireTicket;
+    }
+
+    UploadTicket UploadManager::getAcquiredTicket()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        return m_acquiredTicket;
+    }
+
+    VkSemaphore UploadManager::getSemaphore() const
+    {
+        return m_timeline;
+    }
+
+    bool UploadManager::isComplete(UploadTicket ticket)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        retireCompleted(false, 0);
+        return ticket <= m_completedTicket;
+    }
+
+    void UploadManager::wait(UploadTicket ticket)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_recording && ticket >= m_recording->ticket) {
+            submitRecording();
+        }
+
+        retireCompleted(true, ticket);
+    }
+
+    void UploadManager::waitIdle()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        submitRecording();
+        retireCompleted(true, m_nextTicket - 1);
+    }
+
+    StagingRegion UploadManager::acquireStaging(VkDeviceSize size, VkDeviceSize alignment)
+    {
+        StagingRegion region{};
+
+        // uploads that can never fit in the ring get a one-off staging buffer
+        if (size > m_ringSize) {
+            VkBufferCreateInfo bufferInfo{};
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = size;
+            bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            MemoryAllocation allocation;
+            createBuffer(m_allocator, m_device, bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, region.buffer, allocation, AllocationStrategy::Linear);
+            region.mapped = allocation.mapped;
+
+            beginRecording();
+            m_recording->staging.emplace_back(region.buffer, allocation);
+            return region;
+        }
+
+        for (;;) {
+            if (m_ringTail == m_ringHead) {
+                // nothing reads from a drained ring, restart it at the next wrap so the whole ring is free
+                m_ringHead = alignUp(m_ringHead, m_ringSize);
+                m_ringTail = m_ringHead;
+            }
+
+            VkDeviceSize start = alignUp(m_ringHead, alignment);
+            if (start % m_ringSize + size > m_ringSize) {
+                // never straddle the end of the ring, skip ahead to the next wrap
+                start = (start / m_ringSize + 1) * m_ringSize;
+            }
+
+            if (start + size - m_ringTail <= m_ringSize) {
+                m_ringHead = start + size;
+
+                beginRecording();
+                m_recording->ringEnd = m_ringHead;
+
+                region.buffer = m_ringBuffer;
+                region.offset = start % m_ringSize;
+                region.mapped = m_ringMemory.mapped + region.offset;
+                return region;
+            }
+
+            // back-pressure: the ring is full, block until the oldest batch reading from it retires
+            if (m_inFlight.empty()) {
+                submitRecording();
+            }
+            if (m_inFlight.empty()) {
+                throw std::runtime_error("failed to acquire staging memory, no upload in flight to wait for!");
+            }
+            retireCompleted(true, m_inFlight.front().ticket);
+        }
+    }
+
+    VkCommandBuffer UploadManager::beginRecording()
+    {
+        if (m_recording) {
+            return m_recording->commandBuffer;
+        }
+
+        m_recording = std::make_unique<Batch>();
+        if (!m_freeBatches.empty()) {
+            *m_recording = std::move(m_freeBatches.back());
+            m_freeBatches.pop_back();
+        }
+        else {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandPool = m_commandPool;
+            allocInfo.commandBufferCount = 1;
+
+            if (vkAllocateCommandBuffers(m_device, &allocInfo, &m_recording->commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate upload command buffer!");
+            }
+
+            VkFenceCreateInfo fenceInfo{};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+            if (vkCreateFence(m_device, &fenceInfo, nullptr, &m_recording->fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create upload fence!");
+            }
+        }
+
+        m_recording->ticket = m_nextTicket;
+        m_recording->ringEnd = 0;
+        m_recording->release = m_transfer;
+        m_recording->mipRelease = m_mipTransfer;
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(m_recording->commandBuffer, &beginInfo);
+
+        return m_recording->commandBuffer;
+    }
+
+    UploadTicket UploadManager::submitRecording()
+    {
+        if (!m_recording) {
+            return m_nextTicket - 1;
+        }
+
+        VkCommandBuffer commandBuffer = m_recording->commandBuffer;
+        UploadTicket ticket = m_recording->ticket;
+
+        // on a shared queue this makes the batch's writes visible to later submissions, so frames can draw with
+        // the uploaded data without waiting on the fence. a dedicated queue releases the destinations instead
+        const QueueOwnershipTransfer& release = m_recording->release;
+        const QueueOwnershipTransfer& mipRelease = m_recording->mipRelease;
+        release.recordRelease(commandBuffer);
+        mipRelease.recordRelease(commandBuffer);
+
+        vkEndCommandBuffer(commandBuffer);
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &ticket;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &m_timeline;
+
+        {
+            std::lock_guard<std::mutex> queueLock(m_queueMutex);
+            if (vkQueueSubmit(m_queue, 1, &submitInfo, m_recording->fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to submit upload command buffer!");
+            }
+        }
+
+        if (release.isOwnershipTransfer() && !release.empty()) {
+            m_pendingAcquire.buffers.insert(m_pendingAcquire.buffers.end(), release.buffers.begin(), release.buffers.end());
+            m_pendingAcquire.images.insert(m_pendingAcquire.images.end(), release.images.begin(), release.images.end());
+            m_pendingAcquireTicket = ticket;
+        }
+        if (!mipRelease.empty()) {
+            m_pendingMipAcquire.images.insert(m_pendingMipAcquire.images.end(), mipRelease.images.begin(), mipRelease.images.end());
+            m_pendingMipmaps.insert(m_pendingMipmaps.end(), m_recording->mipmaps.begin(), m_recording->mipmaps.end());
+            m_pendingAcquireTicket = ticket;
+        }
+
+        m_recording->release.clear();
+        m_recording->mipRelease.clear();
+        m_recording->mipmaps.clear();
+        m_inFlight.push_back(std::move(*m_recording));
+        m_recording.reset();
+        m_nextTicket++;
+
+        return ticket;
+    }
+
+    void UploadManager::retireCompleted(bool wait, UploadTicket ticket)
+    {
+        // batches complete in submission order on a single queue
+        while (!m_inFlight.empty()) {
+            Batch& batch = m_inFlight.front();
+
+            if (wait && batch.ticket <= ticket) {
+                vkWaitForFences(m_device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+            }
+            else if (vkGetFenceStatus(m_device, batch.fence) != VK_SUCCESS) {
+                break;
+            }
+
+            retire(batch);
+            m_freeBatches.push_back(std::move(batch));
+            m_inFlight.pop_front();
+        }
+    }
+
+    void UploadManager::retire(Batch& batch)
+    {
+        for (auto& staging : batch.staging) {
+            vkDestroyBuffer(m_device, staging.first, nullptr);
+            m_allocator.free(staging.second);
+        }
+        batch.staging.clear();
+
+        m_ringTail = std::max(m_ringTail, batch.ringEnd);
+
+        vkResetFences(m_device, 1, &batch.fence);
+        vkResetCommandBuffer(batch.commandBuffer, 0);
+
+        m_completedTicket = batch.ticket;
+    }
+
+}
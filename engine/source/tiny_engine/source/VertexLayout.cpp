@@ -0,0 +1,438 @@
+#include "VertexLayout.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+namespace vulkan {
+    namespace {
+        bool isCompatible(VertexAttribute attribute, VertexFormat format)
+        {
+            switch (attribute) {
+            case VertexAttribute::Position:
+                return format == VertexFormat::Float3 || format == VertexFormat::Half4;
+            case VertexAttribute::Color:
+                return format == VertexFormat::Float3 || format == VertexFormat::Half4 || format == VertexFormat::Unorm8x4;
+            case VertexAttribute::TexCoord:
+                return format == VertexFormat::Float2 || format == VertexFormat::Half2 || format == VertexFormat::Unorm16x2;
+            case VertexAttribute::Normal:
+                return format == VertexFormat::Float3 || format == VertexFormat::Half4 || format == VertexFormat::Snorm8x4 || format == VertexFormat::Octahedral16;
+            default:
+                return false;
+            }
+        }
+
+        int16_t toSnorm16(float value)
+        {
+            return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+        }
+
+        int8_t toSnorm8(float value)
+        {
+            return static_cast<int8_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 127.0f));
+        }
+
+        uint16_t toUnorm16(float value)
+        {
+            return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+        }
+
+        uint8_t toUnorm8(float value)
+        {
+            return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+        }
+
+        void encodeAttribute(VertexFormat format, const float* value, uint32_t components, uint8_t* out)
+        {
+            float v[4] = {};
+            memcpy(v, value, sizeof(float) * components);
+
+            switch (format) {
+            case VertexFormat::Float3:
+            case VertexFormat::Float2:
+                memcpy(out, v, VertexLayout::getFormatSize(format));
+                break;
+            case VertexFormat::Half4:
+            case VertexFormat::Half2: {
+                uint16_t halves[4];
+                for (uint32_t i = 0; i < 4; i++) {
+                    halves[i] = floatToHalf(v[i]);
+                }
+                memcpy(out, halves, VertexLayout::getFormatSize(format));
+                break;
+            }
+            case VertexFormat::Unorm16x2: {
+                uint16_t values[2] = { toUnorm16(v[0]), toUnorm16(v[1]) };
+                memcpy(out, values, sizeof(values));
+                break;
+            }
+            case VertexFormat::Unorm8x4:
+                for (uint32_t i = 0; i < 4; i++) {
+                    out[i] = toUnorm8(i < components ? v[i] : 1.0f);
+                }
+                break;
+            case VertexFormat::Snorm8x4:
+                for (uint32_t i = 0; i < 4; i++) {
+                    out[i] = static_cast<uint8_t>(toSnorm8(v[i]));
+                }
+                break;
+            case VertexFormat::Octahedral16: {
+                glm::vec2 encoded = encodeOctahedral(glm::vec3(v[0], v[1], v[2]));
+                int16_t values[2] = { toSnorm16(encoded.x), toSnorm16(encoded.y) };
+                memcpy(out, values, sizeof(values));
+                break;
+            }
+            default:
+                throw std::runtime_error("failed to encode vertex, unknown format!");
+            }
+        }
+    }
+
+    uint16_t floatToHalf(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        uint32_t sign = (bits >> 16) & 0x8000;
+        int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+        uint32_t mantissa = bits & 0x7fffff;
+
+        // nan and inf
+        if (((bits >> 23) & 0xff) == 0xff) {
+            return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+        }
+        // overflow saturates to inf
+        if (exponent >= 31) {
+            return static_cast<uint16_t>(sign | 0x7c00);
+        }
+        // denormals, rounded to nearest even
+        if (exponent <= 0) {
+            if (exponent < -10) {
+                return static_cast<uint16_t>(sign);
+            }
+            mantissa |= 0x800000;
+            uint32_t shift = static_cast<uint32_t>(14 - exponent);
+            uint32_t half = mantissa >> shift;
+            uint32_t rest = mantissa & ((1u << shift) - 1);
+            uint32_t halfway = 1u << (shift - 1);
+            if (rest > halfway || (rest == halfway && (half & 1))) {
+                half++;
+            }
+            return static_cast<uint16_t>(sign | half);
+        }
+
+        uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+        uint32_t rest = mantissa & 0x1fff;
+        // a carry into the exponent is the correct rounding, up to inf
+        if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+            half++;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    float halfToFloat(uint16_t value)
+    {
+        uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+        uint32_t exponent = (value >> 10) & 0x1f;
+        uint32_t mantissa = value & 0x3ff;
+
+        uint32_t bits;
+        if (exponent == 0x1f) {
+            bits = sign | 0x7f800000 | (mantissa << 13);
+        }
+        else if (exponent != 0) {
+            bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+        }
+        else if (mantissa != 0) {
+            // renormalize the denormal
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x400)) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+        else {
+            bits = sign;
+        }
+
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+    glm::vec2 encodeOctahedral(const glm::vec3& normal)
+    {
+        float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        if (length == 0.0f) {
+            return glm::vec2(0.0f);
+        }
+
+        glm::vec2 encoded(normal.x / length, normal.y / length);
+        // the lower hemisphere is folded over the diagonals
+        if (normal.z < 0.0f) {
+            glm::vec2 folded((1.0f - std::abs(encoded.y)) * (encoded.x >= 0.0f ? 1.0f : -1.0f),
+                (1.0f - std::abs(encoded.x)) * (encoded.y >= 0.0f ? 1.0f : -1.0f));
+            encoded = folded;
+        }
+        return encoded;
+    }
+
+    glm::vec3 decodeOctahedral(const glm::vec2& encoded)
+    {
+        glm::vec3 normal(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+        float t = std::max(-normal.z, 0.0f);
+        normal.x += normal.x >= 0.0f ? -t : t;
+        normal.y += normal.y >= 0.0f ? -t : t;
+        return glm::normalize(normal);
+    }
+
+    VertexLayout& VertexLayout::add(VertexAttribute attribute, VertexFormat format, uint32_t stream)
+    {
+        if (attribute >= VertexAttribute::Count || format >= VertexFormat::Count) {
+            throw std::runtime_error("failed to add vertex attribute, unknown attribute or format!");
+        }
+        if (stream >= MAX_STREAMS) {
+            throw std::runtime_error("failed to add vertex attribute, stream out of range!");
+        }
+        if (hasAttribute(attribute)) {
+            throw std::runtime_error("failed to add vertex attribute, attribute already in layout!");
+        }
+        if (!isCompatible(attribute, format)) {
+            throw std::runtime_error("failed to add vertex attribute, format does not fit the attribute!");
+        }
+
+        VertexAttributeDesc desc{};
+        desc.attribute = attribute;
+        desc.format = format;
+        desc.stream = static_cast<uint8_t>(stream);
+        desc.offset = static_cast<uint8_t>(m_strides[stream]);
+        m_attributes.push_back(desc);
+
+        m_strides[stream] += getFormatSize(format);
+        m_streamCount = std::max(m_streamCount, stream + 1);
+
+        return *this;
+    }
+
+    const VertexLayout& VertexLayout::getDefault()
+    {
+        static const VertexLayout layout = VertexLayout()
+            .add(VertexAttribute::Position, VertexFormat::Float3, 0)
+            .add(VertexAttribute::TexCoord, VertexFormat::Half2, 1);
+        return layout;
+    }
+
+    const VertexLayout& VertexLayout::getFull()
+    {
+        static const VertexLayout layout = VertexLayout()
+            .add(VertexAttribute::Position, VertexFormat::Float3)
+            .add(VertexAttribute::Color, VertexFormat::Float3)
+            .add(VertexAttribute::TexCoord, VertexFormat::Float2);
+        return layout;
+    }
+
+    std::vector<VkVertexInputBindingDescription> VertexLayout::getBindingDescriptions() const
+    {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+        for (uint32_t stream = 0; stream < m_streamCount; stream++) {
+            auto streamBindings = getBindingDescriptions(stream);
+            bindingDescriptions.insert(bindingDescriptions.end(), streamBindings.begin(), streamBindings.end());
+        }
+        return bindingDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> VertexLayout::getAttributeDescriptions() const
+    {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+        for (uint32_t stream = 0; stream < m_streamCount; stream++) {
+            auto streamAttributes = getAttributeDescriptions(stream);
+            attributeDescriptions.insert(attributeDescriptions.end(), streamAttributes.begin(), streamAttributes.end());
+        }
+        return attributeDescriptions;
+    }
+
+    std::vector<VkVertexInputBindingDescription> VertexLayout::getBindingDescriptions(uint32_t stream) const
+    {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+        // a stream without attributes gets no binding, the buffer slot is simply skipped
+        if (stream < m_streamCount && m_strides[stream] != 0) {
+            VkVertexInputBindingDescription bindingDescription{};
+            bindingDescription.binding = stream;
+            bindingDescription.stride = m_strides[stream];
+            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+            bindingDescriptions.push_back(bindingDescription);
+        }
+        return bindingDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> VertexLayout::getAttributeDescriptions(uint32_t stream) const
+    {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+        for (const VertexAttributeDesc& desc : m_attributes) {
+            if (desc.stream != stream) {
+                continue;
+            }
+
+            VkVertexInputAttributeDescription attributeDescription{};
+            attributeDescription.binding = desc.stream;
+            attributeDescription.location = getLocation(desc.attribute);
+            attributeDescription.format = getVkFormat(desc.format);
+            attributeDescription.offset = desc.offset;
+            attributeDescriptions.push_back(attributeDescription);
+        }
+        return attributeDescriptions;
+    }
+
+    std::vector<std::vector<uint8_t>> VertexLayout::encode(const Vertex* vertices, size_t vertexCount) const
+    {
+        std::vector<std::vector<uint8_t>> streams(m_streamCount);
+        for (uint32_t stream = 0; stream < m_streamCount; stream++) {
+            streams[stream].resize(m_strides[stream] * vertexCount);
+        }
+
+        for (const VertexAttributeDesc& desc : m_attributes) {
+            uint32_t stride = m_strides[desc.stream];
+            uint8_t* out = streams[desc.stream].data() + desc.offset;
+
+            for (size_t i = 0; i < vertexCount; i++, out += stride) {
+                const Vertex& vertex = vertices[i];
+                switch (desc.attribute) {
+                case VertexAttribute::Position:
+                    encodeAttribute(desc.format, &vertex.pos.x, 3, out);
+                    break;
+                case VertexAttribute::Color:
+                    encodeAttribute(desc.format, &vertex.color.x, 3, out);
+                    break;
+                case VertexAttribute::TexCoord:
+                    encodeAttribute(desc.format, &vertex.texCoord.x, 2, out);
+                    break;
+                case VertexAttribute::Normal:
+                    encodeAttribute(desc.format, &vertex.normal.x, 3, out);
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+
+        return streams;
+    }
+
+    uint32_t VertexLayout::getStreamCount() const
+    {
+        return m_streamCount;
+    }
+
+    uint32_t VertexLayout::getStride(uint32_t stream) const
+    {
+        return stream < MAX_STREAMS ? m_strides[stream] : 0;
+    }
+
+    uint32_t VertexLayout::getVertexSize() const
+    {
+        uint32_t size = 0;
+        for (uint32_t stream = 0; stream < m_streamCount; stream++) {
+            size += m_strides[stream];
+        }
+        return size;
+    }
+
+    const std::vector<VertexAttributeDesc>& VertexLayout::getAttributes() const
+    {
+        return m_attributes;
+    }
+
+    bool VertexLayout::hasAttribute(VertexAttribute attribute) const
+    {
+        return std::any_of(m_attributes.begin(), m_attributes.end(), [attribute](const VertexAttributeDesc& desc) {
+            return desc.attribute == attribute;
+        });
+    }
+
+    uint32_t VertexLayout::pack(uint32_t* words) const
+    {
+        for (size_t i = 0; i < m_attributes.size(); i++) {
+            const VertexAttributeDesc& desc = m_attributes[i];
+            words[i] = static_cast<uint32_t>(desc.attribute) | (static_cast<uint32_t>(desc.format) << 8) | (static_cast<uint32_t>(desc.stream) << 16);
+        }
+        return static_cast<uint32_t>(m_attributes.size());
+    }
+
+    VertexLayout VertexLayout::unpack(const uint32_t* words, uint32_t count)
+    {
+        if (count > MAX_ATTRIBUTES) {
+            throw std::runtime_error("failed to unpack vertex layout, too many attributes!");
+        }
+
+        VertexLayout layout;
+        for (uint32_t i = 0; i < count; i++) {
+            layout.add(static_cast<VertexAttribute>(words[i] & 0xff), static_cast<VertexFormat>((words[i] >> 8) & 0xff), (words[i] >> 16) & 0xff);
+        }
+        return layout;
+    }
+
+    bool VertexLayout::operator==(const VertexLayout& other) const
+    {
+        if (m_attributes.size() != other.m_attributes.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < m_attributes.size(); i++) {
+            const VertexAttributeDesc& a = m_attributes[i];
+            const VertexAttributeDesc& b = other.m_attributes[i];
+            if (a.attribute != b.attribute || a.format != b.format || a.stream != b.stream) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool VertexLayout::operator!=(const VertexLayout& other) const
+    {
+        return !(*this == other);
+    }
+
+    uint32_t VertexLayout::getFormatSize(VertexFormat format)
+    {
+        switch (format) {
+        case VertexFormat::Float3:       return 12;
+        case VertexFormat::Float2:       return 8;
+        case VertexFormat::Half4:        return 8;
+        case VertexFormat::Half2:        return 4;
+        case VertexFormat::Unorm16x2:    return 4;
+        case VertexFormat::Unorm8x4:     return 4;
+        case VertexFormat::Snorm8x4:     return 4;
+        case VertexFormat::Octahedral16: return 4;
+        default:                         return 0;
+        }
+    }
+
+    VkFormat VertexLayout::getVkFormat(VertexFormat format)
+    {
+        switch (format) {
+        case VertexFormat::Float3:       return VK_FORMAT_R32G32B32_SFLOAT;
+        case VertexFormat::Float2:       return VK_FORMAT_R32G32_SFLOAT;
+        case VertexFormat::Half4:        return VK_FORMAT_R16G16B16A16_SFLOAT;
+        case VertexFormat::Half2:        return VK_FORMAT_R16G16_SFLOAT;
+        case VertexFormat::Unorm16x2:    return VK_FORMAT_R16G16_UNORM;
+        case VertexFormat::Unorm8x4:     return VK_FORMAT_R8G8B8A8_UNORM;
+        case VertexFormat::Snorm8x4:     return VK_FORMAT_R8G8B8A8_SNORM;
+        case VertexFormat::Octahedral16: return VK_FORMAT_R16G16_SNORM;
+        default:                         return VK_FORMAT_UNDEFINED;
+        }
+    }
+
+    uint32_t VertexLayout::getLocation(VertexAttribute attribute)
+    {
+        switch (attribute) {
+        case VertexAttribute::Position: return 0;
+        case VertexAttribute::Color:    return 1;
+        case VertexAttribute::TexCoord: return 2;
+        // after the instance matrix
+        case VertexAttribute::Normal:   return 7;
+        default:                        return ~0u;
+        }
+    }
+
+}
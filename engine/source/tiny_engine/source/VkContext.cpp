@@ -4,10 +4,17 @@
 #include <GLFW/glfw3.h>
 
 #include <set>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
 
 #include "RenderCfg.h"
 #include "VKUtil.h"
+#include "MemoryAllocator.h"
+#include "UploadManager.h"
+#include "PipelineCache.h"
+#include "DeletionQueue.h"
+#include "common_utils.h"
 
 namespace vulkan {
 
@@ -25,7 +32,8 @@ namespace vulkan {
             appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
             appInfo.pEngineName = "No Engine";
             appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-            appInfo.apiVersion = VK_API_VERSION_1_0;
+            // timeline semaphores pace the frames
+            appInfo.apiVersion = VK_API_VERSION_1_2;
 
             VkInstanceCreateInfo createInfo{};
             createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -93,6 +101,9 @@ namespace vulkan {
                 throw std::runtime_error("failed to find a suitable GPU!");
             }
 
+            vkGetPhysicalDeviceFeatures(m_physicalDevice, &m_features);
+            vkGetPhysicalDeviceProperties(m_physicalDevice, &m_properties);
+
         }
 
         // create logical device
@@ -105,7 +116,8 @@ namespace vulkan {
             }
 
             std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-            std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+            std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value(),
+                indices.transferFamily.value(), indices.computeFamily.value() };
 
             float queuePriority = 1.0f;
             for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -117,7 +129,15 @@ namespace vulkan {
                 queueCreateInfos.push_back(queueCreateInfo);
             }
 
+            // optional, cluster culling draws many commands per batch and needs both
             VkPhysicalDeviceFeatures deviceFeatures{};
+            deviceFeatures.multiDrawIndirect = m_features.multiDrawIndirect;
+            deviceFeatures.drawIndirectFirstInstance = m_features.drawIndirectFirstInstance;
+            // optional, texture samplers fall back to trilinear filtering
+            deviceFeatures.samplerAnisotropy = m_features.samplerAnisotropy;
+            // optional, cooked bc textures fall back to their uncompressed source
+            deviceFeatures.textureCompressionBC = m_features.textureCompressionBC;
+            m_enabledFeatures = deviceFeatures;
 
             VkDeviceCreateInfo createInfo{};
             createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -127,8 +147,30 @@ namespace vulkan {
 
             createInfo.pEnabledFeatures = &deviceFeatures;
 
-            createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-            createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+            // required, isDeviceSuitable only picks devices that have it
+            VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+            timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+            timelineFeatures.timelineSemaphore = VK_TRUE;
+            createInfo.pNext = &timelineFeatures;
+
+            // optional, tells pipeline cache hits from misses
+            std::vector<const char*> extensions = deviceExtensions;
+            {
+                uint32_t extensionCount;
+                vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, nullptr);
+                std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+                vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+                for (const auto& extension : availableExtensions) {
+                    if (strcmp(extension.extensionName, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME) == 0) {
+                        extensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+                        m_pipelineCreationFeedback = true;
+                    }
+                }
+            }
+
+            createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+            createInfo.ppEnabledExtensionNames = extensions.data();
 
             if (enableValidationLayers) {
                 createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -144,6 +186,34 @@ namespace vulkan {
 
             vkGetDeviceQueue(m_device, indices.graphicsFamily.value(), 0, &m_graphicsQueue);
             vkGetDeviceQueue(m_device, indices.presentFamily.value(), 0, &m_presentQueue);
+
+            // without dedicated families these are the graphics queue again
+            m_transferQueueFamilyIndex = indices.transferFamily.value();
+            m_computeQueueFamilyIndex = indices.computeFamily.value();
+            vkGetDeviceQueue(m_device, m_transferQueueFamilyIndex, 0, &m_transferQueue);
+            vkGetDeviceQueue(m_device, m_computeQueueFamilyIndex, 0, &m_computeQueue);
+
+            for (VkQueue queue : { m_graphicsQueue, m_presentQueue, m_transferQueue, m_computeQueue }) {
+                auto found = std::find_if(m_queueMutexes.begin(), m_queueMutexes.end(), [queue](const auto& entry) { return entry.first == queue; });
+                if (found == m_queueMutexes.end()) {
+                    m_queueMutexes.emplace_back(queue, std::make_unique<std::mutex>());
+                }
+            }
+
+            if (enableVerboseOutput) {
+                std::cout << "queue families: graphics " << m_graphicsQueueFamilyIndex << ", transfer " << m_transferQueueFamilyIndex
+                    << ", compute " << m_computeQueueFamilyIndex << std::endl;
+            }
+        }
+
+        // create memory allocator
+        {
+            m_allocator = std::make_unique<MemoryAllocator>(m_physicalDevice, m_device);
+        }
+
+        // create deletion queue, resources replaced at runtime are destroyed once their frames completed
+        {
+            m_deletionQueue = std::make_unique<DeletionQueue>(*m_allocator, m_device);
         }
 
         // create command pool
@@ -160,19 +230,34 @@ namespace vulkan {
             }
         }
 
+        // create upload manager, copies run on the transfer queue and hand their destinations over to the graphics family
+        {
+            m_uploadManager = std::make_unique<UploadManager>(*m_allocator, m_device, m_transferQueue, getQueueMutex(m_transferQueue),
+                m_transferQueueFamilyIndex, m_graphicsQueueFamilyIndex);
+        }
+
+        // create pipeline cache, loaded from the previous run when device, driver and shaders are unchanged
+        {
+            auto exe_path = Utils::getCurrentProcessDirectory();
+            auto shader_path = exe_path.parent_path().parent_path() / "engine/shaders";
+            auto cache_path = exe_path / "pipeline_cache.bin";
+
+            m_pipelineCache = std::make_unique<PipelineCache>(m_physicalDevice, m_device, cache_path.string(), shader_path.string(), m_pipelineCreationFeedback);
+        }
+
         // create descriptor pool
         {
             std::array<VkDescriptorPoolSize, 2> poolSizes{};
-            poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+            poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_MATERIALS);
             poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+            poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_MATERIALS);
 
             VkDescriptorPoolCreateInfo poolInfo{};
             poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
             poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
             poolInfo.pPoolSizes = poolSizes.data();
-            poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+            poolInfo.maxSets = static_cast<uint32_t>(MAX_MATERIALS);
 
             if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
                 throw std::runtime_error("failed to create descriptor pool!");
@@ -184,6 +269,10 @@ namespace vulkan {
     VKContext::~VKContext() {
         vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
         vkDestroyCommandPool(m_device, m_graphicsCommandPool, nullptr);
+        m_deletionQueue.reset();
+        m_pipelineCache.reset();
+        m_uploadManager.reset();
+        m_allocator.reset();
         vkDestroyDevice(m_device, nullptr);
 
         if (enableValidationLayers)
@@ -223,6 +312,26 @@ namespace vulkan {
         return m_presentQueue;
     }
 
+    VkQueue VKContext::getTransferQueue() const
+    {
+        return m_transferQueue;
+    }
+
+    std::mutex& VKContext::getQueueMutex(VkQueue queue) const
+    {
+        for (const auto& entry : m_queueMutexes) {
+            if (entry.first == queue) {
+                return *entry.second;
+            }
+        }
+        throw std::invalid_argument("not a queue of this context!");
+    }
+
+    VkQueue VKContext::getComputeQueue() const
+    {
+        return m_computeQueue;
+    }
+
     VkCommandPool VKContext::getGraphicsCommandPool() const
     {
         return m_graphicsCommandPool;
@@ -238,10 +347,61 @@ namespace vulkan {
         return m_descriptorPool;
     }
 
+    MemoryAllocator& VKContext::getAllocator() const
+    {
+        return *m_allocator;
+    }
+
+    UploadManager& VKContext::getUploadManager() const
+    {
+        return *m_uploadManager;
+    }
+
+    PipelineCache& VKContext::getPipelineCache() const
+    {
+        return *m_pipelineCache;
+    }
+
+    DeletionQueue& VKContext::getDeletionQueue() const
+    {
+        return *m_deletionQueue;
+    }
+
+    VkPhysicalDeviceFeatures VKContext::getDeviceFeatures() const
+    {
+        return m_features;
+    }
+
+    VkPhysicalDeviceFeatures VKContext::getEnabledDeviceFeatures() const
+    {
+        return m_enabledFeatures;
+    }
+
+    VkPhysicalDeviceProperties VKContext::getDeviceProperties() const
+    {
+        return m_properties;
+    }
+
     uint32_t VKContext::getGraphicsQueueFamilyIndex() const {
         return m_graphicsQueueFamilyIndex;
     }
 
+    uint32_t VKContext::getTransferQueueFamilyIndex() const {
+        return m_transferQueueFamilyIndex;
+    }
+
+    uint32_t VKContext::getComputeQueueFamilyIndex() const {
+        return m_computeQueueFamilyIndex;
+    }
+
+    bool VKContext::hasDedicatedTransferQueue() const {
+        return m_transferQueueFamilyIndex != m_graphicsQueueFamilyIndex;
+    }
+
+    bool VKContext::hasAsyncComputeQueue() const {
+        return m_computeQueueFamilyIndex != m_graphicsQueueFamilyIndex;
+    }
+
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
         createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
@@ -84,26 +84,45 @@ namespace vulkan {
         std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
         vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
-        int i = 0;
+        uint32_t i = 0;
         for (const auto& queueFamily : queueFamilies) {
             if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-                indices.graphicsFamily = i;
+                if (!indices.graphicsFamily.has_value()) {
+                    indices.graphicsFamily = i;
+                }
+            }
+            else if (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) {
+                if (!indices.computeFamily.has_value()) {
+                    indices.computeFamily = i;
+                }
+            }
+            else if (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) {
+                if (!indices.transferFamily.has_value()) {
+                    indices.transferFamily = i;
+                }
             }
 
             VkBool32 presentSupport = false;
             vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
 
-            if (presentSupport) {
+            // prefer presenting from the graphics family
+            if (presentSupport && (!indices.presentFamily.has_value() || indices.graphicsFamily == i)) {
                 indices.presentFamily = i;
             }
 
-            if (indices.isComplete()) {
-                break;
-            }
-
             i++;
         }
 
+        // every graphics and compute family supports transfers as well, even when it does not report the bit
+        if (indices.graphicsFamily.has_value()) {
+            if (!indices.transferFamily.has_value()) {
+                indices.transferFamily = indices.graphicsFamily;
+            }
+            if (!indices.computeFamily.has_value()) {
+                indices.computeFamily = indices.graphicsFamily;
+            }
+        }
+
         return indices;
     }
 
@@ -177,7 +196,7 @@ namespace vulkan {
         return buffer;
     }
 
-    void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkBufferCreateInfo bufferInfo, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+    void createBuffer(MemoryAllocator& allocator, VkDevice device, VkBufferCreateInfo bufferInfo, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory, AllocationStrategy strategy) {
         if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to create buffer!");
         }
@@ -185,49 +204,11 @@ namespace vulkan {
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+        bufferMemory = allocator.allocate(memRequirements, properties, strategy);
 
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate buffer memory!");
+        if (vkBindBufferMemory(device, buffer, bufferMemory.memory, bufferMemory.offset) != VK_SUCCESS) {
+            throw std::runtime_error("failed to bind buffer memory!");
         }
-
-        vkBindBufferMemory(device, buffer, bufferMemory, 0);
-    }
-
-    VkCommandBuffer beginSingleTimeCommands(VkDevice device, VkCommandPool commandPool) {
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = commandPool;
-        allocInfo.commandBufferCount = 1;
-
-        VkCommandBuffer commandBuffer;
-        vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-        vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-        return commandBuffer;
-    }
-
-    void endSingleTimeCommands(VkDevice device, VkQueue graphicsQueue, VkCommandPool commandPool, VkCommandBuffer commandBuffer) {
-        vkEndCommandBuffer(commandBuffer);
-
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
-
-        vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphicsQueue);
-
-        vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
     }
 
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface) {
@@ -281,20 +262,25 @@ namespace vulkan {
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
 
-        return indices.isComplete() && extensionsSupported && swapChainAdequate;
-    }
-
-    void copyBuffer(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
-
-        VkBufferCopy copyRegion{};
-        copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+        // frames are paced with a timeline semaphore, core since 1.2
+        bool timelineSupported = false;
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+        if (properties.apiVersion >= VK_API_VERSION_1_2) {
+            VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+            timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+            VkPhysicalDeviceFeatures2 features{};
+            features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features.pNext = &timelineFeatures;
+            vkGetPhysicalDeviceFeatures2(device, &features);
+            timelineSupported = timelineFeatures.timelineSemaphore == VK_TRUE;
+        }
 
-        endSingleTimeCommands(device, graphicsQueue, commandPool, commandBuffer);
+        return indices.isComplete() && extensionsSupported && swapChainAdequate && timelineSupported;
     }
 
-    void createImage(VkPhysicalDevice physicalDevice, VkDevice device, const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+    void createImage(MemoryAllocator& allocator, VkDevice device, const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocation& imageMemory) {
         if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
             throw std::runtime_error("failed to create image!");
         }
@@ -302,21 +288,14 @@ namespace vulkan {
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+        imageMemory = allocator.allocate(memRequirements, properties);
 
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate image memory!");
+        if (vkBindImageMemory(device, image, imageMemory.memory, imageMemory.offset) != VK_SUCCESS) {
+            throw std::runtime_error("failed to bind image memory!");
         }
-
-        vkBindImageMemory(device, image, imageMemory, 0);
     }
 
-    void transitionImageLayout(VkDevice device, VkQueue graphicsQueue, VkCommandPool commandPool, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
-
+    void recordImageLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         barrier.oldLayout = oldLayout;
@@ -328,7 +307,7 @@ namespace vulkan {
         barrier.image = image;
         barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.levelCount = mipLevels;
         barrier.subresourceRange.baseArrayLayer = 0;
         barrier.subresourceRange.layerCount = 1;
 
@@ -368,20 +347,16 @@ namespace vulkan {
             0, nullptr,
             1, &barrier
         );
-
-        endSingleTimeCommands(device, graphicsQueue, commandPool, commandBuffer);
     }
 
-    void copyBufferToImage(VkDevice device, VkQueue graphicsQueue, VkCommandPool commandPool, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
-
+    void recordCopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDeviceSize bufferOffset, uint32_t mipLevel) {
         VkBufferImageCopy region{};
-        region.bufferOffset = 0;
+        region.bufferOffset = bufferOffset;
         region.bufferRowLength = 0;
         region.bufferImageHeight = 0;
 
         region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.mipLevel = mipLevel;
         region.imageSubresource.baseArrayLayer = 0;
         region.imageSubresource.layerCount = 1;
 
@@ -396,8 +371,131 @@ namespace vulkan {
             1,
             &region
         );
+    }
+
+    VkDeviceSize getImageLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+        switch (format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            return static_cast<VkDeviceSize>(width) * height * 4;
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            // 4x4 blocks, partial blocks at the edges are stored whole
+            return static_cast<VkDeviceSize>((width + 3) / 4) * ((height + 3) / 4) * 8;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return static_cast<VkDeviceSize>((width + 3) / 4) * ((height + 3) / 4) * 16;
+        default:
+            throw std::invalid_argument("unsupported image format!");
+        }
+    }
+
+    bool supportsLinearBlit(VkPhysicalDevice physicalDevice, VkFormat format) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+        const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (properties.optimalTilingFeatures & required) == required;
+    }
+
+    void recordGenerateMipmaps(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+
+        int32_t levelWidth = static_cast<int32_t>(width);
+        int32_t levelHeight = static_cast<int32_t>(height);
+
+        for (uint32_t level = 1; level < mipLevels; level++) {
+            // the level above was just written, by the upload or the previous blit
+            barrier.subresourceRange.baseMipLevel = level - 1;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier
+            );
+
+            int32_t nextWidth = std::max(levelWidth / 2, 1);
+            int32_t nextHeight = std::max(levelHeight / 2, 1);
+
+            VkImageBlit blit{};
+            blit.srcOffsets[0] = { 0, 0, 0 };
+            blit.srcOffsets[1] = { levelWidth, levelHeight, 1 };
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = level - 1;
+            blit.srcSubresource.baseArrayLayer = 0;
+            blit.srcSubresource.layerCount = 1;
+            blit.dstOffsets[0] = { 0, 0, 0 };
+            blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = level;
+            blit.dstSubresource.baseArrayLayer = 0;
+            blit.dstSubresource.layerCount = 1;
+
+            vkCmdBlitImage(
+                commandBuffer,
+                image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1, &blit,
+                VK_FILTER_LINEAR
+            );
+
+            // done as a source, shaders may read it once the frame gets there
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier
+            );
+
+            levelWidth = nextWidth;
+            levelHeight = nextHeight;
+        }
 
-        endSingleTimeCommands(device, graphicsQueue, commandPool, commandBuffer);
+        // the last level is only ever written
+        barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier
+        );
     }
 
     VkShaderModule createShaderModule(VkDevice device, const std::vector<char>& code) {
@@ -434,4 +532,107 @@ namespace vulkan {
         return imageView;
     }
 
+    void QueueOwnershipTransfer::addBuffer(VkBuffer buffer) {
+        for (const auto& barrier : buffers) {
+            if (barrier.buffer == buffer) {
+                return;
+            }
+        }
+
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.buffer = buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        buffers.push_back(barrier);
+    }
+
+    void QueueOwnershipTransfer::addImage(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
+        for (const auto& barrier : images) {
+            if (barrier.image == image) {
+                return;
+            }
+        }
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        images.push_back(barrier);
+    }
+
+    bool QueueOwnershipTransfer::isOwnershipTransfer() const {
+        return srcFamily != dstFamily;
+    }
+
+    bool QueueOwnershipTransfer::empty() const {
+        return buffers.empty() && images.empty();
+    }
+
+    void QueueOwnershipTransfer::clear() {
+        buffers.clear();
+        images.clear();
+    }
+
+    // both halves repeat the families, ranges and layouts, only stages and access masks differ
+    static void recordOwnershipBarrier(const QueueOwnershipTransfer& transfer, VkCommandBuffer commandBuffer,
+        VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+        uint32_t srcFamily = transfer.isOwnershipTransfer() ? transfer.srcFamily : VK_QUEUE_FAMILY_IGNORED;
+        uint32_t dstFamily = transfer.isOwnershipTransfer() ? transfer.dstFamily : VK_QUEUE_FAMILY_IGNORED;
+
+        std::vector<VkBufferMemoryBarrier> buffers = transfer.buffers;
+        for (auto& barrier : buffers) {
+            barrier.srcQueueFamilyIndex = srcFamily;
+            barrier.dstQueueFamilyIndex = dstFamily;
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstAccessMask = dstAccess;
+        }
+
+        std::vector<VkImageMemoryBarrier> images = transfer.images;
+        for (auto& barrier : images) {
+            barrier.srcQueueFamilyIndex = srcFamily;
+            barrier.dstQueueFamilyIndex = dstFamily;
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstAccessMask = dstAccess;
+        }
+
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            srcStage, dstStage,
+            0,
+            0, nullptr,
+            static_cast<uint32_t>(buffers.size()), buffers.data(),
+            static_cast<uint32_t>(images.size()), images.data()
+        );
+    }
+
+    void QueueOwnershipTransfer::recordRelease(VkCommandBuffer commandBuffer) const {
+        if (empty()) {
+            return;
+        }
+
+        // the destination stages may not exist on the source queue, the acquire makes the writes visible there
+        if (isOwnershipTransfer()) {
+            recordOwnershipBarrier(*this, commandBuffer, srcStage, srcAccess, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+        }
+        else {
+            recordOwnershipBarrier(*this, commandBuffer, srcStage, srcAccess, dstStage, dstAccess);
+        }
+    }
+
+    void QueueOwnershipTransfer::recordAcquire(VkCommandBuffer commandBuffer) const {
+        if (empty() || !isOwnershipTransfer()) {
+            return;
+        }
+
+        // execution is ordered by the semaphore the destination submission waits on
+        recordOwnershipBarrier(*this, commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, dstStage, dstAccess);
+    }
+
 }
\ No newline at end of file